@@ -0,0 +1,568 @@
+// 在本源文件中替换全局operator new/delete，测量解析与导入的堆峰值（见memstats.h）
+#define MEMSTATS_HEAP_HOOKS
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "model.h"
+#include "picking.h"
+#include "scene.h"
+#include "snowflake.h"
+#include "windfield.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 热点路径的微基准与规模测试，不打开可见窗口，结果以JSON输出，便于跨版本对比
+// 用法：snow-bench [--out FILE] [--filter NAME] [--quick] [--root DIR]
+//   --out     JSON写入文件（默认输出到标准输出，人类可读的摘要写到标准错误）
+//   --filter  只运行名字包含NAME的用例
+//   --quick   减少重复次数与最大规模，供冒烟测试
+//   --root    资源目录的上级目录（默认当前目录，即snow-scene/）
+// 模型导入与TextureFromFile需要GL上下文，用隐藏窗口创建；无法创建时这两类用例记为skipped。
+
+struct BenchResult
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> params;
+    int repeats = 0;
+    double medianMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double items = 0.0;      // 每次重复处理的元素数，用于换算单个元素的耗时
+    std::string skipped;     // 非空时表示未运行及原因
+};
+
+struct BenchOptions
+{
+    std::string out;
+    std::string filter;
+    std::string root = ".";
+    bool quick = false;
+};
+
+BenchOptions options;
+std::vector<BenchResult> results;
+volatile float sink = 0.0f; // 防止被测代码被优化掉
+
+bool selected(const std::string& name)
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+std::string resourcePath(const std::string& relative)
+{
+    return options.root + "/" + relative;
+}
+
+bool fileExists(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return file.good();
+}
+
+// 每次重复前调用setup（不计时），然后计时调用run
+template <class Setup, class Run>
+BenchResult measure(const std::string& name, std::vector<std::pair<std::string, std::string>> params, int repeats,
+                    double items, Setup setup, Run run)
+{
+    BenchResult result;
+    result.name = name;
+    result.params = std::move(params);
+    result.repeats = repeats;
+    result.items = items;
+    std::vector<double> samples;
+    samples.reserve(repeats);
+    for (int i = 0; i < repeats; i++)
+    {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    result.minMs = samples.front();
+    result.maxMs = samples.back();
+    result.medianMs = samples[samples.size() / 2];
+    return result;
+}
+
+BenchResult skip(const std::string& name, std::vector<std::pair<std::string, std::string>> params,
+                 const std::string& reason)
+{
+    BenchResult result;
+    result.name = name;
+    result.params = std::move(params);
+    result.skipped = reason;
+    return result;
+}
+
+void record(const BenchResult& result)
+{
+    results.push_back(result);
+    std::cerr << std::left;
+    std::cerr.width(22);
+    std::cerr << result.name;
+    for (const auto& p : result.params)
+        std::cerr << " " << p.first << "=" << p.second;
+    if (!result.skipped.empty())
+        std::cerr << "  skipped (" << result.skipped << ")" << std::endl;
+    else
+        std::cerr << "  median " << result.medianMs << " ms" << std::endl;
+}
+
+// 雪花更新：1k-1M朵雪花，带风场，不生成、不落地，只测每步的积分开销
+void benchSnowflakes()
+{
+    if (!selected("snowflake_update"))
+        return;
+    WindField wind(WindQuality::Medium, 16.0f);
+    std::vector<uint32_t> counts = {1000, 10000, 100000, 1000000};
+    if (options.quick)
+        counts.pop_back();
+    for (uint32_t count : counts)
+    {
+        SnowflakeGenerator generator(1);
+        generator.spawnRate = 0.0f;
+        generator.yStart = 1.0e6f; // 测量期间不会落地
+        generator.wind = &wind;
+        generator.spawn(count);
+        int repeats = static_cast<int>(std::min<uint32_t>(200, std::max<uint32_t>(10, 20000000u / count)));
+        if (options.quick)
+            repeats = std::min(repeats, 10);
+        record(measure("snowflake_update", {{"flakes", std::to_string(count)}}, repeats, count,
+                       [] {}, [&generator] { generator.update(1.0f / 60.0f); }));
+    }
+}
+
+// 场景图：N个节点每帧全部变化，比较单线程与多线程
+void benchSceneGraph()
+{
+    if (!selected("scene_update"))
+        return;
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts = {1000, 10000, 100000};
+    if (!options.quick)
+        counts.push_back(1000000);
+    for (size_t count : counts)
+    {
+        for (unsigned int threads : {1u, hardware})
+        {
+            SceneGraph scene(threads);
+            int root = scene.add();
+            for (size_t i = 1; i < count; i++)
+                scene.add(root, glm::vec3(static_cast<float>(i % 100), 0.0f, static_cast<float>(i / 100)));
+            scene.update();
+            float angle = 0.0f;
+            int repeats = options.quick ? 5 : 30;
+            record(measure("scene_update", {{"nodes", std::to_string(count)}, {"threads", std::to_string(threads)}},
+                           repeats, static_cast<double>(count),
+                           [&scene, &angle, root]
+                           {
+                               angle += 1.0f;
+                               scene.setRotation(root, glm::vec3(0.0f, angle, 0.0f)); // 整棵树变脏
+                           },
+                           [&scene] { scene.update(); }));
+            if (threads == hardware)
+                break; // 单核机器上两次相同
+        }
+    }
+}
+
+// 拾取：屏幕坐标转射线并与地面求交，与拖动树桩的路径相同
+void benchPicking()
+{
+    if (!selected("picking"))
+        return;
+    const int width = 1280, height = 768;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 3.0f, 15.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), width / static_cast<float>(height), 0.1f, 100.0f);
+    const int rays = options.quick ? 10000 : 100000;
+    record(measure("picking", {{"rays", std::to_string(rays)}}, options.quick ? 5 : 20, rays, [] {},
+                   [&]
+                   {
+                       float sum = 0.0f;
+                       for (int i = 0; i < rays; i++)
+                       {
+                           glm::vec3 direction = ScreenPosToWorldRay(i % width, (i / width) % height, width, height,
+                                                                     view, projection);
+                           glm::vec3 hit = RayPlaneIntersection(glm::vec3(0.0f, 3.0f, 15.0f), direction,
+                                                                glm::vec3(0, 1, 0), glm::vec3(0, 0, 0));
+                           sum += hit.x + hit.z;
+                       }
+                       sink = sum;
+                   }));
+}
+
+const char* textureFiles[] = {
+    "resources/house/textures/Image_0.png",
+    "resources/snowman/snowman_BaseColor.png",
+    "resources/stump/stump-in-winter.fbm/stump_zima_01_100k_DiffuseMap.jpg",
+};
+
+const char* modelFiles[] = {
+    "resources/crystal/crystal.obj",
+    "resources/house/house.obj",
+    "resources/snowman/snowman.obj",
+    "resources/stump/stump-in-winter.fbx",
+};
+
+// TextureFromFile中的解码部分（stb_image），不需要GL
+void benchTextureDecode()
+{
+    if (!selected("texture_decode"))
+        return;
+    for (const char* file : textureFiles)
+    {
+        std::string path = resourcePath(file);
+        if (!fileExists(path))
+        {
+            record(skip("texture_decode", {{"file", file}}, "file not found"));
+            continue;
+        }
+        int width = 0, height = 0, components = 0;
+        record(measure("texture_decode", {{"file", file}}, options.quick ? 2 : 10, 1.0, [] {},
+                       [&]
+                       {
+                           unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 0);
+                           sink = data ? data[0] : 0.0f;
+                           stbi_image_free(data);
+                       }));
+    }
+}
+
+// 原生OBJ解析（不含GL上传），单线程与全部硬件线程对比
+void benchObjParse()
+{
+    if (!selected("obj_parse"))
+        return;
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (const char* file : modelFiles)
+    {
+        std::string path = resourcePath(file);
+        if (!ObjImporter::handles(path))
+            continue;
+        if (!fileExists(path))
+        {
+            record(skip("obj_parse", {{"asset", file}}, "file not found"));
+            continue;
+        }
+        for (unsigned int threads : {1u, hardware})
+        {
+            size_t vertices = 0, peakBytes = 0;
+            ObjImporter importer(threads);
+            importer.minChunkBytes = 1 << 16;
+            record(measure("obj_parse", {{"asset", file}, {"threads", std::to_string(threads)}},
+                           options.quick ? 2 : 10, 1.0, [] {},
+                           [&]
+                           {
+                               memstats::HeapScope heap;
+                               size_t heapStart = memstats::beginHeapPeak();
+                               ObjModel model;
+                               importer.load(path, model);
+                               peakBytes = memstats::heapPeakSince(heapStart);
+                               vertices = 0;
+                               for (const ObjMesh& mesh : model.meshes)
+                                   vertices += mesh.vertices.size();
+                           }));
+            results.back().params.push_back(std::make_pair("vertices", std::to_string(vertices)));
+            results.back().params.push_back(std::make_pair("peak_kb", std::to_string(peakBytes >> 10)));
+            if (hardware == 1)
+                break;
+        }
+    }
+}
+
+// 原生OBJ导入与Assimp路径（标志与Model::loadModel相同）的输出对比：按网格与三角形顺序逐个面顶点比较，
+// 记录两边的网格数、三角形数，以及位置的最大偏差和法线、切线、副切线的最大夹角（度）
+void benchObjVsAssimp()
+{
+    if (!selected("obj_vs_assimp"))
+        return;
+    for (const char* file : modelFiles)
+    {
+        std::string path = resourcePath(file);
+        if (!ObjImporter::handles(path))
+            continue;
+        if (!fileExists(path))
+        {
+            record(skip("obj_vs_assimp", {{"asset", file}}, "file not found"));
+            continue;
+        }
+        ObjModel model;
+        Assimp::Importer importer;
+        const aiScene* scene = nullptr;
+        bool parsed = false;
+        record(measure("obj_vs_assimp", {{"asset", file}}, 1, 1.0, [] {},
+                       [&]
+                       {
+                           ObjImporter obj;
+                           parsed = obj.load(path, model);
+                           scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                                                               aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+                       }));
+        BenchResult& result = results.back();
+        if (!parsed || scene == nullptr)
+        {
+            result.skipped = !parsed ? "native import failed" : "assimp import failed";
+            continue;
+        }
+
+        auto angle = [](const glm::vec3& a, const aiVector3D& b)
+        {
+            glm::vec3 other(b.x, b.y, b.z);
+            float la = glm::length(a), lb = glm::length(other);
+            if (la == 0.0f || lb == 0.0f)
+                return la == lb ? 0.0f : 180.0f; // 只有一边为0时记为最大偏差
+            return glm::degrees(std::acos(glm::clamp(glm::dot(a, other) / (la * lb), -1.0f, 1.0f)));
+        };
+        size_t triangles = 0, assimpTriangles = 0, compared = 0;
+        float position = 0.0f, normal = 0.0f, tangent = 0.0f, bitangent = 0.0f;
+        for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+            assimpTriangles += scene->mMeshes[m]->mNumFaces;
+        for (size_t m = 0; m < model.meshes.size(); m++)
+        {
+            const ObjMesh& mesh = model.meshes[m];
+            triangles += mesh.indices.size() / 3;
+            if (m >= scene->mNumMeshes)
+                continue;
+            const aiMesh* other = scene->mMeshes[m];
+            size_t faceCount = std::min<size_t>(mesh.indices.size() / 3, other->mNumFaces);
+            for (size_t f = 0; f < faceCount; f++)
+            {
+                const aiFace& face = other->mFaces[f];
+                if (face.mNumIndices != 3)
+                    continue;
+                for (unsigned int c = 0; c < 3; c++)
+                {
+                    const Vertex& v = mesh.vertices[mesh.indices[f * 3 + c]];
+                    unsigned int o = face.mIndices[c];
+                    const aiVector3D& p = other->mVertices[o];
+                    position = std::max(position, glm::length(v.Position - glm::vec3(p.x, p.y, p.z)));
+                    if (other->mNormals != nullptr)
+                        normal = std::max(normal, angle(v.Normal, other->mNormals[o]));
+                    if (other->mTangents != nullptr)
+                    {
+                        tangent = std::max(tangent, angle(v.Tangent, other->mTangents[o]));
+                        bitangent = std::max(bitangent, angle(v.Bitangent, other->mBitangents[o]));
+                    }
+                    compared++;
+                }
+            }
+        }
+        result.params.push_back(std::make_pair("meshes", std::to_string(model.meshes.size())));
+        result.params.push_back(std::make_pair("assimp_meshes", std::to_string(scene->mNumMeshes)));
+        result.params.push_back(std::make_pair("triangles", std::to_string(triangles)));
+        result.params.push_back(std::make_pair("assimp_triangles", std::to_string(assimpTriangles)));
+        result.params.push_back(std::make_pair("corners_compared", std::to_string(compared)));
+        result.params.push_back(std::make_pair("max_position_error", std::to_string(position)));
+        result.params.push_back(std::make_pair("max_normal_deg", std::to_string(normal)));
+        result.params.push_back(std::make_pair("max_tangent_deg", std::to_string(tangent)));
+        result.params.push_back(std::make_pair("max_bitangent_deg", std::to_string(bitangent)));
+    }
+}
+
+// 完整的TextureFromFile（解码、上传、生成mipmap）与Model导入，需要GL上下文
+void benchGL(bool hasContext)
+{
+    for (const char* file : textureFiles)
+    {
+        if (!selected("texture_from_file"))
+            break;
+        std::string path = resourcePath(file);
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        std::string directory = path.substr(0, path.find_last_of('/'));
+        if (!hasContext)
+            record(skip("texture_from_file", {{"file", file}}, "no GL context"));
+        else if (!fileExists(path))
+            record(skip("texture_from_file", {{"file", file}}, "file not found"));
+        else
+            record(measure("texture_from_file", {{"file", file}}, options.quick ? 2 : 10, 1.0, [] {},
+                           [&]
+                           {
+                               unsigned int texture = TextureFromFile(name.c_str(), directory);
+                               glFinish();
+                               glDeleteTextures(1, &texture);
+                           }));
+    }
+    for (const char* file : modelFiles)
+    {
+        if (!selected("model_import"))
+            break;
+        std::string path = resourcePath(file);
+        if (!hasContext)
+        {
+            record(skip("model_import", {{"asset", file}}, "no GL context"));
+            continue;
+        }
+        if (!fileExists(path))
+        {
+            record(skip("model_import", {{"asset", file}}, "file not found"));
+            continue;
+        }
+        size_t vertices = 0, peakBytes = 0;
+        record(measure("model_import", {{"asset", file}}, options.quick ? 1 : 5, 1.0, [] {},
+                       [&]
+                       {
+                           Model model(path);
+                           glFinish();
+                           peakBytes = model.importStats.peakBytes;
+                           vertices = 0;
+                           for (const Mesh& mesh : model.meshes)
+                               vertices += mesh.vertices.size();
+                           model.release();
+                       }));
+        results.back().params.push_back(std::make_pair("vertices", std::to_string(vertices)));
+        results.back().params.push_back(std::make_pair("peak_kb", std::to_string(peakBytes >> 10)));
+    }
+}
+
+std::string escape(const std::string& text)
+{
+    std::string out;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+std::string toJSON()
+{
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+#if defined(_MSC_VER)
+    std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+    std::string compiler = std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    std::string compiler = std::string("gcc ") + __VERSION__;
+#else
+    std::string compiler = "unknown";
+#endif
+#ifdef NDEBUG
+    const char* buildType = "release";
+#else
+    const char* buildType = "debug";
+#endif
+
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\n";
+    json << "  \"version\": 1,\n";
+    json << "  \"timestamp\": \"" << timestamp << "\",\n";
+    json << "  \"compiler\": \"" << escape(compiler) << "\",\n";
+    json << "  \"build\": \"" << buildType << "\",\n";
+    json << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    json << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& r = results[i];
+        json << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << r.name << "\", \"params\": {";
+        for (size_t p = 0; p < r.params.size(); p++)
+        {
+            json << (p == 0 ? "" : ", ") << "\"" << escape(r.params[p].first) << "\": \""
+                << escape(r.params[p].second) << "\"";
+        }
+        json << "}";
+        if (!r.skipped.empty())
+        {
+            json << ", \"skipped\": \"" << escape(r.skipped) << "\"}";
+            continue;
+        }
+        json << ", \"repeats\": " << r.repeats << ", \"median_ms\": " << r.medianMs << ", \"min_ms\": " << r.minMs
+            << ", \"max_ms\": " << r.maxMs << ", \"per_item_ns\": " << r.medianMs * 1.0e6 / r.items << "}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+// 隐藏窗口只为取得GL上下文；无显示环境时返回nullptr
+GLFWwindow* createContext()
+{
+    if (!glfwInit())
+        return nullptr;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "snow-bench", nullptr, nullptr);
+    if (window == nullptr)
+        return nullptr;
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        return nullptr;
+    }
+    return window;
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            options.out = argv[++i];
+        else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (std::strcmp(argv[i], "--root") == 0 && i + 1 < argc)
+            options.root = argv[++i];
+        else if (std::strcmp(argv[i], "--quick") == 0)
+            options.quick = true;
+        else
+        {
+            std::cerr << "usage: snow-bench [--out FILE] [--filter NAME] [--quick] [--root DIR]" << std::endl;
+            return 2;
+        }
+    }
+
+    benchSnowflakes();
+    benchSceneGraph();
+    benchPicking();
+    benchTextureDecode();
+    benchObjParse();
+    benchObjVsAssimp();
+    bool needsGL = selected("texture_from_file") || selected("model_import");
+    GLFWwindow* window = needsGL ? createContext() : nullptr;
+    benchGL(window != nullptr);
+    if (window != nullptr)
+        glfwDestroyWindow(window);
+    glfwTerminate();
+
+    std::string json = toJSON();
+    if (options.out.empty())
+    {
+        std::cout << json;
+    }
+    else
+    {
+        std::ofstream file(options.out);
+        file << json;
+        if (!file)
+        {
+            std::cerr << "failed to write " << options.out << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
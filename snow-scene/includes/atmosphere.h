@@ -0,0 +1,183 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "shader.h"
+
+#include <cmath>
+#include <vector>
+
+// 基于物理的大气散射天空
+// 透射率LUT（太阳天顶角 x 海拔）在构造时用GPU渲染一次；天空视图LUT（相对太阳的方位角 x 仰角）只依赖太阳高度，
+// 只有太阳高度变化超过refreshThreshold时才重新渲染，太阳暂停或只绕竖直轴转动时不产生任何开销。
+// 天空盒每像素只采样天空视图LUT一次，太阳圆盘处再采样一次透射率LUT。
+class Atmosphere
+{
+public:
+    static constexpr int TRANSMITTANCE_WIDTH = 256;
+    static constexpr int TRANSMITTANCE_HEIGHT = 64;
+    static constexpr int SKY_VIEW_WIDTH = 192;
+    static constexpr int SKY_VIEW_HEIGHT = 108;
+
+    float viewHeight = 0.2f; // 观察者海拔（千米）
+    float sunIntensity = 1.0f;
+    float exposure = 10.0f;
+    float refreshThreshold = glm::radians(0.5f); // 太阳高度变化超过该角度时刷新天空视图LUT
+
+    unsigned int transmittanceLUT;
+    unsigned int skyViewLUT;
+
+    Atmosphere()
+        : transmittanceShader("shaders/fullscreen-vert.glsl", "shaders/atmosphere-transmittance-frag.glsl"),
+          skyViewShader("shaders/fullscreen-vert.glsl", "shaders/atmosphere-skyview-frag.glsl")
+    {
+        // 全屏三角形由gl_VertexID生成，核心模式下仍需要绑定一个VAO
+        glGenVertexArrays(1, &emptyVAO);
+        glGenFramebuffers(1, &FBO);
+
+        memstats::OwnerScope owner("atmosphere");
+        transmittanceLUT = createLUT(TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, GL_CLAMP_TO_EDGE);
+        skyViewLUT = createLUT(SKY_VIEW_WIDTH, SKY_VIEW_HEIGHT, GL_REPEAT);
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        beginPass(transmittanceLUT, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT);
+        transmittanceShader.use();
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        endPass(viewport[2], viewport[3]);
+    }
+
+    ~Atmosphere()
+    {
+        release();
+    }
+
+    Atmosphere(const Atmosphere&) = delete;
+    Atmosphere& operator=(const Atmosphere&) = delete;
+
+    // 删除两张LUT、FBO与空VAO；main中的实例在GL上下文销毁之前显式调用，之后不能再使用
+    void release()
+    {
+        if (FBO == 0)
+            return;
+        memstats::untrackTexture(transmittanceLUT);
+        memstats::untrackTexture(skyViewLUT);
+        glDeleteTextures(1, &transmittanceLUT);
+        glDeleteTextures(1, &skyViewLUT);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        transmittanceLUT = skyViewLUT = FBO = emptyVAO = 0;
+    }
+
+    // 每帧调用；sunDirection指向太阳，返回本帧是否刷新了天空视图LUT
+    bool update(const glm::vec3& sunDirection, int viewportWidth, int viewportHeight)
+    {
+        sunDir = glm::normalize(sunDirection);
+        float elevation = std::asin(glm::clamp(sunDir.y, -1.0f, 1.0f));
+        if (skyViewValid && std::fabs(elevation - renderedElevation) < refreshThreshold)
+            return false;
+
+        beginPass(skyViewLUT, SKY_VIEW_WIDTH, SKY_VIEW_HEIGHT);
+        skyViewShader.use();
+        skyViewShader.setInt("transmittanceLUT", 0);
+        skyViewShader.setFloat("sunElevation", elevation);
+        skyViewShader.setFloat("viewHeight", viewHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, transmittanceLUT);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        endPass(viewportWidth, viewportHeight);
+
+        renderedElevation = elevation;
+        skyViewValid = true;
+        lutRevision++;
+        return true;
+    }
+
+    const glm::vec3& sunDirection() const
+    {
+        return sunDir;
+    }
+
+    // 天空视图LUT每刷新一次加一，CPU端的LUT副本据此判断是否需要重新读回
+    int revision() const
+    {
+        return lutRevision;
+    }
+
+    // 把两张LUT读回内存（RGBA，行自下而上），供软件光栅化器采样
+    void readLUTs(std::vector<glm::vec4>& transmittance, std::vector<glm::vec4>& skyView) const
+    {
+        transmittance.resize(TRANSMITTANCE_WIDTH * TRANSMITTANCE_HEIGHT);
+        skyView.resize(SKY_VIEW_WIDTH * SKY_VIEW_HEIGHT);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, transmittanceLUT);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, transmittance.data());
+        glBindTexture(GL_TEXTURE_2D, skyViewLUT);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, skyView.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // 设置天空盒着色器所需的uniform与纹理（纹理单元0、1）
+    void bind(const Shader& skyShader) const
+    {
+        skyShader.setInt("skyViewLUT", 0);
+        skyShader.setInt("transmittanceLUT", 1);
+        skyShader.setVec3("sunDirection", sunDir);
+        skyShader.setFloat("sunIntensity", sunIntensity);
+        skyShader.setFloat("viewHeight", viewHeight);
+        skyShader.setFloat("exposure", exposure);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, skyViewLUT);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, transmittanceLUT);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    Shader transmittanceShader;
+    Shader skyViewShader;
+    unsigned int emptyVAO;
+    unsigned int FBO;
+    glm::vec3 sunDir = glm::vec3(0.0f, 1.0f, 0.0f);
+    float renderedElevation = 0.0f;
+    bool skyViewValid = false;
+    int lutRevision = 0;
+
+    static unsigned int createLUT(int width, int height, GLint wrapS)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        memstats::trackTexture(texture, MemoryCategory::RenderTarget, memstats::textureBytes(width, height, 1, 8));
+        return texture;
+    }
+
+    void beginPass(unsigned int target, int width, int height)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+        glViewport(0, 0, width, height);
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(emptyVAO);
+    }
+
+    void endPass(int viewportWidth, int viewportHeight)
+    {
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, viewportWidth, viewportHeight);
+    }
+};
+
+#endif
@@ -0,0 +1,568 @@
+#ifndef COMMANDLIST_H
+#define COMMANDLIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "mesh.h"
+#include "shader.h"
+#include "texturearray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// 线性分配器：按块分配，reset()只把游标归零，已分配的块留到下一帧复用，稳定后每帧不再访问堆。
+// 块的地址在reset之前保持不变，单条记录不跨块。
+class CommandArena
+{
+public:
+    static constexpr size_t ALIGNMENT = 8;
+
+    explicit CommandArena(size_t blockSize = 64 * 1024)
+        : blockSize(blockSize)
+    {
+    }
+
+    CommandArena(const CommandArena&) = delete;
+    CommandArena& operator=(const CommandArena&) = delete;
+
+    void* allocate(size_t size)
+    {
+        size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        while (current < blocks.size() && blocks[current].used + size > blocks[current].size)
+            current++;
+        if (current == blocks.size())
+        {
+            Block block;
+            block.size = std::max(blockSize, size);
+            block.data.reset(new unsigned char[block.size]);
+            blocks.push_back(std::move(block));
+        }
+        Block& block = blocks[current];
+        void* result = block.data.get() + block.used;
+        block.used += size;
+        return result;
+    }
+
+    void reset()
+    {
+        for (Block& block : blocks)
+            block.used = 0;
+        current = 0;
+    }
+
+    // 按分配顺序遍历已用的区间
+    template <class F>
+    void forEachBlock(F f) const
+    {
+        for (size_t i = 0; i <= current && i < blocks.size(); i++)
+        {
+            if (blocks[i].used > 0)
+                f(blocks[i].data.get(), blocks[i].used);
+        }
+    }
+
+    size_t bytesUsed() const
+    {
+        size_t total = 0;
+        for (const Block& block : blocks)
+            total += block.used;
+        return total;
+    }
+
+    size_t bytesReserved() const
+    {
+        size_t total = 0;
+        for (const Block& block : blocks)
+            total += block.size;
+        return total;
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    size_t current = 0;
+};
+
+// 渲染命令列表
+// 录制只把绑定、uniform更新与绘制写进线性内存，不调用任何GL函数，因此可以在工作线程中进行；
+// execute()必须在GL上下文所在的线程调用，按录制顺序回放。
+// uniform名必须是静态存储期的字符串（字面量），回放时按 (Shader指针, 名字指针) 缓存uniform位置；
+// 程序按Shader指针记录，回放时才读取Shader::ID，热重载替换的程序立即生效。
+// 缓存项记下查询时的Shader::generation，热重载之后重新查询（新程序可能复用已删除程序的名字，不能按ID判断）。
+// 网格的绘制在录制时展开为纹理绑定、材质页绑定与按VAO的绘制，回放时不再经过Mesh::Draw；
+// 纹理句柄与材质页在录制时解析，录制到回放之间不能释放网格或修改纹理数组。
+// 需要在回放时才能做的工作（切换FBO、驻留管理等）用call()记录一个函数与参数副本。
+class CommandList
+{
+public:
+    CommandList() = default;
+    CommandList(const CommandList&) = delete;
+    CommandList& operator=(const CommandList&) = delete;
+
+    // 每帧录制前调用，不释放内存
+    void reset()
+    {
+        arena.reset();
+        count = 0;
+    }
+
+    size_t commandCount() const
+    {
+        return count;
+    }
+
+    size_t bytesUsed() const
+    {
+        return arena.bytesUsed();
+    }
+
+    void use(Shader& shader)
+    {
+        push<ShaderCommand>(USE_PROGRAM)->shader = &shader;
+    }
+
+    void setInt(const char* name, int value)
+    {
+        uniform(name, UNIFORM_INT, &value, sizeof(value));
+    }
+
+    void setFloat(const char* name, float value)
+    {
+        uniform(name, UNIFORM_FLOAT, &value, sizeof(value));
+    }
+
+    void setVec2(const char* name, const glm::vec2& value)
+    {
+        uniform(name, UNIFORM_VEC2, glm::value_ptr(value), sizeof(value));
+    }
+
+    void setVec3(const char* name, const glm::vec3& value)
+    {
+        uniform(name, UNIFORM_VEC3, glm::value_ptr(value), sizeof(value));
+    }
+
+    void setVec4(const char* name, const glm::vec4& value)
+    {
+        uniform(name, UNIFORM_VEC4, glm::value_ptr(value), sizeof(value));
+    }
+
+    void setMat3(const char* name, const glm::mat3& value)
+    {
+        uniform(name, UNIFORM_MAT3, glm::value_ptr(value), sizeof(value));
+    }
+
+    void setMat4(const char* name, const glm::mat4& value)
+    {
+        uniform(name, UNIFORM_MAT4, glm::value_ptr(value), sizeof(value));
+    }
+
+    void bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        TextureCommand* c = push<TextureCommand>(BIND_TEXTURE);
+        c->unit = unit;
+        c->target = target;
+        c->texture = texture;
+    }
+
+    void enable(GLenum capability)
+    {
+        push<StateCommand>(ENABLE)->values[0] = capability;
+    }
+
+    void disable(GLenum capability)
+    {
+        push<StateCommand>(DISABLE)->values[0] = capability;
+    }
+
+    void depthFunc(GLenum func)
+    {
+        push<StateCommand>(DEPTH_FUNC)->values[0] = func;
+    }
+
+    void depthMask(bool write)
+    {
+        push<StateCommand>(DEPTH_MASK)->values[0] = write;
+    }
+
+    void colorMask(bool write)
+    {
+        push<StateCommand>(COLOR_MASK)->values[0] = write;
+    }
+
+    void polygonOffset(float factor, float units)
+    {
+        OffsetCommand* c = push<OffsetCommand>(POLYGON_OFFSET);
+        c->factor = factor;
+        c->units = units;
+    }
+
+    // 用当前程序绘制网格，instances为0时非实例化；与Mesh::Draw相同的纹理约定，
+    // 普通纹理依次占用单元0..n并设置texture_diffuseN等采样器，材质纹理解析为纹理数组的页与层
+    void draw(const Mesh& mesh, GLsizei instances = 0)
+    {
+        static const char* const types[SAMPLER_KINDS] = {
+            "texture_diffuse", "texture_specular", "texture_normal", "texture_height"
+        };
+        unsigned int numbers[SAMPLER_KINDS] = {1, 1, 1, 1};
+        int material = -1;
+        for (unsigned int i = 0; i < mesh.textures.size(); i++)
+        {
+            const Texture& texture = mesh.textures[i];
+            if (texture.material >= 0)
+            {
+                material = texture.material;
+                continue;
+            }
+            const char* name = nullptr;
+            for (int kind = 0; kind < SAMPLER_KINDS; kind++)
+            {
+                if (texture.type == types[kind])
+                {
+                    name = samplerName(kind, numbers[kind]++);
+                    break;
+                }
+            }
+            if (name != nullptr)
+                setInt(name, static_cast<int>(i));
+            bindTexture(i, GL_TEXTURE_2D, texture.id);
+        }
+
+        MaterialCommand* m = push<MaterialCommand>(BIND_MATERIAL);
+        TextureArrayPool::instance().resolve(material, m->page, m->layer, m->baseLevel);
+
+        DrawCommand* c = push<DrawCommand>(DRAW_ELEMENTS);
+        c->vao = mesh.VAO;
+        c->count = static_cast<GLsizei>(mesh.indices.size());
+        c->instances = instances;
+    }
+
+    // 回放时调用fn(args)；args按值复制进命令内存，必须可平凡复制
+    template <class T>
+    void call(void (*fn)(const T&), const T& args)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "command arguments are copied bytewise");
+        size_t offset = (sizeof(CallCommand) + alignof(T) - 1) / alignof(T) * alignof(T);
+        CallCommand* c = static_cast<CallCommand*>(allocate(CALL, offset + sizeof(T)));
+        c->invoke = &invokeCall<T>;
+        c->fn = reinterpret_cast<void (*)()>(fn);
+        c->argsOffset = static_cast<uint32_t>(offset);
+        new(reinterpret_cast<unsigned char*>(c) + offset) T(args);
+    }
+
+    void execute()
+    {
+        Shader* current = nullptr;
+        GLuint vao = 0;
+        arena.forEachBlock([this, &current, &vao](const unsigned char* data, size_t size)
+        {
+            for (size_t offset = 0; offset < size;)
+            {
+                const Header* header = reinterpret_cast<const Header*>(data + offset);
+                replay(*header, current, vao);
+                offset += header->size;
+            }
+        });
+        // 与Mesh::Draw一样结束时不留VAO绑定，之后绑定索引缓冲不会改动网格的VAO
+        if (vao != 0)
+            glBindVertexArray(0);
+    }
+
+private:
+    enum Type : uint16_t
+    {
+        USE_PROGRAM,
+        UNIFORM,
+        BIND_TEXTURE,
+        ENABLE,
+        DISABLE,
+        DEPTH_FUNC,
+        DEPTH_MASK,
+        COLOR_MASK,
+        POLYGON_OFFSET,
+        BIND_MATERIAL,
+        DRAW_ELEMENTS,
+        CALL
+    };
+
+    enum UniformType : uint32_t
+    {
+        UNIFORM_INT,
+        UNIFORM_FLOAT,
+        UNIFORM_VEC2,
+        UNIFORM_VEC3,
+        UNIFORM_VEC4,
+        UNIFORM_MAT3,
+        UNIFORM_MAT4
+    };
+
+    // 每条记录以Header开头，size含Header与对齐填充
+    struct Header
+    {
+        uint16_t type;
+        uint16_t reserved;
+        uint32_t size;
+    };
+
+    struct ShaderCommand : Header
+    {
+        Shader* shader;
+    };
+
+    struct UniformCommand : Header
+    {
+        const char* name;
+        uint32_t uniformType;
+        uint32_t padding;
+        // 后接数据
+    };
+
+    struct TextureCommand : Header
+    {
+        GLuint unit;
+        GLenum target;
+        GLuint texture;
+    };
+
+    struct StateCommand : Header
+    {
+        GLuint values[1];
+    };
+
+    struct OffsetCommand : Header
+    {
+        float factor;
+        float units;
+    };
+
+    struct MaterialCommand : Header
+    {
+        GLuint page;
+        float layer;
+        float baseLevel;
+    };
+
+    struct DrawCommand : Header
+    {
+        GLuint vao;
+        GLsizei count;
+        GLsizei instances;
+    };
+
+    struct CallCommand : Header
+    {
+        void (*invoke)(void (*)(), const void*);
+        void (*fn)();
+        uint32_t argsOffset;
+    };
+
+    struct UniformKey
+    {
+        const Shader* shader;
+        const char* name;
+
+        bool operator==(const UniformKey& other) const
+        {
+            return shader == other.shader && name == other.name;
+        }
+    };
+
+    struct UniformKeyHash
+    {
+        size_t operator()(const UniformKey& key) const
+        {
+            return std::hash<const void*>()(key.name) ^ (std::hash<const void*>()(key.shader) * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    struct UniformLocation
+    {
+        unsigned int generation;
+        GLint location;
+    };
+
+    CommandArena arena;
+    size_t count = 0;
+    std::unordered_map<UniformKey, UniformLocation, UniformKeyHash> locations; // 只在回放线程访问
+
+    void* allocate(Type type, size_t size)
+    {
+        size = (size + CommandArena::ALIGNMENT - 1) & ~(CommandArena::ALIGNMENT - 1);
+        Header* header = static_cast<Header*>(arena.allocate(size));
+        header->type = type;
+        header->reserved = 0;
+        header->size = static_cast<uint32_t>(size);
+        count++;
+        return header;
+    }
+
+    template <class T>
+    T* push(Type type)
+    {
+        return static_cast<T*>(allocate(type, sizeof(T)));
+    }
+
+    void uniform(const char* name, UniformType type, const void* data, size_t size)
+    {
+        UniformCommand* c = static_cast<UniformCommand*>(allocate(UNIFORM, sizeof(UniformCommand) + size));
+        c->name = name;
+        c->uniformType = type;
+        std::memcpy(c + 1, data, size);
+    }
+
+    enum
+    {
+        SAMPLER_KINDS = 4,
+        MAX_SAMPLERS = 4
+    };
+
+    // uniform名要求静态存储期，采样器名取自固定的表；超出表的编号在着色器中也没有对应的采样器
+    static const char* samplerName(int kind, unsigned int number)
+    {
+        static const char* const names[SAMPLER_KINDS][MAX_SAMPLERS] = {
+            {"texture_diffuse1", "texture_diffuse2", "texture_diffuse3", "texture_diffuse4"},
+            {"texture_specular1", "texture_specular2", "texture_specular3", "texture_specular4"},
+            {"texture_normal1", "texture_normal2", "texture_normal3", "texture_normal4"},
+            {"texture_height1", "texture_height2", "texture_height3", "texture_height4"}
+        };
+        return number <= MAX_SAMPLERS ? names[kind][number - 1] : nullptr;
+    }
+
+    template <class T>
+    static void invokeCall(void (*fn)(), const void* args)
+    {
+        reinterpret_cast<void (*)(const T&)>(fn)(*static_cast<const T*>(args));
+    }
+
+    GLint location(const Shader& shader, const char* name)
+    {
+        UniformKey key{&shader, name};
+        auto it = locations.find(key);
+        if (it != locations.end() && it->second.generation == shader.generation)
+            return it->second.location;
+        GLint result = glGetUniformLocation(shader.ID, name);
+        locations[key] = UniformLocation{shader.generation, result};
+        return result;
+    }
+
+    void replay(const Header& header, Shader*& current, GLuint& vao)
+    {
+        switch (header.type)
+        {
+        case USE_PROGRAM:
+            current = static_cast<const ShaderCommand&>(header).shader;
+            current->use();
+            break;
+        case UNIFORM:
+            {
+                const UniformCommand& c = static_cast<const UniformCommand&>(header);
+                GLint loc = location(*current, c.name);
+                const void* data = &c + 1;
+                switch (c.uniformType)
+                {
+                case UNIFORM_INT:
+                    glUniform1iv(loc, 1, static_cast<const GLint*>(data));
+                    break;
+                case UNIFORM_FLOAT:
+                    glUniform1fv(loc, 1, static_cast<const GLfloat*>(data));
+                    break;
+                case UNIFORM_VEC2:
+                    glUniform2fv(loc, 1, static_cast<const GLfloat*>(data));
+                    break;
+                case UNIFORM_VEC3:
+                    glUniform3fv(loc, 1, static_cast<const GLfloat*>(data));
+                    break;
+                case UNIFORM_VEC4:
+                    glUniform4fv(loc, 1, static_cast<const GLfloat*>(data));
+                    break;
+                case UNIFORM_MAT3:
+                    glUniformMatrix3fv(loc, 1, GL_FALSE, static_cast<const GLfloat*>(data));
+                    break;
+                case UNIFORM_MAT4:
+                    glUniformMatrix4fv(loc, 1, GL_FALSE, static_cast<const GLfloat*>(data));
+                    break;
+                }
+                break;
+            }
+        case BIND_TEXTURE:
+            {
+                const TextureCommand& c = static_cast<const TextureCommand&>(header);
+                glActiveTexture(GL_TEXTURE0 + c.unit);
+                glBindTexture(c.target, c.texture);
+                glActiveTexture(GL_TEXTURE0);
+                break;
+            }
+        case ENABLE:
+            glEnable(static_cast<const StateCommand&>(header).values[0]);
+            break;
+        case DISABLE:
+            glDisable(static_cast<const StateCommand&>(header).values[0]);
+            break;
+        case DEPTH_FUNC:
+            glDepthFunc(static_cast<const StateCommand&>(header).values[0]);
+            break;
+        case DEPTH_MASK:
+            glDepthMask(static_cast<const StateCommand&>(header).values[0] ? GL_TRUE : GL_FALSE);
+            break;
+        case COLOR_MASK:
+            {
+                GLboolean write = static_cast<const StateCommand&>(header).values[0] ? GL_TRUE : GL_FALSE;
+                glColorMask(write, write, write, write);
+                break;
+            }
+        case POLYGON_OFFSET:
+            {
+                const OffsetCommand& c = static_cast<const OffsetCommand&>(header);
+                glPolygonOffset(c.factor, c.units);
+                break;
+            }
+        case BIND_MATERIAL:
+            {
+                const MaterialCommand& c = static_cast<const MaterialCommand&>(header);
+                TextureArrayPool::instance().bindPage(c.page);
+                glUniform1i(location(*current, "materialPages"), TextureArrayPool::TEXTURE_UNIT);
+                glUniform1f(location(*current, "materialLayer"), c.layer);
+                glUniform1f(location(*current, "materialBaseLevel"), c.baseLevel);
+                break;
+            }
+        case DRAW_ELEMENTS:
+            {
+                const DrawCommand& c = static_cast<const DrawCommand&>(header);
+                if (c.vao != vao)
+                {
+                    glBindVertexArray(c.vao);
+                    vao = c.vao;
+                }
+                if (c.instances > 0)
+                    glDrawElementsInstanced(GL_TRIANGLES, c.count, GL_UNSIGNED_INT, 0, c.instances);
+                else
+                    glDrawElements(GL_TRIANGLES, c.count, GL_UNSIGNED_INT, 0);
+                break;
+            }
+        case CALL:
+            {
+                const CallCommand& c = static_cast<const CallCommand&>(header);
+                c.invoke(c.fn, reinterpret_cast<const unsigned char*>(&c) + c.argsOffset);
+                break;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+enum class UpscaleFilter
+{
+    Bilinear,
+    Sharpen // 双线性后做一次受邻域范围钳制的锐化，缩放较大时保留边缘
+};
+
+enum class FrameTiming
+{
+    GPU, // 缩放渲染部分的GPU耗时（时间戳查询，结果晚几帧到达）
+    CPU  // 整帧的CPU耗时（含交换缓冲区，开启垂直同步时不低于刷新间隔）
+};
+
+struct DynamicResolutionSettings
+{
+    double targetMs = 0.0; // 0表示关闭
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    UpscaleFilter filter = UpscaleFilter::Bilinear;
+    float sharpness = 0.5f;
+    FrameTiming timing = FrameTiming::GPU;
+};
+
+// 动态分辨率
+// 场景渲染到按输出尺寸分配的离屏目标（颜色纹理 + 深度模板），每帧只使用其左下角scale比例的区域，
+// 缩放变化时不重新分配；resolve()把该区域拉伸到默认帧缓冲。
+// 控制器假设耗时与像素数（scale的平方）成正比：每个样本除以其渲染时的scale^2，得到"全分辨率耗时"并做指数平滑，
+// 不受GPU结果延迟几帧、期间缩放已经改变的影响。按它预测当前缩放下的帧时间：超出目标时直接降到预测值为目标的AIM，
+// 每帧至多降MAX_STEP_DOWN；连续INCREASE_DELAY帧低于目标的HEADROOM才缓慢升高（每帧至多MAX_STEP_UP）；
+// 单个样本超出PANIC倍目标时不经平滑、不受MAX_STEP_DOWN限制，立即降到该样本预测的缩放。
+// GPU时间用GL_TIMESTAMP成对查询，不与PROFILE_GPU_SCOPE的GL_TIME_ELAPSED查询冲突，结果只在可用时读取，从不等待GPU。
+class DynamicResolution
+{
+public:
+    enum class State
+    {
+        Stable,
+        Decreasing,
+        Increasing,
+        Holding // 已低于目标，等待足够多的帧再升高
+    };
+
+    struct Stats
+    {
+        float scale = 1.0f;
+        int width = 0; // 本帧渲染尺寸
+        int height = 0;
+        int outputWidth = 0;
+        int outputHeight = 0;
+        double gpuMs = 0.0;      // 最近一次可用的GPU耗时
+        double cpuMs = 0.0;      // 上一帧的CPU耗时
+        double smoothedMs = 0.0; // 按平滑后的全分辨率耗时预测的当前缩放下帧时间
+        double targetMs = 0.0;
+        State state = State::Stable;
+        uint64_t frames = 0;
+        uint64_t changes = 0; // 渲染尺寸改变的次数
+        double scaleSum = 0.0;
+        float lowestScale = 1.0f;
+    };
+
+    static constexpr int QUERY_FRAMES = 4;
+    static constexpr int MIN_SIZE = 64;
+    static constexpr double SMOOTHING = 0.15;
+    static constexpr double HEADROOM = 0.85;
+    static constexpr double AIM = 0.92;
+    static constexpr double PANIC = 1.5;
+    static constexpr float MAX_STEP_DOWN = 0.15f;
+    static constexpr float MAX_STEP_UP = 0.02f;
+    static constexpr int INCREASE_DELAY = 30;
+
+    explicit DynamicResolution(const DynamicResolutionSettings& settings)
+        : settings(settings),
+          upscaleShader("shaders/fullscreen-vert.glsl", "shaders/upscale-frag.glsl")
+    {
+        glGenVertexArrays(1, &emptyVAO);
+        glGenFramebuffers(1, &FBO);
+        glGenTextures(1, &colorTexture);
+        glGenRenderbuffers(1, &depthBuffer);
+        glGenQueries(QUERY_FRAMES * 2, &queries[0][0]);
+        counters.scale = settings.maxScale;
+        counters.targetMs = settings.targetMs;
+    }
+
+    ~DynamicResolution()
+    {
+        memstats::untrackTexture(colorTexture);
+        memstats::untrackRenderbuffer(depthBuffer);
+        glDeleteQueries(QUERY_FRAMES * 2, &queries[0][0]);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteTextures(1, &colorTexture);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // 每帧在使用渲染尺寸（光源分簇、绘制）之前调用：按输出尺寸分配目标，读取已完成的GPU计时并决定本帧缩放
+    void beginFrame(int outputWidth, int outputHeight, double cpuFrameMs)
+    {
+        if (outputWidth > 0 && outputHeight > 0 && (outputWidth != counters.outputWidth || outputHeight != counters.outputHeight))
+            allocate(outputWidth, outputHeight);
+
+        counters.cpuMs = cpuFrameMs;
+        float sampleScale = counters.scale;
+        bool sampled = collect(sampleScale);
+        if (settings.timing == FrameTiming::CPU && counters.frames > 0)
+            control(cpuFrameMs, counters.scale); // 上一帧的缩放尚未改变
+        else if (settings.timing == FrameTiming::GPU && sampled)
+            control(counters.gpuMs, sampleScale);
+
+        int width = std::max(std::min(MIN_SIZE, counters.outputWidth),
+                             static_cast<int>(counters.outputWidth * counters.scale + 0.5f) & ~1);
+        int height = std::max(std::min(MIN_SIZE, counters.outputHeight),
+                              static_cast<int>(counters.outputHeight * counters.scale + 0.5f) & ~1);
+        if (width != counters.width || height != counters.height)
+            counters.changes += counters.frames > 0 ? 1 : 0;
+        counters.width = width;
+        counters.height = height;
+        counters.frames++;
+        counters.scaleSum += counters.scale;
+        counters.lowestScale = std::min(counters.lowestScale, counters.scale);
+    }
+
+    int renderWidth() const
+    {
+        return counters.width;
+    }
+
+    int renderHeight() const
+    {
+        return counters.height;
+    }
+
+    // 开始缩放渲染：绑定离屏目标并把视口设为本帧渲染尺寸
+    void bind()
+    {
+        glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, counters.width, counters.height);
+    }
+
+    // 把渲染区域拉伸到默认帧缓冲并恢复全尺寸视口
+    void resolve()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, counters.outputWidth, counters.outputHeight);
+        glDisable(GL_DEPTH_TEST);
+        upscaleShader.use();
+        upscaleShader.setInt("source", 0);
+        upscaleShader.setVec2("sourceScale", static_cast<float>(counters.width) / counters.outputWidth,
+                              static_cast<float>(counters.height) / counters.outputHeight);
+        upscaleShader.setVec2("texelSize", 1.0f / counters.outputWidth, 1.0f / counters.outputHeight);
+        upscaleShader.setFloat("sharpness", settings.filter == UpscaleFilter::Sharpen ? settings.sharpness : 0.0f);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+        glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+        pending[slot] = true;
+        queryScale[slot] = counters.scale;
+        slot = (slot + 1) % QUERY_FRAMES;
+    }
+
+    const Stats& stats() const
+    {
+        return counters;
+    }
+
+    static const char* stateName(State state)
+    {
+        static const char* names[] = {"stable", "decreasing", "increasing", "holding"};
+        return names[static_cast<int>(state)];
+    }
+
+    std::string summary() const
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "dynamic resolution: scale %.2f (%dx%d of %dx%d), %s, %s %.2f ms (smoothed %.2f) / target %.2f ms, "
+                      "avg scale %.2f, min %.2f, %llu changes",
+                      counters.scale, counters.width, counters.height, counters.outputWidth, counters.outputHeight,
+                      stateName(counters.state), settings.timing == FrameTiming::GPU ? "gpu" : "cpu",
+                      settings.timing == FrameTiming::GPU ? counters.gpuMs : counters.cpuMs, counters.smoothedMs,
+                      counters.targetMs, counters.frames > 0 ? counters.scaleSum / counters.frames : 1.0,
+                      counters.lowestScale, static_cast<unsigned long long>(counters.changes));
+        return line;
+    }
+
+private:
+    DynamicResolutionSettings settings;
+    Shader upscaleShader;
+    Stats counters;
+    unsigned int emptyVAO = 0;
+    unsigned int FBO = 0;
+    unsigned int colorTexture = 0;
+    unsigned int depthBuffer = 0;
+    unsigned int queries[QUERY_FRAMES][2];
+    bool pending[QUERY_FRAMES] = {};
+    float queryScale[QUERY_FRAMES] = {};
+    int slot = 0;
+    int calmFrames = 0;
+    double fullCostMs = 0.0; // 平滑后的全分辨率耗时
+
+    void allocate(int width, int height)
+    {
+        memstats::OwnerScope owner("dynamic resolution");
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        memstats::trackTexture(colorTexture, MemoryCategory::RenderTarget, memstats::textureBytes(width, height, 1, 4));
+        memstats::trackRenderbuffer(depthBuffer, static_cast<size_t>(width) * height * 4);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "dynamic resolution: framebuffer not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        counters.outputWidth = width;
+        counters.outputHeight = height;
+    }
+
+    // 按提交顺序读取已经完成的查询，返回本帧是否得到新的GPU耗时；sampleScale为最新样本渲染时的缩放
+    bool collect(float& sampleScale)
+    {
+        bool sampled = false;
+        for (int i = 0; i < QUERY_FRAMES; i++)
+        {
+            int s = (slot + i) % QUERY_FRAMES; // 从最旧的槽位开始
+            if (!pending[s])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[s][1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(queries[s][0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(queries[s][1], GL_QUERY_RESULT, &end);
+            counters.gpuMs = static_cast<double>(end - start) * 1e-6;
+            sampleScale = queryScale[s];
+            pending[s] = false;
+            sampled = true;
+        }
+        return sampled;
+    }
+
+    void control(double measuredMs, float sampleScale)
+    {
+        const double target = settings.targetMs;
+        const double area = static_cast<double>(sampleScale) * sampleScale;
+        const double cost = measuredMs / area;
+        fullCostMs = fullCostMs <= 0.0 ? cost : fullCostMs + SMOOTHING * (cost - fullCostMs);
+
+        float scale = counters.scale;
+        double predicted = fullCostMs * scale * scale;
+        counters.smoothedMs = predicted;
+        float desired = scale;
+        bool panic = false;
+        if (measuredMs > target * PANIC)
+        {
+            panic = true;
+            desired = static_cast<float>(std::sqrt(target * AIM / cost));
+            counters.state = State::Decreasing;
+            calmFrames = 0;
+        }
+        else if (predicted > target)
+        {
+            desired = static_cast<float>(std::sqrt(target * AIM / fullCostMs));
+            counters.state = State::Decreasing;
+            calmFrames = 0;
+        }
+        else if (predicted < target * HEADROOM && scale < settings.maxScale)
+        {
+            if (++calmFrames >= INCREASE_DELAY)
+            {
+                desired = static_cast<float>(std::sqrt(target * AIM / fullCostMs));
+                counters.state = State::Increasing;
+            }
+            else
+            {
+                counters.state = State::Holding;
+            }
+        }
+        else
+        {
+            counters.state = State::Stable;
+            calmFrames = 0;
+        }
+        desired = glm::clamp(desired, panic ? 0.0f : scale * (1.0f - MAX_STEP_DOWN), scale * (1.0f + MAX_STEP_UP));
+        counters.scale = glm::clamp(desired, settings.minScale, settings.maxScale);
+    }
+};
+
+#endif
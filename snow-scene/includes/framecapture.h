@@ -0,0 +1,431 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <glad/glad.h>
+
+#include "glstats.h"
+#include "memstats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+enum class ImageFormat
+{
+    PPM, // 二进制P6，编码最快
+    PNG  // 未压缩的deflate存储块，任何看图软件都能打开
+};
+
+// 离屏渲染到图片序列
+// 场景渲染到固定分辨率的FBO；capture()把颜色缓冲经glReadPixels异步读入PBO环中的下一个槽位并插入fence，
+// 立即返回，GPU在渲染下一帧的同时完成拷贝。槽位在fence完成后才被映射，映射时数据已经就绪，不会阻塞驱动；
+// 只有整个环都在等待GPU时capture()才会等待最旧的槽位（计入stalls）。
+// 映射出的像素拷贝到CPU缓冲后交给编码线程翻转、转换并写文件；编码积压超过maxQueued时渲染线程等待编码线程。
+class FrameCapture
+{
+public:
+    const int width;
+    const int height;
+    size_t maxQueued = 8;
+
+    FrameCapture(int width, int height, const std::string& directory, ImageFormat format = ImageFormat::PPM,
+                 int ringSize = 3, int encoderCount = 2)
+        : width(width),
+          height(height),
+          directory(directory),
+          format(format),
+          slots(ringSize)
+    {
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+
+        memstats::OwnerScope owner("frame capture");
+        glGenFramebuffers(1, &FBO);
+        glGenRenderbuffers(1, &colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        memstats::trackRenderbuffer(colorBuffer, static_cast<size_t>(width) * height * 4);
+        memstats::trackRenderbuffer(depthBuffer, static_cast<size_t>(width) * height * 4);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "frame capture: framebuffer not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (Slot& slot : slots)
+        {
+            glGenBuffers(1, &slot.pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes(), nullptr, GL_STREAM_READ);
+            memstats::trackBuffer(slot.pbo, MemoryCategory::StreamBuffer, frameBytes());
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        for (int i = 0; i < encoderCount; i++)
+            encoders.emplace_back(&FrameCapture::encoderLoop, this);
+    }
+
+    ~FrameCapture()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : encoders)
+            t.join();
+
+        for (Slot& slot : slots)
+        {
+            if (slot.fence != nullptr)
+                glDeleteSync(slot.fence);
+            memstats::untrackBuffer(slot.pbo);
+            glDeleteBuffers(1, &slot.pbo);
+        }
+        memstats::untrackRenderbuffer(colorBuffer);
+        memstats::untrackRenderbuffer(depthBuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteFramebuffers(1, &FBO);
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // 绑定离屏目标，之后的绘制写入FBO
+    void bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+    }
+
+    // 本帧绘制完成后调用：发起异步读回，frame决定文件名
+    void capture(int frame)
+    {
+        // 先回收已经完成的槽位，尽早交给编码线程
+        poll();
+
+        Slot& slot = slots[nextSlot];
+        if (slot.fence != nullptr)
+        {
+            stallCount++;
+            retrieve(slot, true);
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // 目标是PBO，立即返回
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+        nextSlot = (nextSlot + 1) % slots.size();
+    }
+
+    // 等待所有读回与编码完成
+    void finish()
+    {
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            Slot& slot = slots[(nextSlot + i) % slots.size()];
+            if (slot.fence != nullptr)
+                retrieve(slot, true);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this] { return queue.empty() && busyEncoders == 0; });
+    }
+
+    size_t framesWritten() const
+    {
+        return written.load();
+    }
+
+    // capture()因整个PBO环都未完成而等待的次数
+    size_t stalls() const
+    {
+        return stallCount;
+    }
+
+private:
+    struct Slot
+    {
+        unsigned int pbo = 0;
+        GLsync fence = nullptr;
+        int frame = 0;
+    };
+
+    struct Job
+    {
+        int frame;
+        std::vector<unsigned char> pixels; // RGBA，自下而上
+    };
+
+    std::string directory;
+    ImageFormat format;
+    unsigned int FBO = 0, colorBuffer = 0, depthBuffer = 0;
+    std::vector<Slot> slots;
+    size_t nextSlot = 0;
+    size_t stallCount = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::deque<Job> queue;
+    std::vector<std::vector<unsigned char>> pool; // 编码完成后归还的像素缓冲
+    int busyEncoders = 0;
+    bool stopping = false;
+    std::vector<std::thread> encoders;
+    std::atomic<size_t> written{0};
+
+    size_t frameBytes() const
+    {
+        return static_cast<size_t>(width) * height * 4;
+    }
+
+    // 回收fence已经完成的槽位，不等待
+    void poll()
+    {
+        for (Slot& slot : slots)
+        {
+            if (slot.fence != nullptr && glClientWaitSync(slot.fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+                retrieve(slot, false);
+        }
+    }
+
+    void retrieve(Slot& slot, bool wait)
+    {
+        if (wait)
+        {
+            while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+            {
+            }
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        std::vector<unsigned char> pixels;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // 编码跟不上时在这里等待，而不是让积压的帧无限占用内存
+            drained.wait(lock, [this] { return queue.size() < maxQueued; });
+            if (!pool.empty())
+            {
+                pixels = std::move(pool.back());
+                pool.pop_back();
+            }
+        }
+        pixels.resize(frameBytes());
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(frameBytes()),
+                                        GL_MAP_READ_BIT);
+        if (mapped != nullptr)
+        {
+            std::memcpy(pixels.data(), mapped, frameBytes());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Job{slot.frame, std::move(pixels)});
+        }
+        wake.notify_one();
+    }
+
+    void encoderLoop()
+    {
+        std::vector<unsigned char> rgb;
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                job = std::move(queue.front());
+                queue.pop_front();
+                busyEncoders++;
+            }
+
+            // 翻转为自上而下并去掉alpha
+            rgb.resize(static_cast<size_t>(width) * height * 3);
+            for (int y = 0; y < height; y++)
+            {
+                const unsigned char* src = job.pixels.data() + static_cast<size_t>(height - 1 - y) * width * 4;
+                unsigned char* dst = rgb.data() + static_cast<size_t>(y) * width * 3;
+                for (int x = 0; x < width; x++)
+                {
+                    dst[x * 3 + 0] = src[x * 4 + 0];
+                    dst[x * 3 + 1] = src[x * 4 + 1];
+                    dst[x * 3 + 2] = src[x * 4 + 2];
+                }
+            }
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "frame_%05d.%s", job.frame, format == ImageFormat::PNG ? "png" : "ppm");
+            std::string path = directory + '/' + name;
+            bool ok = format == ImageFormat::PNG ? writePNG(path, rgb) : writePPM(path, rgb);
+            if (ok)
+                written++;
+            else
+                std::cout << "frame capture: failed to write " << path << std::endl;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pool.push_back(std::move(job.pixels));
+                busyEncoders--;
+            }
+            drained.notify_all();
+        }
+    }
+
+    bool writePPM(const std::string& path, const std::vector<unsigned char>& rgb) const
+    {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+        bool ok = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+    {
+        static uint32_t table[256];
+        static std::once_flag once;
+        std::call_once(once, []
+        {
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+        });
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    // 每5552字节取一次模，累加不会溢出32位
+    static uint32_t adler32(const std::vector<unsigned char>& data)
+    {
+        uint32_t a = 1, b = 0;
+        for (size_t offset = 0; offset < data.size(); offset += 5552)
+        {
+            size_t end = std::min(data.size(), offset + 5552);
+            for (size_t i = offset; i < end; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static void putBigEndian(std::vector<unsigned char>& out, uint32_t value)
+    {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    static void putChunk(FILE* file, const char* type, const std::vector<unsigned char>& data)
+    {
+        std::vector<unsigned char> header;
+        putBigEndian(header, static_cast<uint32_t>(data.size()));
+        header.insert(header.end(), type, type + 4);
+        uint32_t crc = crc32(header.data() + 4, 4);
+        crc = crc32(data.data(), data.size(), crc);
+        std::vector<unsigned char> footer;
+        putBigEndian(footer, crc);
+        std::fwrite(header.data(), 1, header.size(), file);
+        if (!data.empty())
+            std::fwrite(data.data(), 1, data.size(), file);
+        std::fwrite(footer.data(), 1, footer.size(), file);
+    }
+
+    // zlib流使用deflate存储块（不压缩），编码开销只有拷贝与校验和
+    bool writePNG(const std::string& path, const std::vector<unsigned char>& rgb) const
+    {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+        const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        std::fwrite(signature, 1, sizeof(signature), file);
+
+        std::vector<unsigned char> ihdr;
+        putBigEndian(ihdr, static_cast<uint32_t>(width));
+        putBigEndian(ihdr, static_cast<uint32_t>(height));
+        const unsigned char ihdrTail[5] = {8, 2, 0, 0, 0}; // 8位，RGB，deflate，无滤波方式，不隔行
+        ihdr.insert(ihdr.end(), ihdrTail, ihdrTail + 5);
+        putChunk(file, "IHDR", ihdr);
+
+        // 每行前加滤波类型0
+        size_t rowBytes = static_cast<size_t>(width) * 3;
+        std::vector<unsigned char> raw;
+        raw.reserve((rowBytes + 1) * height);
+        for (int y = 0; y < height; y++)
+        {
+            raw.push_back(0);
+            raw.insert(raw.end(), rgb.begin() + y * rowBytes, rgb.begin() + (y + 1) * rowBytes);
+        }
+
+        std::vector<unsigned char> idat;
+        idat.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+        size_t offset = 0;
+        for (;;)
+        {
+            size_t block = std::min<size_t>(65535, raw.size() - offset);
+            bool last = offset + block == raw.size();
+            idat.push_back(last ? 1 : 0);
+            idat.push_back(static_cast<unsigned char>(block));
+            idat.push_back(static_cast<unsigned char>(block >> 8));
+            idat.push_back(static_cast<unsigned char>(~block));
+            idat.push_back(static_cast<unsigned char>(~block >> 8));
+            idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + block);
+            offset += block;
+            if (last)
+                break;
+        }
+        putBigEndian(idat, adler32(raw));
+        putChunk(file, "IDAT", idat);
+        putChunk(file, "IEND", std::vector<unsigned char>());
+        return std::fclose(file) == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef GLSTATS_H
+#define GLSTATS_H
+
+// 渲染统计拦截层
+// 编译时定义 SNOW_GL_STATS 启用。启用后本头文件把项目用到的GL入口重定义为带计数的薄封装，
+// 统计每帧与每个渲染阶段的绘制调用、提交三角形、程序切换、纹理绑定、uniform上传和缓冲上传字节数。
+// 必须在 glad/glad.h 之后包含；凡是发出GL调用的头文件都应包含它。
+//
+//   GLSTATS_FRAME_BEGIN();      每帧开始
+//   GLSTATS_FRAME_END();        每帧结束，结果通过 glstats::lastFrame() 读取
+//   GLSTATS_PASS("name");       所在作用域内的调用计入该阶段
+//
+// 计数状态每个线程一份：着色器热重载线程在自己的共享上下文中发出的调用不与渲染线程竞争，
+// 也不计入渲染线程的帧统计；帧的开始、结束与读取都在渲染线程上进行。
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+struct RenderCounters
+{
+    uint64_t drawCalls = 0;
+    uint64_t triangles = 0;
+    uint64_t programSwitches = 0;
+    uint64_t textureBinds = 0;
+    uint64_t uniformUploads = 0;
+    uint64_t bufferBytes = 0;
+};
+
+struct FrameRenderStats
+{
+    static constexpr int MAX_PASSES = 16;
+
+    RenderCounters total;
+    RenderCounters passes[MAX_PASSES];
+    const char* passNames[MAX_PASSES] = {};
+    int passCount = 0;
+};
+
+#ifdef SNOW_GL_STATS
+
+namespace glstats
+{
+    struct Context
+    {
+        FrameRenderStats current;
+        FrameRenderStats last;
+        int activePass = -1;
+        GLuint boundProgram = 0;
+    };
+
+    // 当前线程的计数状态（每个GL上下文只在一个线程上使用，已绑定的程序也按线程记录）
+    inline Context& context()
+    {
+        static thread_local Context ctx;
+        return ctx;
+    }
+
+    inline const FrameRenderStats& lastFrame()
+    {
+        return context().last;
+    }
+
+    inline void beginFrame()
+    {
+        Context& ctx = context();
+        ctx.current = FrameRenderStats();
+        ctx.activePass = -1;
+    }
+
+    inline void endFrame()
+    {
+        Context& ctx = context();
+        ctx.last = ctx.current;
+    }
+
+    // 同名阶段在一帧内多次出现时累加到同一项
+    inline int beginPass(const char* name)
+    {
+        Context& ctx = context();
+        int previous = ctx.activePass;
+        FrameRenderStats& frame = ctx.current;
+        for (int i = 0; i < frame.passCount; i++)
+        {
+            if (frame.passNames[i] == name || std::string(frame.passNames[i]) == name)
+            {
+                ctx.activePass = i;
+                return previous;
+            }
+        }
+        if (frame.passCount < FrameRenderStats::MAX_PASSES)
+        {
+            frame.passNames[frame.passCount] = name;
+            ctx.activePass = frame.passCount++;
+        }
+        return previous;
+    }
+
+    inline void endPass(int previous)
+    {
+        context().activePass = previous;
+    }
+
+    // 对当前帧总计与当前阶段同时计数
+    template <typename F>
+    inline void count(F update)
+    {
+        Context& ctx = context();
+        update(ctx.current.total);
+        if (ctx.activePass >= 0)
+            update(ctx.current.passes[ctx.activePass]);
+    }
+
+    inline uint64_t trianglesFor(GLenum mode, GLsizei count)
+    {
+        if (mode == GL_TRIANGLES)
+            return static_cast<uint64_t>(count / 3);
+        if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN)
+            return count > 2 ? static_cast<uint64_t>(count - 2) : 0;
+        return 0;
+    }
+
+    inline void countDraw(GLenum mode, GLsizei count, GLsizei instances)
+    {
+        uint64_t triangles = trianglesFor(mode, count) * static_cast<uint64_t>(instances);
+        glstats::count([triangles](RenderCounters& c)
+        {
+            c.drawCalls++;
+            c.triangles += triangles;
+        });
+    }
+
+    inline void DrawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+        countDraw(mode, count, 1);
+        glad_glDrawArrays(mode, first, count);
+    }
+
+    inline void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        countDraw(mode, count, 1);
+        glad_glDrawElements(mode, count, type, indices);
+    }
+
+    inline void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+    {
+        countDraw(mode, count, instances);
+        glad_glDrawArraysInstanced(mode, first, count, instances);
+    }
+
+    inline void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                      GLsizei instances)
+    {
+        countDraw(mode, count, instances);
+        glad_glDrawElementsInstanced(mode, count, type, indices, instances);
+    }
+
+    // 只统计真正改变了当前程序的调用
+    inline void UseProgram(GLuint program)
+    {
+        Context& ctx = context();
+        if (program != ctx.boundProgram)
+        {
+            ctx.boundProgram = program;
+            count([](RenderCounters& c) { c.programSwitches++; });
+        }
+        glad_glUseProgram(program);
+    }
+
+    inline void BindTexture(GLenum target, GLuint texture)
+    {
+        count([](RenderCounters& c) { c.textureBinds++; });
+        glad_glBindTexture(target, texture);
+    }
+
+    inline void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+    {
+        if (data != nullptr)
+            count([size](RenderCounters& c) { c.bufferBytes += static_cast<uint64_t>(size); });
+        glad_glBufferData(target, size, data, usage);
+    }
+
+    inline void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        count([size](RenderCounters& c) { c.bufferBytes += static_cast<uint64_t>(size); });
+        glad_glBufferSubData(target, offset, size, data);
+    }
+
+#define GLSTATS_UNIFORM_WRAPPER(name) \
+    template <typename... Args> \
+    inline void name(Args... args) \
+    { \
+        count([](RenderCounters& c) { c.uniformUploads++; }); \
+        glad_gl##name(args...); \
+    }
+
+    GLSTATS_UNIFORM_WRAPPER(Uniform1i)
+    GLSTATS_UNIFORM_WRAPPER(Uniform1f)
+    GLSTATS_UNIFORM_WRAPPER(Uniform2f)
+    GLSTATS_UNIFORM_WRAPPER(Uniform2fv)
+    GLSTATS_UNIFORM_WRAPPER(Uniform3f)
+    GLSTATS_UNIFORM_WRAPPER(Uniform3fv)
+    GLSTATS_UNIFORM_WRAPPER(Uniform4f)
+    GLSTATS_UNIFORM_WRAPPER(Uniform4fv)
+    GLSTATS_UNIFORM_WRAPPER(UniformMatrix2fv)
+    GLSTATS_UNIFORM_WRAPPER(UniformMatrix3fv)
+    GLSTATS_UNIFORM_WRAPPER(UniformMatrix4fv)
+
+#undef GLSTATS_UNIFORM_WRAPPER
+
+    // 单行摘要，可用于窗口标题或日志
+    inline std::string summary(const FrameRenderStats& stats)
+    {
+        char line[256];
+        const RenderCounters& t = stats.total;
+        std::snprintf(line, sizeof(line),
+                      "draws %llu | tris %llu | programs %llu | tex binds %llu | uniforms %llu | upload %.1f KB",
+                      static_cast<unsigned long long>(t.drawCalls), static_cast<unsigned long long>(t.triangles),
+                      static_cast<unsigned long long>(t.programSwitches),
+                      static_cast<unsigned long long>(t.textureBinds),
+                      static_cast<unsigned long long>(t.uniformUploads), t.bufferBytes / 1024.0);
+        return line;
+    }
+
+    // 多行报告，逐阶段列出计数
+    inline std::string report(const FrameRenderStats& stats)
+    {
+        std::string text = "frame: " + summary(stats) + "\n";
+        char line[256];
+        for (int i = 0; i < stats.passCount; i++)
+        {
+            const RenderCounters& p = stats.passes[i];
+            std::snprintf(line, sizeof(line), "  %-16s draws %6llu  tris %9llu  programs %4llu  tex %5llu  "
+                          "uniforms %6llu  upload %8.1f KB\n", stats.passNames[i],
+                          static_cast<unsigned long long>(p.drawCalls),
+                          static_cast<unsigned long long>(p.triangles),
+                          static_cast<unsigned long long>(p.programSwitches),
+                          static_cast<unsigned long long>(p.textureBinds),
+                          static_cast<unsigned long long>(p.uniformUploads), p.bufferBytes / 1024.0);
+            text += line;
+        }
+        return text;
+    }
+
+    class PassScope
+    {
+    public:
+        explicit PassScope(const char* name) : previous(beginPass(name))
+        {
+        }
+
+        ~PassScope()
+        {
+            endPass(previous);
+        }
+
+        PassScope(const PassScope&) = delete;
+        PassScope& operator=(const PassScope&) = delete;
+
+    private:
+        int previous;
+    };
+}
+
+#undef glDrawArrays
+#undef glDrawElements
+#undef glDrawArraysInstanced
+#undef glDrawElementsInstanced
+#undef glUseProgram
+#undef glBindTexture
+#undef glBufferData
+#undef glBufferSubData
+#undef glUniform1i
+#undef glUniform1f
+#undef glUniform2f
+#undef glUniform2fv
+#undef glUniform3f
+#undef glUniform3fv
+#undef glUniform4f
+#undef glUniform4fv
+#undef glUniformMatrix2fv
+#undef glUniformMatrix3fv
+#undef glUniformMatrix4fv
+
+#define glDrawArrays glstats::DrawArrays
+#define glDrawElements glstats::DrawElements
+#define glDrawArraysInstanced glstats::DrawArraysInstanced
+#define glDrawElementsInstanced glstats::DrawElementsInstanced
+#define glUseProgram glstats::UseProgram
+#define glBindTexture glstats::BindTexture
+#define glBufferData glstats::BufferData
+#define glBufferSubData glstats::BufferSubData
+#define glUniform1i glstats::Uniform1i
+#define glUniform1f glstats::Uniform1f
+#define glUniform2f glstats::Uniform2f
+#define glUniform2fv glstats::Uniform2fv
+#define glUniform3f glstats::Uniform3f
+#define glUniform3fv glstats::Uniform3fv
+#define glUniform4f glstats::Uniform4f
+#define glUniform4fv glstats::Uniform4fv
+#define glUniformMatrix2fv glstats::UniformMatrix2fv
+#define glUniformMatrix3fv glstats::UniformMatrix3fv
+#define glUniformMatrix4fv glstats::UniformMatrix4fv
+
+#define GLSTATS_CONCAT_INNER(a, b) a##b
+#define GLSTATS_CONCAT(a, b) GLSTATS_CONCAT_INNER(a, b)
+#define GLSTATS_FRAME_BEGIN() glstats::beginFrame()
+#define GLSTATS_FRAME_END() glstats::endFrame()
+#define GLSTATS_PASS(name) glstats::PassScope GLSTATS_CONCAT(glstatsPass, __LINE__)(name)
+
+#else
+
+#define GLSTATS_FRAME_BEGIN() ((void)0)
+#define GLSTATS_FRAME_END() ((void)0)
+#define GLSTATS_PASS(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "shader.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// 分簇光照使用的纹理单元：簇表、光源索引表、光源数据
+const int CLUSTER_GRID_TEXTURE_UNIT = 11;
+const int CLUSTER_INDEX_TEXTURE_UNIT = 12;
+const int CLUSTER_LIGHT_TEXTURE_UNIT = 13;
+
+struct PointLight
+{
+    glm::vec3 position;
+    float radius; // 影响半径，超出后贡献为0
+    glm::vec3 color; // 已乘强度
+};
+
+// 分簇前向光照
+// 视锥按屏幕tile与指数分布的深度切片划分为froxel（默认16x9x24），每帧在CPU上把点光源分配到与其包围球相交的簇。
+// 光源在视空间中按分量（SoA）存放，对每个簇先逐光源计算相交掩码（无分支，可自动向量化），再压缩成索引列表；
+// 深度切片分给常驻的工作线程（构造时创建，渲染线程也参与），各段写自己的索引数组，最后按前缀和拼接。
+// 结果经三个纹理缓冲交给片段着色器：簇表（RG32UI：偏移、数量）、索引表（R32UI）、光源数据（RGBA32F，每光源两个texel），
+// 片段根据gl_FragCoord与视空间深度找到所在簇，只遍历该簇的光源。
+class ClusteredLights
+{
+public:
+    static constexpr int TILES_X = 16;
+    static constexpr int TILES_Y = 9;
+    static constexpr int SLICES = 24;
+    static constexpr int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+    static constexpr int MAX_LIGHTS_PER_CLUSTER = 128;
+
+    std::vector<PointLight> lights;
+    size_t parallelThreshold = 64; // 光源数达到该值才把深度切片分给多个线程
+
+    ClusteredLights(unsigned int threadCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency())))
+        : workers(threadCount),
+          grid(CLUSTER_COUNT * 2)
+    {
+    }
+
+    ~ClusteredLights()
+    {
+        release();
+    }
+
+    ClusteredLights(const ClusteredLights&) = delete;
+    ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+    // 删除纹理缓冲（纹理单元11-13上的TBO）；全局实例在GL上下文销毁之前显式调用，之后update()会重新创建
+    void release()
+    {
+        if (textures[0] == 0)
+            return;
+        for (int i = 0; i < 3; i++)
+            memstats::untrackBuffer(buffers[i]);
+        glDeleteTextures(3, textures);
+        glDeleteBuffers(3, buffers);
+        for (int i = 0; i < 3; i++)
+            buffers[i] = textures[i] = 0;
+    }
+
+    // 每帧调用：分配光源并上传；投影参数改变时重建簇的包围盒
+    void update(const glm::mat4& view, float fovy, float aspect, float nearPlane, float farPlane)
+    {
+        if (fovy != cachedFovy || aspect != cachedAspect || nearPlane != cachedNear || farPlane != cachedFar)
+            buildClusterBounds(fovy, aspect, nearPlane, farPlane);
+
+        // 视空间光源，深度取正值
+        size_t n = lights.size();
+        lightX.resize(n);
+        lightY.resize(n);
+        lightDepth.resize(n);
+        lightRadius.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            glm::vec4 p = view * glm::vec4(lights[i].position, 1.0f);
+            lightX[i] = p.x;
+            lightY[i] = p.y;
+            lightDepth[i] = -p.z;
+            lightRadius[i] = lights[i].radius;
+        }
+
+        // 深度切片分成若干段，在常驻线程池上处理（渲染线程也参与）
+        size_t ranges = n < parallelThreshold ? 1 : std::min<size_t>(workers.size(), SLICES);
+        workerIndices.resize(ranges);
+        int slicesPerWorker = (SLICES + static_cast<int>(ranges) - 1) / static_cast<int>(ranges);
+        workers.parallelFor(ranges, [this, slicesPerWorker](size_t w)
+        {
+            assignSlices(static_cast<int>(w) * slicesPerWorker,
+                         std::min(SLICES, static_cast<int>(w + 1) * slicesPerWorker), w);
+        });
+
+        // 拼接各段的索引，修正簇表中的偏移
+        indices.clear();
+        for (size_t w = 0; w < ranges; w++)
+        {
+            uint32_t base = static_cast<uint32_t>(indices.size());
+            int first = static_cast<int>(w) * slicesPerWorker;
+            int last = std::min(SLICES, first + slicesPerWorker);
+            for (int c = first * TILES_X * TILES_Y; c < last * TILES_X * TILES_Y; c++)
+                grid[c * 2] += base;
+            indices.insert(indices.end(), workerIndices[w].begin(), workerIndices[w].end());
+        }
+        if (indices.empty())
+            indices.push_back(0); // 空缓冲不能作为纹理缓冲的存储
+
+        upload();
+    }
+
+    void bind(const Shader& shader) const
+    {
+        shader.setInt("clusterGrid", CLUSTER_GRID_TEXTURE_UNIT);
+        shader.setInt("clusterIndices", CLUSTER_INDEX_TEXTURE_UNIT);
+        shader.setInt("clusterLights", CLUSTER_LIGHT_TEXTURE_UNIT);
+        shader.setVec2("clusterTileSize", tileSize);
+        shader.setFloat("clusterNear", cachedNear);
+        shader.setFloat("clusterLogScale", logScale);
+        glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[0]);
+        glActiveTexture(GL_TEXTURE0 + CLUSTER_INDEX_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[1]);
+        glActiveTexture(GL_TEXTURE0 + CLUSTER_LIGHT_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[2]);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // 视口尺寸改变时调用，决定片段坐标到tile的映射
+    void setViewport(int width, int height)
+    {
+        tileSize = glm::vec2(static_cast<float>(width) / TILES_X, static_cast<float>(height) / TILES_Y);
+    }
+
+    // 上一次update()写入的光源索引总数
+    size_t assignedCount() const
+    {
+        return indices.size();
+    }
+
+private:
+    WorkerPool workers;
+    float cachedFovy = 0.0f, cachedAspect = 0.0f, cachedNear = 0.0f, cachedFar = 0.0f;
+    float logScale = 0.0f; // slice = log(depth / near) * logScale
+    glm::vec2 tileSize = glm::vec2(1.0f);
+
+    // 簇的视空间包围盒（x、y与正深度），按 slice * TILES_X * TILES_Y + y * TILES_X + x 排列
+    std::vector<float> minX, maxX, minY, maxY;
+    std::vector<float> sliceNear, sliceFar;
+
+    std::vector<float> lightX, lightY, lightDepth, lightRadius;
+    std::vector<uint32_t> grid; // 每簇 (偏移, 数量)
+    std::vector<std::vector<uint32_t>> workerIndices;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec4> lightData;
+
+    unsigned int buffers[3] = {0, 0, 0};
+    unsigned int textures[3] = {0, 0, 0};
+
+    void buildClusterBounds(float fovy, float aspect, float nearPlane, float farPlane)
+    {
+        cachedFovy = fovy;
+        cachedAspect = aspect;
+        cachedNear = nearPlane;
+        cachedFar = farPlane;
+        logScale = SLICES / std::log(farPlane / nearPlane);
+
+        sliceNear.resize(SLICES);
+        sliceFar.resize(SLICES);
+        for (int z = 0; z < SLICES; z++)
+        {
+            sliceNear[z] = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / SLICES);
+            sliceFar[z] = nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / SLICES);
+        }
+
+        float tanY = std::tan(fovy * 0.5f), tanX = tanY * aspect;
+        minX.resize(CLUSTER_COUNT);
+        maxX.resize(CLUSTER_COUNT);
+        minY.resize(CLUSTER_COUNT);
+        maxY.resize(CLUSTER_COUNT);
+        for (int z = 0; z < SLICES; z++)
+        {
+            for (int y = 0; y < TILES_Y; y++)
+            {
+                for (int x = 0; x < TILES_X; x++)
+                {
+                    // tile在深度1处的范围，再按切片的近、远深度缩放，取两者的并集
+                    float x0 = (2.0f * x / TILES_X - 1.0f) * tanX, x1 = (2.0f * (x + 1) / TILES_X - 1.0f) * tanX;
+                    float y0 = (2.0f * y / TILES_Y - 1.0f) * tanY, y1 = (2.0f * (y + 1) / TILES_Y - 1.0f) * tanY;
+                    int c = (z * TILES_Y + y) * TILES_X + x;
+                    minX[c] = std::min(x0 * sliceNear[z], x0 * sliceFar[z]);
+                    maxX[c] = std::max(x1 * sliceNear[z], x1 * sliceFar[z]);
+                    minY[c] = std::min(y0 * sliceNear[z], y0 * sliceFar[z]);
+                    maxY[c] = std::max(y1 * sliceNear[z], y1 * sliceFar[z]);
+                }
+            }
+        }
+    }
+
+    // 处理深度切片[firstSlice, lastSlice)，索引写入workerIndices[worker]，偏移相对该数组
+    void assignSlices(int firstSlice, int lastSlice, size_t worker)
+    {
+        std::vector<uint32_t>& out = workerIndices[worker];
+        out.clear();
+        std::vector<uint32_t> candidates;
+        std::vector<uint8_t> hit;
+        std::vector<float> cx, cy, r2;
+        for (int z = firstSlice; z < lastSlice; z++)
+        {
+            // 先按深度筛出与该切片相交的光源，并把它们的分量拷贝成连续数组
+            candidates.clear();
+            cx.clear();
+            cy.clear();
+            r2.clear();
+            float d0 = sliceNear[z], d1 = sliceFar[z];
+            for (size_t i = 0; i < lightDepth.size(); i++)
+            {
+                float r = lightRadius[i];
+                if (lightDepth[i] + r < d0 || lightDepth[i] - r > d1)
+                    continue;
+                float dz = std::max(0.0f, std::max(d0 - lightDepth[i], lightDepth[i] - d1));
+                candidates.push_back(static_cast<uint32_t>(i));
+                cx.push_back(lightX[i]);
+                cy.push_back(lightY[i]);
+                r2.push_back(r * r - dz * dz); // 深度方向的距离已扣除，剩下的平方半径留给x、y
+            }
+            size_t count = candidates.size();
+            hit.resize(count);
+
+            for (int c = z * TILES_X * TILES_Y; c < (z + 1) * TILES_X * TILES_Y; c++)
+            {
+                float bx0 = minX[c], bx1 = maxX[c], by0 = minY[c], by1 = maxY[c];
+                // 球与包围盒相交测试，无分支
+                for (size_t i = 0; i < count; i++)
+                {
+                    float dx = std::max(0.0f, std::max(bx0 - cx[i], cx[i] - bx1));
+                    float dy = std::max(0.0f, std::max(by0 - cy[i], cy[i] - by1));
+                    hit[i] = dx * dx + dy * dy <= r2[i];
+                }
+                uint32_t offset = static_cast<uint32_t>(out.size());
+                uint32_t assigned = 0;
+                for (size_t i = 0; i < count && assigned < MAX_LIGHTS_PER_CLUSTER; i++)
+                {
+                    if (hit[i])
+                    {
+                        out.push_back(candidates[i]);
+                        assigned++;
+                    }
+                }
+                grid[c * 2] = offset;
+                grid[c * 2 + 1] = assigned;
+            }
+        }
+    }
+
+    void upload()
+    {
+        const GLenum formats[3] = {GL_RG32UI, GL_R32UI, GL_RGBA32F};
+        if (textures[0] == 0)
+        {
+            glGenBuffers(3, buffers);
+            glGenTextures(3, textures);
+            memstats::OwnerScope owner("clustered lights");
+            for (int i = 0; i < 3; i++)
+                memstats::trackBuffer(buffers[i], MemoryCategory::StreamBuffer, 0);
+            for (int i = 0; i < 3; i++)
+            {
+                glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+                glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+                glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+            }
+        }
+
+        lightData.resize(std::max<size_t>(lights.size(), 1) * 2);
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            lightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+            lightData[i * 2 + 1] = glm::vec4(lights[i].color, 0.0f);
+        }
+
+        const void* data[3] = {grid.data(), indices.data(), lightData.data()};
+        const size_t sizes[3] = {
+            grid.size() * sizeof(uint32_t), indices.size() * sizeof(uint32_t), lightData.size() * sizeof(glm::vec4)
+        };
+        for (int i = 0; i < 3; i++)
+        {
+            // 每帧整体替换，驱动为新数据分配存储，不必等待上一帧的读取
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, sizes[i], data[i], GL_STREAM_DRAW);
+            memstats::trackBuffer(buffers[i], MemoryCategory::StreamBuffer, sizes[i]);
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+
+#endif
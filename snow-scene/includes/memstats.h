@@ -0,0 +1,542 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+// 内存账本
+// 创建缓冲、纹理、渲染缓冲以及CPU端的大块数据时登记字节数、类别与所属资源，释放时注销；
+// 按内存域（CPU/GPU）、类别和所属资源分别统计当前占用与历史峰值，可随时输出报告（F8）并在退出时打印。
+// 所属资源由当前线程上的 memstats::OwnerScope 决定（通常是模型路径或子系统名），作用域外登记的归入"scene"。
+// 同一对象重复登记视为重新分配（如窗口缩放后重建存储），只更新字节数，保留最初的类别与所属资源。
+// 设置预算后，占用越过预算时打印一次警告，回落到预算以内后重新计数。
+//
+// GPU字节数按内部格式与尺寸计算（含mip链），不包括驱动的对齐与填充。
+//
+// 另有一个堆计数器，用于测量模型导入这类一次性操作的真实峰值（含解析器的工作集与Assimp的临时分配）：
+// 在一个源文件中先定义MEMSTATS_HEAP_HOOKS再包含本头文件，会替换全局operator new/delete。
+// 只有snow-bench这样做；主程序不定义它，避免每次分配多付头部与计数的开销，
+// 也避免Assimp动态库与程序之间跨CRT分配、释放时配对错乱。替换后
+// 每块前加一个头部记下大小与分配时所在线程是否处于HeapScope中；只统计HeapScope中的分配，
+// 释放时无论在哪个线程都从计数中减去。发起线程创建的工作线程要用HeapScope(inherited)继承其状态。
+// 同一时刻只应有一个测量在进行；没有定义MEMSTATS_HEAP_HOOKS时heapHooked()为false，计数保持为0。
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class MemoryDomain
+{
+    CPU,
+    GPU,
+    Count
+};
+
+enum class MemoryCategory
+{
+    VertexBuffer,  // 顶点与索引缓冲
+    Texture,       // 从文件加载或程序生成的纹理
+    RenderTarget,  // 作为渲染目标的纹理与渲染缓冲
+    StreamBuffer,  // 每帧改写的缓冲（实例数据、PBO、纹理缓冲）
+    MeshData,      // CPU端保留的顶点与索引副本
+    HostData,      // 其他CPU端数据
+    Count
+};
+
+enum class MemoryObject
+{
+    Buffer,
+    Texture,
+    Renderbuffer,
+    Host,
+    TextureLayer // 纹理数组中的一层，整页另外按Texture登记
+};
+
+struct MemoryUsage
+{
+    size_t current[static_cast<int>(MemoryDomain::Count)] = {};
+    size_t peak[static_cast<int>(MemoryDomain::Count)] = {};
+
+    size_t bytes(MemoryDomain domain) const
+    {
+        return current[static_cast<int>(domain)];
+    }
+
+    size_t peakBytes(MemoryDomain domain) const
+    {
+        return peak[static_cast<int>(domain)];
+    }
+};
+
+namespace memstats
+{
+    inline MemoryDomain domainOf(MemoryCategory category)
+    {
+        return category == MemoryCategory::MeshData || category == MemoryCategory::HostData
+            ? MemoryDomain::CPU : MemoryDomain::GPU;
+    }
+
+    inline const char* categoryName(MemoryCategory category)
+    {
+        static const char* names[] = {"vertex buffers", "textures", "render targets", "stream buffers",
+                                      "mesh data", "host data"};
+        return names[static_cast<int>(category)];
+    }
+
+    struct Context
+    {
+        struct Allocation
+        {
+            MemoryCategory category;
+            int owner;
+            size_t bytes;
+        };
+
+        std::mutex mutex;
+        std::map<std::pair<int, uintptr_t>, Allocation> allocations;
+        std::vector<std::string> ownerNames = {"scene"};
+        std::vector<MemoryUsage> owners = std::vector<MemoryUsage>(1);
+        MemoryUsage categories[static_cast<int>(MemoryCategory::Count)];
+        MemoryUsage total;
+        size_t budgets[static_cast<int>(MemoryDomain::Count)] = {};
+        bool overBudget[static_cast<int>(MemoryDomain::Count)] = {};
+    };
+
+    inline Context& context()
+    {
+        static Context ctx;
+        return ctx;
+    }
+
+    // 当前线程的所属资源下标，0为"scene"
+    inline int& currentOwner()
+    {
+        static thread_local int owner = 0;
+        return owner;
+    }
+
+    // 调用方已持有锁
+    inline int internOwner(Context& ctx, const std::string& name)
+    {
+        for (size_t i = 0; i < ctx.ownerNames.size(); i++)
+        {
+            if (ctx.ownerNames[i] == name)
+                return static_cast<int>(i);
+        }
+        ctx.ownerNames.push_back(name);
+        ctx.owners.emplace_back();
+        return static_cast<int>(ctx.ownerNames.size()) - 1;
+    }
+
+    inline void adjust(MemoryUsage& usage, int domain, size_t removed, size_t added)
+    {
+        usage.current[domain] = usage.current[domain] - removed + added;
+        usage.peak[domain] = std::max(usage.peak[domain], usage.current[domain]);
+    }
+
+    inline void checkBudget(Context& ctx, int domain)
+    {
+        size_t budget = ctx.budgets[domain];
+        bool over = budget != 0 && ctx.total.current[domain] > budget;
+        if (over && !ctx.overBudget[domain])
+        {
+            char line[128];
+            std::snprintf(line, sizeof(line), "WARNING::MEMORY:: %s usage %.1f MB exceeds budget %.1f MB",
+                          domain == static_cast<int>(MemoryDomain::GPU) ? "GPU" : "CPU",
+                          ctx.total.current[domain] / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+            std::cout << line << std::endl;
+        }
+        ctx.overBudget[domain] = over;
+    }
+
+    inline void track(MemoryObject kind, uintptr_t name, MemoryCategory category, size_t bytes)
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        auto key = std::make_pair(static_cast<int>(kind), name);
+        auto found = ctx.allocations.find(key);
+        size_t previous = 0;
+        if (found == ctx.allocations.end())
+            found = ctx.allocations.insert(std::make_pair(key, Context::Allocation{category, currentOwner(), 0})).first;
+        else
+            previous = found->second.bytes;
+        Context::Allocation& allocation = found->second;
+        allocation.bytes = bytes;
+
+        int domain = static_cast<int>(domainOf(allocation.category));
+        adjust(ctx.total, domain, previous, bytes);
+        adjust(ctx.categories[static_cast<int>(allocation.category)], domain, previous, bytes);
+        adjust(ctx.owners[allocation.owner], domain, previous, bytes);
+        checkBudget(ctx, domain);
+    }
+
+    inline void untrack(MemoryObject kind, uintptr_t name)
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        auto found = ctx.allocations.find(std::make_pair(static_cast<int>(kind), name));
+        if (found == ctx.allocations.end())
+            return;
+        const Context::Allocation& allocation = found->second;
+        int domain = static_cast<int>(domainOf(allocation.category));
+        adjust(ctx.total, domain, allocation.bytes, 0);
+        adjust(ctx.categories[static_cast<int>(allocation.category)], domain, allocation.bytes, 0);
+        adjust(ctx.owners[allocation.owner], domain, allocation.bytes, 0);
+        ctx.allocations.erase(found);
+        checkBudget(ctx, domain);
+    }
+
+    inline void trackBuffer(GLuint buffer, MemoryCategory category, size_t bytes)
+    {
+        track(MemoryObject::Buffer, buffer, category, bytes);
+    }
+
+    inline void trackTexture(GLuint texture, MemoryCategory category, size_t bytes)
+    {
+        track(MemoryObject::Texture, texture, category, bytes);
+    }
+
+    inline void trackRenderbuffer(GLuint renderbuffer, size_t bytes)
+    {
+        track(MemoryObject::Renderbuffer, renderbuffer, MemoryCategory::RenderTarget, bytes);
+    }
+
+    inline void trackHost(const void* data, MemoryCategory category, size_t bytes)
+    {
+        track(MemoryObject::Host, reinterpret_cast<uintptr_t>(data), category, bytes);
+    }
+
+    // 多个资源共享的纹理数组：各层登记在使用它的资源名下，页本身只登记未分配的层，总数不重复计算
+    inline void trackTextureLayer(GLuint texture, int layer, size_t bytes)
+    {
+        track(MemoryObject::TextureLayer, (static_cast<uintptr_t>(texture) << 16) | static_cast<uintptr_t>(layer),
+              MemoryCategory::Texture, bytes);
+    }
+
+    inline void untrackBuffer(GLuint buffer)
+    {
+        untrack(MemoryObject::Buffer, buffer);
+    }
+
+    inline void untrackTexture(GLuint texture)
+    {
+        untrack(MemoryObject::Texture, texture);
+    }
+
+    inline void untrackRenderbuffer(GLuint renderbuffer)
+    {
+        untrack(MemoryObject::Renderbuffer, renderbuffer);
+    }
+
+    inline void untrackTextureLayer(GLuint texture, int layer)
+    {
+        untrack(MemoryObject::TextureLayer, (static_cast<uintptr_t>(texture) << 16) | static_cast<uintptr_t>(layer));
+    }
+
+    inline void untrackHost(const void* data)
+    {
+        untrack(MemoryObject::Host, reinterpret_cast<uintptr_t>(data));
+    }
+
+    // 纹理字节数：levels为0时按完整mip链计算
+    inline size_t textureBytes(int width, int height, int depth, size_t bytesPerTexel, int levels = 1)
+    {
+        size_t bytes = 0;
+        for (int level = 0; levels == 0 ? true : level < levels; level++)
+        {
+            bytes += static_cast<size_t>(width) * height * depth * bytesPerTexel;
+            if (width == 1 && height == 1)
+                break;
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+        return bytes;
+    }
+
+    // 预算为0表示不限制
+    inline void setBudget(MemoryDomain domain, size_t bytes)
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        ctx.budgets[static_cast<int>(domain)] = bytes;
+        checkBudget(ctx, static_cast<int>(domain));
+    }
+
+    inline bool overBudget(MemoryDomain domain)
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        return ctx.overBudget[static_cast<int>(domain)];
+    }
+
+    inline MemoryUsage total()
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        return ctx.total;
+    }
+
+    // 所属资源当前与峰值占用，未登记过的名字返回全0
+    inline MemoryUsage owner(const std::string& name)
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        for (size_t i = 0; i < ctx.ownerNames.size(); i++)
+        {
+            if (ctx.ownerNames[i] == name)
+                return ctx.owners[i];
+        }
+        return MemoryUsage();
+    }
+
+    // 多行报告：总计、按类别、按所属资源（按当前GPU占用降序），每项给出当前/峰值
+    inline std::string report()
+    {
+        Context& ctx = context();
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        const int cpu = static_cast<int>(MemoryDomain::CPU), gpu = static_cast<int>(MemoryDomain::GPU);
+        const double MB = 1024.0 * 1024.0;
+        char line[256];
+        std::string text;
+
+        std::snprintf(line, sizeof(line), "memory: GPU %.1f MB (peak %.1f)  CPU %.1f MB (peak %.1f)  objects %zu\n",
+                      ctx.total.current[gpu] / MB, ctx.total.peak[gpu] / MB, ctx.total.current[cpu] / MB,
+                      ctx.total.peak[cpu] / MB, ctx.allocations.size());
+        text += line;
+        for (int domain = 0; domain < static_cast<int>(MemoryDomain::Count); domain++)
+        {
+            if (ctx.budgets[domain] == 0)
+                continue;
+            std::snprintf(line, sizeof(line), "  %s budget %.1f MB%s\n", domain == gpu ? "GPU" : "CPU",
+                          ctx.budgets[domain] / MB, ctx.total.peak[domain] > ctx.budgets[domain] ? " (exceeded)" : "");
+            text += line;
+        }
+        for (int i = 0; i < static_cast<int>(MemoryCategory::Count); i++)
+        {
+            MemoryCategory category = static_cast<MemoryCategory>(i);
+            int domain = static_cast<int>(domainOf(category));
+            const MemoryUsage& usage = ctx.categories[i];
+            std::snprintf(line, sizeof(line), "  %-16s %s %9.2f MB  peak %9.2f MB\n", categoryName(category),
+                          domain == gpu ? "GPU" : "CPU", usage.current[domain] / MB, usage.peak[domain] / MB);
+            text += line;
+        }
+
+        std::vector<int> order;
+        for (size_t i = 0; i < ctx.owners.size(); i++)
+        {
+            if (ctx.owners[i].peak[gpu] != 0 || ctx.owners[i].peak[cpu] != 0)
+                order.push_back(static_cast<int>(i));
+        }
+        std::sort(order.begin(), order.end(), [&ctx, gpu](int a, int b)
+        {
+            return ctx.owners[a].current[gpu] > ctx.owners[b].current[gpu];
+        });
+        for (int i : order)
+        {
+            const MemoryUsage& usage = ctx.owners[i];
+            std::snprintf(line, sizeof(line), "  %-40s GPU %8.2f MB (peak %8.2f)  CPU %8.2f MB (peak %8.2f)\n",
+                          ctx.ownerNames[i].c_str(), usage.current[gpu] / MB, usage.peak[gpu] / MB,
+                          usage.current[cpu] / MB, usage.peak[cpu] / MB);
+            text += line;
+        }
+        return text;
+    }
+
+    // 作用域内登记的对象归属于name，可嵌套
+    class OwnerScope
+    {
+    public:
+        explicit OwnerScope(const std::string& name) : previous(currentOwner())
+        {
+            Context& ctx = context();
+            std::lock_guard<std::mutex> lock(ctx.mutex);
+            currentOwner() = internOwner(ctx, name);
+        }
+
+        // 恢复之前用currentOwner()记下的所属资源（登记被推迟到作用域之外的场合）
+        explicit OwnerScope(int owner) : previous(currentOwner())
+        {
+            currentOwner() = owner;
+        }
+
+        ~OwnerScope()
+        {
+            currentOwner() = previous;
+        }
+
+        OwnerScope(const OwnerScope&) = delete;
+        OwnerScope& operator=(const OwnerScope&) = delete;
+
+    private:
+        int previous;
+    };
+
+    struct HeapCounter
+    {
+        std::atomic<size_t> live{0}; // HeapScope中分配、尚未释放的字节数
+        std::atomic<size_t> peak{0};
+        std::atomic<bool> hooked{false};
+    };
+
+    inline HeapCounter& heapCounter()
+    {
+        static HeapCounter counter;
+        return counter;
+    }
+
+    inline bool& heapScoped()
+    {
+        static thread_local bool scoped = false;
+        return scoped;
+    }
+
+    inline bool heapHooked()
+    {
+        return heapCounter().hooked.load(std::memory_order_relaxed);
+    }
+
+    // 作用域内当前线程的堆分配计入堆计数器
+    class HeapScope
+    {
+    public:
+        explicit HeapScope(bool enabled = true) : previous(heapScoped())
+        {
+            heapScoped() = enabled;
+        }
+
+        ~HeapScope()
+        {
+            heapScoped() = previous;
+        }
+
+        HeapScope(const HeapScope&) = delete;
+        HeapScope& operator=(const HeapScope&) = delete;
+
+    private:
+        bool previous;
+    };
+
+    // 开始一次峰值测量，返回起点；之后用heapPeakSince取得期间的最大增量
+    inline size_t beginHeapPeak()
+    {
+        HeapCounter& counter = heapCounter();
+        size_t live = counter.live.load();
+        counter.peak.store(live);
+        return live;
+    }
+
+    inline size_t heapPeakSince(size_t start)
+    {
+        size_t peak = heapCounter().peak.load();
+        return peak > start ? peak - start : 0;
+    }
+
+    // 以下供替换的operator new/delete使用
+    // 头部占16字节，保持malloc返回地址的对齐
+    struct alignas(16) HeapHeader
+    {
+        size_t bytes;
+        bool scoped;
+    };
+
+    inline void* heapAllocate(size_t bytes) noexcept
+    {
+        HeapHeader* header = static_cast<HeapHeader*>(std::malloc(sizeof(HeapHeader) + bytes));
+        if (header == nullptr)
+            return nullptr;
+        HeapCounter& counter = heapCounter();
+        header->bytes = bytes;
+        header->scoped = heapScoped();
+        if (header->scoped)
+        {
+            size_t live = counter.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            size_t peak = counter.peak.load(std::memory_order_relaxed);
+            while (live > peak && !counter.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+            {
+            }
+        }
+        return header + 1;
+    }
+
+    inline void heapFree(void* data) noexcept
+    {
+        if (data == nullptr)
+            return;
+        HeapHeader* header = static_cast<HeapHeader*>(data) - 1;
+        if (header->scoped)
+            heapCounter().live.fetch_sub(header->bytes, std::memory_order_relaxed);
+        std::free(header);
+    }
+
+    inline void* heapAllocateOrThrow(size_t bytes)
+    {
+        void* data = heapAllocate(bytes == 0 ? 1 : bytes);
+        if (data == nullptr)
+            throw std::bad_alloc();
+        return data;
+    }
+}
+
+#ifdef MEMSTATS_HEAP_HOOKS
+static const bool memstatsHeapHooked = (memstats::heapCounter().hooked = true);
+
+void* operator new(std::size_t bytes)
+{
+    return memstats::heapAllocateOrThrow(bytes);
+}
+
+void* operator new[](std::size_t bytes)
+{
+    return memstats::heapAllocateOrThrow(bytes);
+}
+
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept
+{
+    return memstats::heapAllocate(bytes == 0 ? 1 : bytes);
+}
+
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept
+{
+    return memstats::heapAllocate(bytes == 0 ? 1 : bytes);
+}
+
+void operator delete(void* data) noexcept
+{
+    memstats::heapFree(data);
+}
+
+void operator delete[](void* data) noexcept
+{
+    memstats::heapFree(data);
+}
+
+void operator delete(void* data, std::size_t) noexcept
+{
+    memstats::heapFree(data);
+}
+
+void operator delete[](void* data, std::size_t) noexcept
+{
+    memstats::heapFree(data);
+}
+
+void operator delete(void* data, const std::nothrow_t&) noexcept
+{
+    memstats::heapFree(data);
+}
+
+void operator delete[](void* data, const std::nothrow_t&) noexcept
+{
+    memstats::heapFree(data);
+}
+#endif
+
+#endif
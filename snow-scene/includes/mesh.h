@@ -4,9 +4,13 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "glstats.h"
+#include "memstats.h"
 #include "shader.h"
+#include "texturearray.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #define MAX_BONE_INFLUENCE 4
@@ -27,6 +31,7 @@ struct Texture
 	unsigned int id;
 	std::string type;
 	std::string path;
+	int material = -1; // 纹理数组中的材质编号（TextureArrayPool），>=0时id不使用
 };
 
 class Mesh
@@ -37,25 +42,67 @@ public:
 	std::vector<Texture> textures;
 	unsigned int VAO;
 
-	Mesh(const std::vector<Vertex>& vertices,
-		const std::vector<unsigned int>& indices,
-		const std::vector<Texture>& textures)
+	// 按值接收，调用方传右值时顶点与索引直接移入，上传前不再复制
+	Mesh(std::vector<Vertex> vertices,
+		std::vector<unsigned int> indices,
+		std::vector<Texture> textures)
+		: vertices(std::move(vertices)),
+		  indices(std::move(indices)),
+		  textures(std::move(textures))
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
-
 		setupMesh();
 	}
 
 	void Draw(const Shader& shader)
+	{
+		bindTextures(shader);
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+		glBindVertexArray(0);
+
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// 把每实例平移（vec3，location 7）绑定到本网格的VAO
+	void setInstanceBuffer(unsigned int instanceVBO)
+	{
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		glEnableVertexAttribArray(7);
+		glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glVertexAttribDivisor(7, 1);
+		glBindVertexArray(0);
+	}
+
+	// 释放GPU缓冲，网格之后不能再绘制
+	void release()
+	{
+		memstats::untrackBuffer(VBO);
+		memstats::untrackBuffer(EBO);
+		memstats::untrackHost(vertices.data());
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		VAO = VBO = EBO = 0;
+	}
+
+private:
+	unsigned int VBO, EBO;
+
+	void bindTextures(const Shader& shader)
 	{
 		unsigned int diffuseNr = 1;
 		unsigned int specularNr = 1;
 		unsigned int normalNr = 1;
 		unsigned int heightNr = 1;
+		int material = -1;
 		for (unsigned int i = 0; i < textures.size(); i++)
 		{
+			if (textures[i].material >= 0)
+			{
+				material = textures[i].material;
+				continue;
+			}
 			glActiveTexture(GL_TEXTURE0 + i);
 			std::string number;
 			std::string name = textures[i].type;
@@ -71,17 +118,10 @@ public:
 			glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
 			glBindTexture(GL_TEXTURE_2D, textures[i].id);
 		}
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-
-		glActiveTexture(GL_TEXTURE0);
+		// 没有材质的网格使用占位层；页与上一次相同时不重新绑定
+		TextureArrayPool::instance().bind(shader, material);
 	}
 
-private:
-	unsigned int VBO, EBO;
-
 	void setupMesh()
 	{
 		glGenVertexArrays(1, &VAO);
@@ -96,6 +136,12 @@ private:
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
+		// CPU副本以顶点数组的地址登记，Mesh移动时地址不变
+		const size_t vertexBytes = vertices.size() * sizeof(Vertex), indexBytes = indices.size() * sizeof(unsigned int);
+		memstats::trackBuffer(VBO, MemoryCategory::VertexBuffer, vertexBytes);
+		memstats::trackBuffer(EBO, MemoryCategory::VertexBuffer, indexBytes);
+		memstats::trackHost(vertices.data(), MemoryCategory::MeshData, vertexBytes + indexBytes);
+
 		// 设置顶点属性指针
 		// 顶点位置
 		glEnableVertexAttribArray(0);
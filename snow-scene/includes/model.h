@@ -8,20 +8,41 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "glstats.h"
+#include "memstats.h"
 #include "mesh.h"
+#include "objloader.h"
 #include "shader.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "texturestream.h"
+
 unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
 
+// 一次导入的耗时与主机内存
+// sourceBytes为解析结果（Assimp场景或原生OBJ解析的网格）占用的内存，stagingBytes为转换出的顶点与索引，二者按大小计算；
+// peakBytes是导入期间（含解析器的工作集、Assimp的临时分配与同步解码的纹理）实测的堆峰值增量，
+// 由memstats的堆计数器测得，只在定义了MEMSTATS_HEAP_HOOKS的snow-bench中有值，主程序中为0
+struct ImportStats
+{
+    double milliseconds = 0.0;
+    size_t sourceBytes = 0;
+    size_t stagingBytes = 0;
+    size_t peakBytes = 0;
+};
+
 class Model
 {
 public:
@@ -29,8 +50,12 @@ public:
     std::vector<Mesh> meshes;
     std::string directory;
     bool gammaCorrection;
+    TextureStreamer* streamer; // 不为空时纹理异步流式加载，否则同步加载
+    ImportStats importStats;
 
-    Model(std::string const& path, bool gamma = false) : gammaCorrection(gamma)
+    Model(std::string const& path, bool gamma = false, TextureStreamer* streamer = nullptr)
+        : gammaCorrection(gamma),
+          streamer(streamer)
     {
         loadModel(path);
     }
@@ -41,9 +66,52 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // 释放网格缓冲与纹理（资源驻留管理在驱逐时调用）
+    void release()
+    {
+        for (Mesh& mesh : meshes)
+            mesh.release();
+        for (const Texture& texture : textures_loaded)
+        {
+            if (texture.material >= 0)
+            {
+                TextureArrayPool::instance().release(texture.material);
+                continue;
+            }
+            memstats::untrackTexture(texture.id);
+            glDeleteTextures(1, &texture.id);
+        }
+        meshes.clear();
+        textures_loaded.clear();
+    }
+
 private:
+    size_t importHeapStart = 0;
+
     void loadModel(std::string const& path)
     {
+        memstats::OwnerScope owner(path); // 网格缓冲与纹理都记在模型路径名下
+        memstats::HeapScope heap;
+        importHeapStart = memstats::beginHeapPeak();
+        auto start = std::chrono::steady_clock::now();
+        // OBJ优先使用原生多线程解析，解析失败时与其他格式（FBX等）一样交给Assimp
+        if (ObjImporter::handles(path))
+        {
+            ObjImporter obj;
+            ObjModel parsed;
+            if (obj.load(path, parsed))
+            {
+                directory = path.substr(0, path.find_last_of('/'));
+                for (const ObjMesh& mesh : parsed.meshes)
+                    importStats.sourceBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+                meshes.reserve(parsed.meshes.size());
+                for (ObjMesh& mesh : parsed.meshes)
+                    meshes.push_back(processObjMesh(mesh, parsed.materials));
+                finishImport(start);
+                return;
+            }
+            std::cout << "WARNING::OBJ:: " << obj.error << ", falling back to Assimp" << std::endl;
+        }
         Assimp::Importer importer;
         const aiScene* scene = importer.ReadFile(
             path,
@@ -59,76 +127,118 @@ private:
         }
         directory = path.substr(0, path.find_last_of('/'));
 
-        processNode(scene->mRootNode, scene);
-    }
+        aiMemoryInfo memory;
+        importer.GetMemoryRequirements(memory);
+        importStats.sourceBytes = memory.total;
 
-    void processNode(aiNode* node, const aiScene* scene)
-    {
-        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        // 先按节点顺序收集网格，顶点与索引的转换只读场景、互不相关，在多个线程中并行完成；
+        // 纹理加载与GL上传留在当前（GL）线程
+        std::vector<const aiMesh*> sources;
+        collectMeshes(scene->mRootNode, scene, sources);
+        std::vector<MeshData> converted(sources.size());
+        unsigned int workerCount = static_cast<unsigned int>(std::min<size_t>(
+            sources.size(), std::max(1u, std::thread::hardware_concurrency())));
+        if (workerCount <= 1)
         {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            for (size_t i = 0; i < sources.size(); i++)
+                converted[i] = convertMesh(sources[i]);
         }
-        for (unsigned int i = 0; i < node->mNumChildren; i++)
+        else
         {
-            processNode(node->mChildren[i], scene);
+            std::vector<std::thread> workers;
+            for (unsigned int w = 0; w < workerCount; w++)
+            {
+                workers.emplace_back([&, w]
+                {
+                    memstats::HeapScope heap;
+                    for (size_t i = w; i < sources.size(); i += workerCount)
+                        converted[i] = convertMesh(sources[i]);
+                });
+            }
+            for (std::thread& t : workers)
+                t.join();
         }
+        for (const MeshData& data : converted)
+            importStats.stagingBytes += data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned int);
+
+        meshes.reserve(sources.size());
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            std::vector<Texture> textures = loadMeshTextures(scene->mMaterials[sources[i]->mMaterialIndex]);
+            meshes.emplace_back(std::move(converted[i].vertices), std::move(converted[i].indices), std::move(textures));
+        }
+        finishImport(start);
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    void finishImport(std::chrono::steady_clock::time_point start)
+    {
+        importStats.milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        importStats.peakBytes = memstats::heapPeakSince(importHeapStart);
+    }
+
+    struct MeshData
     {
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
-        std::vector<Texture> textures;
+    };
 
+    void collectMeshes(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& sources)
+    {
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            sources.push_back(scene->mMeshes[node->mMeshes[i]]);
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            collectMeshes(node->mChildren[i], scene, sources);
+    }
+
+    // 按确定的大小一次分配，逐项写入，不经过push_back；可在任意线程调用
+    static MeshData convertMesh(const aiMesh* mesh)
+    {
+        MeshData data;
+        data.vertices.resize(mesh->mNumVertices);
+        const aiVector3D* texcoords = mesh->mTextureCoords[0];
+        const bool hasNormals = mesh->HasNormals();
+        const bool hasTangents = texcoords != nullptr && mesh->HasTangentsAndBitangents();
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector;
+            Vertex& vertex = data.vertices[i];
             // 位置
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
+            vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
             // 法线
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
+            vertex.Normal = hasNormals ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z)
+                                       : glm::vec3(0.0f);
             // 纹理坐标
-            if (mesh->mTextureCoords[0])
+            vertex.TexCoords = texcoords != nullptr ? glm::vec2(texcoords[i].x, texcoords[i].y) : glm::vec2(0.0f);
+            // 切线与双切线
+            if (hasTangents)
             {
-                glm::vec2 vec;
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // 切线
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // 双切线
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
             }
             else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
+            {
+                vertex.Tangent = vertex.Bitangent = glm::vec3(0.0f);
+            }
+            std::fill(std::begin(vertex.m_BoneIDs), std::end(vertex.m_BoneIDs), 0);
+            std::fill(std::begin(vertex.m_Weights), std::end(vertex.m_Weights), 0.0f);
         }
-        // 处理索引
+        // 处理索引：三角化后多数面为3个索引，点、线面另计
+        size_t indexCount = 0;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            indexCount += mesh->mFaces[i].mNumIndices;
+        data.indices.resize(indexCount);
+        unsigned int* out = data.indices.data();
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            for (unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            const aiFace& face = mesh->mFaces[i];
+            out = std::copy(face.mIndices, face.mIndices + face.mNumIndices, out);
         }
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        return data;
+    }
+
+    std::vector<Texture> loadMeshTextures(aiMaterial* material)
+    {
+        std::vector<Texture> textures;
         /*
          * 用法：
          * diffuse: texture_diffuseN
@@ -148,22 +258,51 @@ private:
         // height maps
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        return textures;
+    }
 
-        return Mesh(vertices, indices, textures);
+    // 原生OBJ解析的网格：顶点与索引已就绪，只需按材质加载纹理
+    Mesh processObjMesh(ObjMesh& mesh, const std::vector<ObjMaterial>& materials)
+    {
+        std::vector<Texture> textures;
+        if (mesh.material >= 0)
+        {
+            const ObjMaterial& material = materials[mesh.material];
+            std::vector<Texture> diffuseMaps = loadTextures(material.diffuse, "texture_diffuse");
+            textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+            std::vector<Texture> specularMaps = loadTextures(material.specular, "texture_specular");
+            textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+            std::vector<Texture> normalMaps = loadTextures(material.normal, "texture_normal");
+            textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+            std::vector<Texture> heightMaps = loadTextures(material.height, "texture_height");
+            textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        }
+        return Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures));
     }
 
     std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
     {
-        std::vector<Texture> textures;
+        std::vector<std::string> paths;
         for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
+            paths.push_back(str.C_Str());
+        }
+        return loadTextures(paths, typeName);
+    }
+
+    // paths为相对模型目录的纹理路径
+    std::vector<Texture> loadTextures(const std::vector<std::string>& paths, const std::string& typeName)
+    {
+        std::vector<Texture> textures;
+        for (const std::string& path : paths)
+        {
             // 如果纹理已经被加载过了，就跳过
             bool skip = false;
             for (unsigned int j = 0; j < textures_loaded.size(); j++)
             {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if (textures_loaded[j].path == path)
                 {
                     textures.push_back(textures_loaded[j]);
                     skip = true;
@@ -174,9 +313,18 @@ private:
             {
                 // 如果纹理还没有被加载过，就加载它
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                // 流式加载的漫反射纹理放入纹理数组，同尺寸的纹理共用一次绑定
+                if (streamer != nullptr && typeName == "texture_diffuse")
+                {
+                    texture.id = 0;
+                    texture.material = streamer->requestMaterial(this->directory + '/' + path);
+                }
+                else if (streamer != nullptr)
+                    texture.id = streamer->request(this->directory + '/' + path);
+                else
+                    texture.id = TextureFromFile(path.c_str(), this->directory);
                 texture.type = typeName;
-                texture.path = str.C_Str();
+                texture.path = path;
                 textures.push_back(texture);
                 textures_loaded.push_back(texture);
             }
@@ -210,6 +358,8 @@ unsigned int TextureFromFile(const char* path, const std::string& directory, boo
         glBindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        memstats::trackTexture(textureID, MemoryCategory::Texture,
+                               memstats::textureBytes(width, height, 1, nrComponents, 0));
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -0,0 +1,1083 @@
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <glm/glm.hpp>
+
+#include "memstats.h"
+#include "mesh.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读内存映射文件
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+            return;
+        bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (bytes != nullptr)
+            length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+            return;
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (view == MAP_FAILED)
+            return;
+        bytes = static_cast<const char*>(view);
+        length = static_cast<size_t>(info.st_size);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (bytes != nullptr)
+            UnmapViewOfFile(bytes);
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (bytes != nullptr)
+            munmap(const_cast<char*>(bytes), length);
+        if (descriptor >= 0)
+            close(descriptor);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 空文件也视为打开失败
+    bool isOpen() const
+    {
+        return bytes != nullptr;
+    }
+
+    const char* data() const
+    {
+        return bytes;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
+
+// OBJ文本解析用的小工具，不分配内存、不依赖区域设置
+namespace objparse
+{
+    inline bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    inline const char* skipBlanks(const char* p, const char* end)
+    {
+        while (p < end && isBlank(*p))
+            p++;
+        return p;
+    }
+
+    // 十进制浮点数：最多累计19位有效数字，再按10的整数次幂缩放；
+    // |指数| <= 22时10^k可精确表示为double，除法/乘法只有一次舍入，转为float后与strtof一致
+    inline float parseFloat(const char*& p, const char* end)
+    {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        p = skipBlanks(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        for (; p < end && isDigit(*p); p++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                digits += mantissa != 0 ? 1 : 0;
+            }
+            else
+            {
+                exponent++;
+            }
+        }
+        if (p < end && *p == '.')
+        {
+            for (p++; p < end && isDigit(*p); p++)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                    digits += mantissa != 0 ? 1 : 0;
+                    exponent--;
+                }
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            const char* q = p + 1;
+            bool negativeExponent = false;
+            if (q < end && (*q == '-' || *q == '+'))
+                negativeExponent = *q++ == '-';
+            if (q < end && isDigit(*q))
+            {
+                int e = 0;
+                for (; q < end && isDigit(*q); q++)
+                    e = std::min(e * 10 + (*q - '0'), 10000);
+                exponent += negativeExponent ? -e : e;
+                p = q;
+            }
+        }
+
+        double value = static_cast<double>(mantissa);
+        if (mantissa == 0)
+            value = 0.0;
+        else if (exponent >= 0 && exponent <= 22)
+            value *= powers[exponent];
+        else if (exponent < 0 && exponent >= -22)
+            value /= powers[-exponent];
+        else
+            value *= std::pow(10.0, exponent);
+        return static_cast<float>(negative ? -value : value);
+    }
+
+    inline int parseInt(const char*& p, const char* end)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        int value = 0;
+        for (; p < end && isDigit(*p); p++)
+            value = value * 10 + (*p - '0');
+        return negative ? -value : value;
+    }
+
+    // 行首关键字是否为keyword（其后必须是空白）
+    inline bool keyword(const char* p, const char* end, const char* word, size_t length)
+    {
+        return static_cast<size_t>(end - p) > length && std::memcmp(p, word, length) == 0 && isBlank(p[length]);
+    }
+
+    // 关键字之后的整行文本，去掉首尾空白
+    inline std::string rest(const char* p, const char* end)
+    {
+        p = skipBlanks(p, end);
+        while (end > p && isBlank(end[-1]))
+            end--;
+        return std::string(p, end);
+    }
+}
+
+struct ObjMaterial
+{
+    std::string name;
+    // 纹理路径（相对模型目录，与MTL中写法相同），按Model使用的类型名分类
+    std::vector<std::string> diffuse;  // map_Kd
+    std::vector<std::string> specular; // map_Ks
+    std::vector<std::string> normal;   // map_Bump / bump，与Assimp的aiTextureType_HEIGHT对应
+    std::vector<std::string> height;   // map_Ka，与Assimp的aiTextureType_AMBIENT对应
+};
+
+struct ObjMesh
+{
+    std::string object;
+    int material = -1; // ObjModel::materials中的下标，-1为没有材质
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+struct ObjModel
+{
+    std::vector<ObjMesh> meshes;
+    std::vector<ObjMaterial> materials;
+};
+
+// 原生OBJ/MTL导入
+// 文件经内存映射后按行边界切成若干块，各块在独立线程中解析顶点属性与三角化后的面；
+// 合并时按Assimp的OBJ导入规则切分网格：g名字改变时新建对象，o遇到新名字时新建对象（已有的名字不切换网格），
+// usemtl换成不同材质且当前网格已有面时新建网格；同名对象或材质不连续的几段不合并。
+// 网格内按(位置, 纹理坐标, 法线)去重，得到带索引的顶点数组，各网格在独立线程中处理。
+// 负索引相对于该行之前的顶点数，跨块时在合并阶段换算。
+// 顶点属性与Assimp路径（Triangulate | GenSmoothNormals | FlipUVs | CalcTangentSpace）的算法相同：
+// - 纹理坐标翻转v，骨骼数据清零
+// - 网格中没有任何法线时生成平滑法线：单位化的面法线按空间位置（半径为包围盒对角线的1e-4）求和，
+//   与Assimp的SpatialSort一样按顶点顺序贪心分组；网格带法线时，缺少法线的面顶点法线为0（Assimp也是如此）
+// - 有纹理坐标时按面计算切线与副切线（含Assimp的方向约定），投影到顶点法线平面上正交化，
+//   再在同一位置、法线相同且切线夹角不超过45度的面顶点之间平均
+// Assimp不去重，每个面顶点的切线可以不同；这里先对每个面顶点按Assimp的算法求出结果，
+// 共用同一去重顶点的面顶点再取平均，只有同一顶点两侧的切线相差超过45度时才与Assimp不同；
+// 另外凹四边形与五边形以上按扇形三角化，Assimp会选别的对角线，面法线与切线可能不同。
+// 与Assimp输出的逐面顶点对比见bench的obj_vs_assimp用例。
+// 只支持多边形面（f），忽略点、线与自由曲面；解析出错时load返回false，由调用方回退到Assimp。
+class ObjImporter
+{
+public:
+    unsigned int threadCount; // 切块数的上限；大于1时各块与各网格在所有导入共用的常驻线程池上并行
+    size_t minChunkBytes = 256u << 10; // 小文件不拆分
+    std::string error;
+
+    explicit ObjImporter(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : threadCount(std::max(1u, threadCount))
+    {
+    }
+
+    static bool handles(const std::string& path)
+    {
+        if (path.size() < 4)
+            return false;
+        std::string extension = path.substr(path.size() - 4);
+        for (char& c : extension)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return extension == ".obj";
+    }
+
+    bool load(const std::string& path, ObjModel& model)
+    {
+        MappedFile file(path);
+        if (!file.isOpen())
+        {
+            error = "cannot map " + path;
+            return false;
+        }
+
+        // 按行边界切块
+        const char* begin = file.data();
+        const char* end = begin + file.size();
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, file.size() / minChunkBytes));
+        std::vector<const char*> bounds(1, begin);
+        for (size_t i = 1; i < chunkCount; i++)
+        {
+            const char* p = std::max(begin + file.size() * i / chunkCount, bounds.back());
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            bounds.push_back(newline != nullptr ? newline + 1 : end);
+        }
+        bounds.push_back(end);
+
+        std::vector<Chunk> chunks(chunkCount);
+        parallel(chunkCount, [&](size_t i) { parseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+        for (const Chunk& chunk : chunks)
+        {
+            if (!chunk.error.empty())
+            {
+                error = path + ": " + chunk.error;
+                return false;
+            }
+        }
+
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::vector<std::string> libraries;
+        for (const Chunk& chunk : chunks)
+            libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+        for (const std::string& library : libraries)
+            loadMaterials(directory + library, model.materials);
+
+        return merge(chunks, model);
+    }
+
+private:
+    static constexpr int NONE = INT32_MIN;
+
+    // 一个面顶点：已换算为从0开始的下标；relative对应位为1时下标相对于所在块的起始计数
+    struct Corner
+    {
+        int position;
+        int texcoord;
+        int normal;
+        uint8_t relative;
+        bool polygonStart; // 所在三角形是多边形三角化后的第一个（只在三角形的第0个面顶点上有意义）
+    };
+
+    // 第triangle个三角形起切换对象、组或材质
+    struct GroupChange
+    {
+        size_t triangle;
+        char statement; // 'o'、'g'或'm'（usemtl）
+        std::string name;
+    };
+
+    struct Chunk
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texcoords;
+        std::vector<glm::vec3> normals;
+        std::vector<Corner> corners; // 每3个为一个三角形
+        std::vector<GroupChange> changes;
+        std::vector<std::string> libraries;
+        std::string error;
+    };
+
+    // 一个组在某块中的连续三角形
+    struct Run
+    {
+        size_t chunk;
+        size_t first;
+        size_t count;
+    };
+
+    struct Group
+    {
+        std::string object;
+        std::string material;
+        std::vector<Run> runs;
+    };
+
+    struct VertexKey
+    {
+        int position;
+        int texcoord;
+        int normal;
+
+        bool operator==(const VertexKey& other) const
+        {
+            return position == other.position && texcoord == other.texcoord && normal == other.normal;
+        }
+    };
+
+    // 去重用的开放寻址哈希表：容量固定为不小于2倍面顶点数的2的幂，线性探测，不逐项分配节点
+    class VertexTable
+    {
+    public:
+        explicit VertexTable(size_t cornerCount)
+        {
+            size_t capacity = 16;
+            while (capacity < cornerCount * 2)
+                capacity <<= 1;
+            mask = capacity - 1;
+            slots.resize(capacity, Slot{VertexKey{-1, -1, -1}, 0});
+        }
+
+        // 返回key对应的顶点编号；key首次出现时记为next并把inserted置为true
+        unsigned int insert(const VertexKey& key, unsigned int next, bool& inserted)
+        {
+            for (size_t i = hash(key) & mask;; i = (i + 1) & mask)
+            {
+                Slot& slot = slots[i];
+                if (slot.key.position < 0)
+                {
+                    slot.key = key;
+                    slot.vertex = next;
+                    inserted = true;
+                    return next;
+                }
+                if (slot.key == key)
+                {
+                    inserted = false;
+                    return slot.vertex;
+                }
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            VertexKey key;
+            unsigned int vertex;
+        };
+
+        std::vector<Slot> slots;
+        size_t mask = 0;
+
+        static size_t hash(const VertexKey& key)
+        {
+            uint64_t h = static_cast<uint32_t>(key.position) * 0x9E3779B97F4A7C15ull;
+            h ^= (static_cast<uint32_t>(key.texcoord) + 0x7F4A7C15ull + (h << 6) + (h >> 2)) * 0xC2B2AE3D27D4EB4Full;
+            h ^= (static_cast<uint32_t>(key.normal) + 0x165667B1ull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+            return static_cast<size_t>(h ^ (h >> 31));
+        }
+    };
+
+    // 第一次并行导入时创建，之后各次导入复用
+    static WorkerPool& workers()
+    {
+        static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    template <class Task>
+    void parallel(size_t count, Task task)
+    {
+        if (count <= 1 || threadCount <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                task(i);
+            return;
+        }
+        const bool heapScoped = memstats::heapScoped(); // 工作线程的分配计入发起线程的堆测量
+        workers().parallelFor(count, [&](size_t i)
+        {
+            memstats::HeapScope heap(heapScoped);
+            task(i);
+        });
+    }
+
+    static bool parseCorner(const char*& p, const char* end, const Chunk& chunk, Corner& corner)
+    {
+        using namespace objparse;
+        corner.texcoord = corner.normal = NONE;
+        corner.relative = 0;
+        corner.polygonStart = false;
+        if (p >= end || !(isDigit(*p) || *p == '-' || *p == '+'))
+            return false;
+
+        int counts[3] = {
+            static_cast<int>(chunk.positions.size()), static_cast<int>(chunk.texcoords.size()),
+            static_cast<int>(chunk.normals.size())
+        };
+        int* fields[3] = {&corner.position, &corner.texcoord, &corner.normal};
+        for (int field = 0; field < 3; field++)
+        {
+            if (field > 0)
+            {
+                if (p >= end || *p != '/')
+                    break;
+                p++;
+                if (p < end && *p == '/')
+                    continue; // v//vn
+            }
+            if (p >= end || !(isDigit(*p) || *p == '-' || *p == '+'))
+                return false;
+            int index = parseInt(p, end);
+            if (index > 0)
+            {
+                *fields[field] = index - 1;
+            }
+            else if (index < 0)
+            {
+                *fields[field] = counts[field] + index;
+                corner.relative |= static_cast<uint8_t>(1 << field);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void parseChunk(const char* p, const char* end, Chunk& chunk)
+    {
+        using namespace objparse;
+        // 按平均行长预估容量，减少扩容
+        size_t estimate = static_cast<size_t>(end - p) / 32;
+        chunk.positions.reserve(estimate / 3);
+        chunk.corners.reserve(estimate);
+        std::vector<Corner> polygon;
+        while (p < end)
+        {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            const char* lineEnd = newline != nullptr ? newline : end;
+            const char* line = skipBlanks(p, lineEnd);
+            const char* q = line;
+            p = newline != nullptr ? newline + 1 : end;
+            if (q >= lineEnd || *q == '#')
+                continue;
+
+            if (keyword(q, lineEnd, "v", 1))
+            {
+                q += 2;
+                glm::vec3 v;
+                v.x = parseFloat(q, lineEnd);
+                v.y = parseFloat(q, lineEnd);
+                v.z = parseFloat(q, lineEnd);
+                chunk.positions.push_back(v);
+            }
+            else if (keyword(q, lineEnd, "vt", 2))
+            {
+                q += 3;
+                glm::vec2 t;
+                t.x = parseFloat(q, lineEnd);
+                q = skipBlanks(q, lineEnd);
+                t.y = q < lineEnd ? parseFloat(q, lineEnd) : 0.0f;
+                chunk.texcoords.push_back(t);
+            }
+            else if (keyword(q, lineEnd, "vn", 2))
+            {
+                q += 3;
+                glm::vec3 n;
+                n.x = parseFloat(q, lineEnd);
+                n.y = parseFloat(q, lineEnd);
+                n.z = parseFloat(q, lineEnd);
+                chunk.normals.push_back(n);
+            }
+            else if (keyword(q, lineEnd, "f", 1))
+            {
+                q += 2;
+                polygon.clear();
+                for (q = skipBlanks(q, lineEnd); q < lineEnd; q = skipBlanks(q, lineEnd))
+                {
+                    Corner corner;
+                    if (!parseCorner(q, lineEnd, chunk, corner))
+                    {
+                        chunk.error = "malformed face: " + rest(line, lineEnd);
+                        return;
+                    }
+                    polygon.push_back(corner);
+                }
+                // 扇形三角化，与aiProcess_Triangulate对凸多边形的结果相同
+                for (size_t i = 1; i + 1 < polygon.size(); i++)
+                {
+                    polygon[0].polygonStart = i == 1;
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i]);
+                    chunk.corners.push_back(polygon[i + 1]);
+                }
+            }
+            else if (keyword(q, lineEnd, "o", 1) || keyword(q, lineEnd, "g", 1))
+            {
+                chunk.changes.push_back(GroupChange{chunk.corners.size() / 3, *q, rest(q + 2, lineEnd)});
+            }
+            else if (keyword(q, lineEnd, "usemtl", 6))
+            {
+                chunk.changes.push_back(GroupChange{chunk.corners.size() / 3, 'm', rest(q + 7, lineEnd)});
+            }
+            else if (keyword(q, lineEnd, "mtllib", 6))
+            {
+                std::istringstream names(rest(q + 7, lineEnd));
+                std::string name;
+                while (names >> name)
+                    chunk.libraries.push_back(name);
+            }
+            // 其他语句（s、l、p、曲面等）不影响三角网格
+        }
+    }
+
+    static void loadMaterials(const std::string& path, std::vector<ObjMaterial>& materials)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "WARNING::OBJ:: cannot open material library " << path << std::endl;
+            return;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const char* p = objparse::skipBlanks(line.data(), line.data() + line.size());
+            const char* end = line.data() + line.size();
+            std::string statement;
+            for (const char* q = p; q < end && !objparse::isBlank(*q); q++)
+                statement += *q;
+            if (statement.empty() || statement[0] == '#')
+                continue;
+            std::string value = objparse::rest(p + statement.size(), end);
+            // 纹理语句可带选项（-bm 1 等），文件名取最后一个词
+            std::string file = value.substr(value.find_last_of(" \t") == std::string::npos ? 0
+                                            : value.find_last_of(" \t") + 1);
+            if (statement == "newmtl")
+            {
+                materials.emplace_back();
+                materials.back().name = value;
+            }
+            else if (materials.empty() || file.empty())
+            {
+                continue;
+            }
+            else if (statement == "map_Kd")
+            {
+                materials.back().diffuse.push_back(file);
+            }
+            else if (statement == "map_Ks")
+            {
+                materials.back().specular.push_back(file);
+            }
+            else if (statement == "map_Bump" || statement == "map_bump" || statement == "bump")
+            {
+                materials.back().normal.push_back(file);
+            }
+            else if (statement == "map_Ka")
+            {
+                materials.back().height.push_back(file);
+            }
+        }
+    }
+
+    // 全局编号为index的属性；base[c]为第c块的起始编号，块数不超过线程数，二分查找的开销可以忽略。
+    // 空块与下一块的起始编号相同，upper_bound落在最后一个起始编号不大于index的块，即非空的那一块
+    template <class T>
+    static const T& attribute(const std::vector<Chunk>& chunks, const std::vector<int>& base,
+                              std::vector<T> Chunk::*member, int index)
+    {
+        size_t c = static_cast<size_t>(std::upper_bound(base.begin(), base.end(), index) - base.begin()) - 1;
+        return (chunks[c].*member)[index - base[c]];
+    }
+
+    bool merge(const std::vector<Chunk>& chunks, ObjModel& model)
+    {
+        // 各块属性在全局编号中的起始位置；属性留在各块中，按编号查找所在的块，不再复制到全局数组
+        std::vector<int> positionBase(chunks.size()), texcoordBase(chunks.size()), normalBase(chunks.size());
+        size_t positionCount = 0, texcoordCount = 0, normalCount = 0;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            positionBase[i] = static_cast<int>(positionCount);
+            texcoordBase[i] = static_cast<int>(texcoordCount);
+            normalBase[i] = static_cast<int>(normalCount);
+            positionCount += chunks[i].positions.size();
+            texcoordCount += chunks[i].texcoords.size();
+            normalCount += chunks[i].normals.size();
+        }
+
+        // 按语句顺序切分网格，规则与Assimp的ObjFileParser相同（见类注释）
+        std::vector<Group> groups;
+        std::vector<std::string> objects;
+        std::string object, activeGroup, material;
+        auto startMesh = [&]
+        {
+            groups.emplace_back();
+            groups.back().object = object;
+            groups.back().material = material;
+        };
+        for (size_t c = 0; c < chunks.size(); c++)
+        {
+            const Chunk& chunk = chunks[c];
+            size_t triangleCount = chunk.corners.size() / 3;
+            size_t first = 0, change = 0;
+            while (first < triangleCount || change < chunk.changes.size())
+            {
+                while (change < chunk.changes.size() && chunk.changes[change].triangle <= first)
+                {
+                    const GroupChange& g = chunk.changes[change++];
+                    if (g.statement == 'o')
+                    {
+                        if (std::find(objects.begin(), objects.end(), g.name) != objects.end())
+                            continue; // 回到已有对象时Assimp继续写入当前网格
+                        objects.push_back(g.name);
+                        object = g.name;
+                        startMesh();
+                    }
+                    else if (g.statement == 'g')
+                    {
+                        if (g.name == activeGroup)
+                            continue;
+                        activeGroup = g.name;
+                        objects.push_back(g.name);
+                        object = g.name;
+                        startMesh();
+                    }
+                    else if (g.name != material)
+                    {
+                        material = g.name;
+                        if (groups.empty() || !groups.back().runs.empty())
+                            startMesh();
+                        else
+                            groups.back().material = material;
+                    }
+                }
+                size_t last = change < chunk.changes.size() ? chunk.changes[change].triangle : triangleCount;
+                if (last > first)
+                {
+                    if (groups.empty())
+                        startMesh();
+                    groups.back().runs.push_back(Run{c, first, last - first});
+                }
+                first = last;
+                if (change >= chunk.changes.size() && first >= triangleCount)
+                    break;
+            }
+        }
+        groups.erase(std::remove_if(groups.begin(), groups.end(), [](const Group& g) { return g.runs.empty(); }),
+                     groups.end());
+
+        model.meshes.resize(groups.size());
+        std::vector<std::string> errors(groups.size());
+        parallel(groups.size(), [&](size_t g)
+        {
+            ObjMesh& mesh = model.meshes[g];
+            mesh.object = groups[g].object;
+            for (size_t m = 0; m < model.materials.size(); m++)
+            {
+                if (model.materials[m].name == groups[g].material)
+                    mesh.material = static_cast<int>(m);
+            }
+
+            size_t cornerCount = 0;
+            for (const Run& run : groups[g].runs)
+                cornerCount += run.count * 3;
+            VertexTable unique(cornerCount);
+            mesh.indices.reserve(cornerCount);
+            mesh.vertices.reserve(cornerCount / 2); // 共享顶点的网格通常远少于面顶点数
+            bool hasNormals = false, hasTexcoords = false;
+
+            // Assimp为每个多边形顶点各建一个顶点，按文件顺序排列；三角化后多个三角形共用的多边形顶点
+            // 取最后写入它的三角形的面法线与切线。polygonCorners按这个顺序记录对应的面顶点（mesh.indices中的下标）
+            std::vector<unsigned int> polygonCorners;
+            polygonCorners.reserve(cornerCount / 2 + 2);
+            size_t polygonFirst = 0;
+            auto endPolygon = [&](size_t end)
+            {
+                if (end <= polygonFirst)
+                    return;
+                const unsigned int last = static_cast<unsigned int>(end - 1) * 3;
+                polygonCorners.push_back(last);
+                for (size_t t = polygonFirst; t < end; t++)
+                    polygonCorners.push_back(static_cast<unsigned int>(t) * 3 + 1);
+                polygonCorners.push_back(last + 2);
+                polygonFirst = end;
+            };
+
+            for (const Run& run : groups[g].runs)
+            {
+                const Chunk& chunk = chunks[run.chunk];
+                for (size_t i = run.first * 3; i < (run.first + run.count) * 3; i++)
+                {
+                    const Corner& corner = chunk.corners[i];
+                    if (i % 3 == 0 && corner.polygonStart)
+                        endPolygon(mesh.indices.size() / 3);
+                    VertexKey key = {
+                        corner.position + ((corner.relative & 1) ? positionBase[run.chunk] : 0),
+                        corner.texcoord == NONE ? -1 : corner.texcoord + ((corner.relative & 2) ? texcoordBase[run.chunk] : 0),
+                        corner.normal == NONE ? -1 : corner.normal + ((corner.relative & 4) ? normalBase[run.chunk] : 0)
+                    };
+                    if (key.position < 0 || key.position >= static_cast<int>(positionCount) ||
+                        key.texcoord >= static_cast<int>(texcoordCount) || key.normal >= static_cast<int>(normalCount) ||
+                        (corner.texcoord != NONE && key.texcoord < 0) || (corner.normal != NONE && key.normal < 0))
+                    {
+                        errors[g] = "face index out of range";
+                        return;
+                    }
+
+                    bool inserted = false;
+                    unsigned int index = unique.insert(key, static_cast<unsigned int>(mesh.vertices.size()), inserted);
+                    if (inserted)
+                    {
+                        Vertex vertex;
+                        vertex.Position = attribute(chunks, positionBase, &Chunk::positions, key.position);
+                        vertex.Normal = glm::vec3(0.0f);
+                        vertex.TexCoords = glm::vec2(0.0f);
+                        vertex.Tangent = glm::vec3(0.0f);
+                        vertex.Bitangent = glm::vec3(0.0f);
+                        std::fill(std::begin(vertex.m_BoneIDs), std::end(vertex.m_BoneIDs), 0);
+                        std::fill(std::begin(vertex.m_Weights), std::end(vertex.m_Weights), 0.0f);
+                        if (key.normal >= 0)
+                        {
+                            vertex.Normal = attribute(chunks, normalBase, &Chunk::normals, key.normal);
+                            hasNormals = true;
+                        }
+                        if (key.texcoord >= 0)
+                        {
+                            const glm::vec2& t = attribute(chunks, texcoordBase, &Chunk::texcoords, key.texcoord);
+                            vertex.TexCoords = glm::vec2(t.x, 1.0f - t.y);
+                            hasTexcoords = true;
+                        }
+                        mesh.vertices.push_back(vertex);
+                    }
+                    mesh.indices.push_back(index);
+                }
+            }
+
+            endPolygon(mesh.indices.size() / 3);
+
+            if (!hasNormals || hasTexcoords)
+            {
+                PositionGrid grid(mesh, polygonCorners);
+                if (!hasNormals)
+                    smoothNormals(mesh, polygonCorners, grid);
+                if (hasTexcoords)
+                    computeTangents(mesh, polygonCorners, grid);
+            }
+        });
+
+        for (const std::string& e : errors)
+        {
+            if (!e.empty())
+            {
+                error = e;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 在多边形顶点中查找与给定位置距离小于epsilon的点，epsilon与Assimp的ComputePositionEpsilon相同（包围盒对角线的1e-4）
+    // 点按边长为2*epsilon的网格排序，一次查询最多检查2x2x2个格子
+    class PositionGrid
+    {
+    public:
+        float epsilon = 0.0f;
+
+        PositionGrid(const ObjMesh& mesh, const std::vector<unsigned int>& corners) : mesh(mesh), corners(corners)
+        {
+            if (corners.empty())
+                return;
+            glm::vec3 high = position(0);
+            low = high;
+            for (size_t i = 1; i < corners.size(); i++)
+            {
+                low = glm::min(low, position(i));
+                high = glm::max(high, position(i));
+            }
+            epsilon = glm::length(high - low) * 1e-4f;
+            cellSize = epsilon > 0.0f ? 2.0f * epsilon : 1.0f;
+            cells.resize(corners.size());
+            for (size_t i = 0; i < corners.size(); i++)
+            {
+                glm::vec3 p = position(i);
+                cells[i] = Cell{key(cell(p.x, low.x), cell(p.y, low.y), cell(p.z, low.z)), static_cast<unsigned int>(i)};
+            }
+            std::sort(cells.begin(), cells.end());
+        }
+
+        glm::vec3 position(size_t i) const
+        {
+            return mesh.vertices[mesh.indices[corners[i]]].Position;
+        }
+
+        // found按格子内编号升序返回所有满足条件的点（包括位置相同的点自身）
+        void find(const glm::vec3& p, std::vector<unsigned int>& found) const
+        {
+            found.clear();
+            const float squared = epsilon * epsilon;
+            uint64_t first[3], last[3];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                first[axis] = cell(p[axis] - epsilon, low[axis]);
+                last[axis] = cell(p[axis] + epsilon, low[axis]);
+            }
+            for (uint64_t x = first[0]; x <= last[0]; x++)
+            {
+                for (uint64_t y = first[1]; y <= last[1]; y++)
+                {
+                    for (uint64_t z = first[2]; z <= last[2]; z++)
+                    {
+                        const uint64_t k = key(x, y, z);
+                        auto it = std::lower_bound(cells.begin(), cells.end(), Cell{k, 0});
+                        for (; it != cells.end() && it->key == k; ++it)
+                        {
+                            glm::vec3 d = position(it->point) - p;
+                            float distance = glm::dot(d, d);
+                            if (distance < squared || distance == 0.0f)
+                                found.push_back(it->point);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            uint64_t key;
+            unsigned int point;
+
+            bool operator<(const Cell& other) const
+            {
+                return key < other.key || (key == other.key && point < other.point);
+            }
+        };
+
+        const ObjMesh& mesh;
+        const std::vector<unsigned int>& corners;
+        std::vector<Cell> cells;
+        glm::vec3 low = glm::vec3(0.0f);
+        float cellSize = 1.0f;
+
+        // 每轴21位；包围盒内最多约5000个格子，越界的查询范围截到边界
+        uint64_t cell(float value, float origin) const
+        {
+            float c = std::floor((value - origin) / cellSize);
+            return !(c > 0.0f) ? 0 : static_cast<uint64_t>(std::min(c, 2097151.0f));
+        }
+
+        static uint64_t key(uint64_t x, uint64_t y, uint64_t z)
+        {
+            return (x << 42) | (y << 21) | z;
+        }
+    };
+
+    static glm::vec3 normalizeSafe(const glm::vec3& v)
+    {
+        float length = glm::length(v);
+        return length > 0.0f ? v / length : v;
+    }
+
+    // 与aiProcess_GenSmoothNormals（最大平滑角为默认的175度，即不限角度）相同：
+    // 每个多边形顶点取所在三角形的单位面法线，按顶点顺序依次取未处理的顶点，
+    // 把半径epsilon内所有顶点的面法线之和单位化后写回这些顶点
+    static void smoothNormals(ObjMesh& mesh, const std::vector<unsigned int>& corners, const PositionGrid& grid)
+    {
+        std::vector<glm::vec3> faceNormals(corners.size());
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            const unsigned int* triangle = &mesh.indices[corners[i] / 3 * 3];
+            const glm::vec3& p0 = mesh.vertices[triangle[0]].Position;
+            faceNormals[i] = normalizeSafe(glm::cross(mesh.vertices[triangle[1]].Position - p0,
+                                                      mesh.vertices[triangle[2]].Position - p0));
+        }
+
+        // 同一去重顶点的多边形顶点位置相同，总在同一组中，写入的法线也相同
+        std::vector<bool> done(corners.size(), false);
+        std::vector<unsigned int> found;
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            if (done[i])
+                continue;
+            grid.find(grid.position(i), found);
+            glm::vec3 sum(0.0f);
+            for (unsigned int f : found)
+                sum += faceNormals[f];
+            sum = normalizeSafe(sum);
+            for (unsigned int f : found)
+            {
+                mesh.vertices[mesh.indices[corners[f]]].Normal = sum;
+                done[f] = true;
+            }
+        }
+    }
+
+    // 与aiProcess_CalcTangentSpace（默认最大平滑角45度）相同，对每个多边形顶点：
+    // 用所在三角形前两条边与未翻转的纹理坐标差求切线与副切线（纹理坐标退化时取默认方向），
+    // 投影到顶点法线的平面上并正交化；然后按顶点顺序，把半径epsilon内法线相同、切线与副切线夹角都不超过45度的
+    // 多边形顶点的切线平均。最后每个去重顶点取其多边形顶点结果之和的单位向量
+    static void computeTangents(ObjMesh& mesh, const std::vector<unsigned int>& corners, const PositionGrid& grid)
+    {
+        std::vector<glm::vec3> tangents(corners.size()), bitangents(corners.size());
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            const unsigned int* triangle = &mesh.indices[corners[i] / 3 * 3];
+            const Vertex& a = mesh.vertices[triangle[0]];
+            const Vertex& b = mesh.vertices[triangle[1]];
+            const Vertex& c = mesh.vertices[triangle[2]];
+            glm::vec3 v = b.Position - a.Position, w = c.Position - a.Position;
+            // TexCoords已经翻转了v，Assimp在FlipUVs之前计算切线
+            float sx = b.TexCoords.x - a.TexCoords.x, sy = a.TexCoords.y - b.TexCoords.y;
+            float tx = c.TexCoords.x - a.TexCoords.x, ty = a.TexCoords.y - c.TexCoords.y;
+            float direction = (tx * sy - ty * sx) < 0.0f ? -1.0f : 1.0f;
+            if (sx * ty == sy * tx)
+            {
+                sx = 0.0f;
+                sy = 1.0f;
+                tx = 1.0f;
+                ty = 0.0f;
+            }
+            glm::vec3 tangent = (w * sy - v * ty) * direction;
+            glm::vec3 bitangent = (v * tx - w * sx) * direction;
+
+            const glm::vec3& n = mesh.vertices[mesh.indices[corners[i]]].Normal;
+            glm::vec3 localTangent = tangent - n * glm::dot(tangent, n);
+            glm::vec3 localBitangent = bitangent - n * glm::dot(bitangent, n) - localTangent * glm::dot(bitangent, localTangent);
+            localTangent = normalizeSafe(localTangent);
+            localBitangent = normalizeSafe(localBitangent);
+            bool tangentValid = std::isfinite(localTangent.x) && std::isfinite(localTangent.y) && std::isfinite(localTangent.z);
+            bool bitangentValid = std::isfinite(localBitangent.x) && std::isfinite(localBitangent.y) &&
+                                  std::isfinite(localBitangent.z);
+            if (!tangentValid && bitangentValid)
+                localTangent = normalizeSafe(glm::cross(n, localBitangent));
+            else if (tangentValid && !bitangentValid)
+                localBitangent = normalizeSafe(glm::cross(localTangent, n));
+            tangents[i] = localTangent;
+            bitangents[i] = localBitangent;
+        }
+
+        const float sameNormal = 0.9999f, limit = std::cos(glm::radians(45.0f));
+        std::vector<bool> done(corners.size(), false);
+        std::vector<unsigned int> found, close;
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            if (done[i])
+                continue;
+            const glm::vec3 n = mesh.vertices[mesh.indices[corners[i]]].Normal;
+            const glm::vec3 t = tangents[i], b = bitangents[i];
+            grid.find(grid.position(i), found);
+            // 与Assimp一样，起点自身先放入一次，查找结果中还会再出现一次
+            close.assign(1, static_cast<unsigned int>(i));
+            for (unsigned int f : found)
+            {
+                if (done[f] || glm::dot(mesh.vertices[mesh.indices[corners[f]]].Normal, n) < sameNormal ||
+                    glm::dot(tangents[f], t) < limit || glm::dot(bitangents[f], b) < limit)
+                    continue;
+                close.push_back(f);
+                done[f] = true;
+            }
+            glm::vec3 tangentSum(0.0f), bitangentSum(0.0f);
+            for (unsigned int f : close)
+            {
+                tangentSum += tangents[f];
+                bitangentSum += bitangents[f];
+            }
+            tangentSum = normalizeSafe(tangentSum);
+            bitangentSum = normalizeSafe(bitangentSum);
+            for (unsigned int f : close)
+            {
+                tangents[f] = tangentSum;
+                bitangents[f] = bitangentSum;
+            }
+        }
+
+        for (size_t i = 0; i < corners.size(); i++)
+        {
+            Vertex& vertex = mesh.vertices[mesh.indices[corners[i]]];
+            vertex.Tangent += tangents[i];
+            vertex.Bitangent += bitangents[i];
+        }
+        for (Vertex& vertex : mesh.vertices)
+        {
+            vertex.Tangent = normalizeSafe(vertex.Tangent);
+            vertex.Bitangent = normalizeSafe(vertex.Bitangent);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// 鼠标拾取：屏幕坐标与世界空间射线、平面求交（拖动树桩使用）
+// 除screenToWorldCoords外都不访问GL，可在没有窗口的基准测试中调用
+
+// 读取像素深度反投影到世界坐标（需要GL上下文，读取当前绑定的帧缓冲）
+inline glm::vec3 screenToWorldCoords(double xpos, double ypos, GLFWwindow* window, glm::mat4 view, glm::mat4 projection)
+{
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    float z;
+    glReadPixels(xpos, height - ypos, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &z);
+
+    glm::vec4 screenPos = glm::vec4(
+        (2.0f * xpos) / width - 1.0f,
+        1.0f - (2.0f * ypos) / height,
+        z * 2.0f - 1.0f,
+        1.0f
+    );
+
+    glm::vec4 worldPos = glm::inverse(projection * view) * screenPos;
+    worldPos /= worldPos.w;
+
+    return glm::vec3(worldPos.x, worldPos.y, worldPos.z);
+}
+
+// 屏幕坐标对应的世界空间射线方向
+inline glm::vec3 ScreenPosToWorldRay(int mouseX, int mouseY, int screenWidth, int screenHeight, glm::mat4 ViewMatrix,
+                                     glm::mat4 ProjectionMatrix)
+{
+    glm::vec4 rayStartNDC(
+        ((float)mouseX / (float)screenWidth - 0.5f) * 2.0f,
+        ((float)mouseY / (float)screenHeight - 0.5f) * 2.0f,
+        -1.0f,
+        1.0f
+    );
+    glm::vec4 rayEndNDC(
+        ((float)mouseX / (float)screenWidth - 0.5f) * 2.0f,
+        ((float)mouseY / (float)screenHeight - 0.5f) * 2.0f,
+        0.0f,
+        1.0f
+    );
+
+    glm::vec4 rayStartWorld = glm::inverse(ProjectionMatrix * ViewMatrix) * rayStartNDC;
+    rayStartWorld /= rayStartWorld.w;
+    glm::vec4 rayEndWorld = glm::inverse(ProjectionMatrix * ViewMatrix) * rayEndNDC;
+    rayEndWorld /= rayEndWorld.w;
+
+    glm::vec3 rayDirWorld(rayEndWorld - rayStartWorld);
+    rayDirWorld = glm::normalize(rayDirWorld);
+
+    return rayDirWorld;
+}
+
+// 射线与平面的交点，射线与平面平行时返回原点
+inline glm::vec3 RayPlaneIntersection(glm::vec3 rayOrigin, glm::vec3 rayDirection, glm::vec3 planeNormal,
+                                      glm::vec3 planePoint)
+{
+    float denom = glm::dot(planeNormal, rayDirection);
+    if (std::fabs(denom) > 0.0001f)
+    {
+        // 非平行
+        float t = glm::dot(planePoint - rayOrigin, planeNormal) / denom;
+        return rayOrigin + rayDirection * t;
+    }
+    return glm::vec3(0, 0, 0);
+}
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// 帧性能分析器
+// 编译时定义 SNOW_PROFILER 启用。未定义时所有宏展开为空语句，不产生任何开销。
+//
+//   PROFILE_FRAME_BEGIN();             每帧开始时调用，回收已完成的GPU计时查询
+//   PROFILE_SCOPE("name");             记录所在作用域的CPU耗时
+//   PROFILE_GPU_SCOPE("name");         同时记录CPU耗时与GPU耗时（GL_TIME_ELAPSED，不可嵌套）
+//   PROFILE_DUMP("trace.json");        把滚动缓冲区导出为Chrome trace-event JSON（chrome://tracing）
+
+#ifdef SNOW_PROFILER
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProfileEvent
+{
+    const char* name;
+    double start; // 微秒，相对于分析器创建时刻
+    double duration; // 微秒
+    uint32_t frame;
+    uint32_t thread; // GPU事件固定为0
+};
+
+class Profiler
+{
+public:
+    static constexpr size_t EVENT_CAPACITY = 1 << 16; // 滚动缓冲区大小
+    static constexpr int QUERY_FRAMES = 4; // GPU查询环的帧数，回读延迟QUERY_FRAMES帧
+    static constexpr int MAX_GPU_SCOPES = 32; // 每帧最多的GPU计时作用域
+
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    double now() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    uint32_t currentFrame() const
+    {
+        return frameIndex;
+    }
+
+    // 开始新的一帧：回收即将被复用的查询槽（QUERY_FRAMES帧之前提交）中已经可用的结果，
+    // 未完成的直接丢弃，从不等待GPU
+    void beginFrame()
+    {
+        if (!queriesCreated)
+        {
+            glGenQueries(QUERY_FRAMES * MAX_GPU_SCOPES, &queries[0][0]);
+            queriesCreated = true;
+        }
+        frameIndex++;
+        collect(frameIndex % QUERY_FRAMES);
+    }
+
+    void record(const char* name, double start, double end)
+    {
+        ProfileEvent e{name, start, end - start, frameIndex, threadIndex()};
+        std::lock_guard<std::mutex> lock(mutex);
+        push(e);
+    }
+
+    // 返回-1表示无法开始GPU计时（查询已满或已有GPU作用域处于活动状态）
+    int beginGpu(const char* name, double cpuStart)
+    {
+        int slot = frameIndex % QUERY_FRAMES;
+        if (!queriesCreated || gpuActive || gpuScopeCount[slot] >= MAX_GPU_SCOPES)
+            return -1;
+        int index = gpuScopeCount[slot]++;
+        gpuPending[slot][index] = PendingQuery{name, cpuStart, frameIndex};
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][index]);
+        gpuActive = true;
+        return index;
+    }
+
+    void endGpu(int index)
+    {
+        if (index < 0)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuActive = false;
+    }
+
+    uint64_t droppedGpuQueries() const
+    {
+        return droppedQueries;
+    }
+
+    void dumpChromeTrace(const std::string& path)
+    {
+        std::vector<ProfileEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t count = eventCount < EVENT_CAPACITY ? eventCount : EVENT_CAPACITY;
+            events.reserve(count);
+            size_t first = eventCount - count;
+            for (size_t i = first; i < eventCount; i++)
+                events.push_back(ring[i % EVENT_CAPACITY]);
+        }
+
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "ERROR::PROFILER:: failed to open " << path << std::endl;
+            return;
+        }
+        out << "{\"traceEvents\":[\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+        for (const ProfileEvent& e : events)
+        {
+            out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << (e.thread == 0 ? "gpu" : "cpu")
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.start
+                << ",\"dur\":" << e.duration << ",\"args\":{\"frame\":" << e.frame << "}}";
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        std::cout << "profiler: wrote " << events.size() << " events to " << path << std::endl;
+    }
+
+private:
+    struct PendingQuery
+    {
+        const char* name;
+        double cpuStart;
+        uint32_t frame;
+    };
+
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::mutex mutex;
+    std::vector<ProfileEvent> ring = std::vector<ProfileEvent>(EVENT_CAPACITY);
+    size_t eventCount = 0;
+    std::atomic<uint32_t> frameIndex{0};
+
+    bool queriesCreated = false;
+    bool gpuActive = false;
+    unsigned int queries[QUERY_FRAMES][MAX_GPU_SCOPES];
+    PendingQuery gpuPending[QUERY_FRAMES][MAX_GPU_SCOPES];
+    int gpuScopeCount[QUERY_FRAMES] = {};
+    double gpuTimelineEnd = 0.0;
+    uint64_t droppedQueries = 0;
+
+    Profiler() = default;
+
+    void push(const ProfileEvent& e)
+    {
+        ring[eventCount % EVENT_CAPACITY] = e;
+        eventCount++;
+    }
+
+    uint32_t threadIndex()
+    {
+        // 0号保留给GPU时间线
+        static std::mutex idMutex;
+        static std::vector<std::thread::id> ids;
+        thread_local uint32_t index = 0;
+        if (index == 0)
+        {
+            std::lock_guard<std::mutex> lock(idMutex);
+            ids.push_back(std::this_thread::get_id());
+            index = static_cast<uint32_t>(ids.size());
+        }
+        return index;
+    }
+
+    void collect(int slot)
+    {
+        for (int i = 0; i < gpuScopeCount[slot]; i++)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot][i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                droppedQueries++;
+                continue;
+            }
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[slot][i], GL_QUERY_RESULT, &elapsed);
+
+            // GL_TIME_ELAPSED没有绝对时间戳：GPU事件按提交顺序首尾相接，且不早于对应的CPU提交时刻
+            const PendingQuery& q = gpuPending[slot][i];
+            double start = q.cpuStart > gpuTimelineEnd ? q.cpuStart : gpuTimelineEnd;
+            double duration = static_cast<double>(elapsed) / 1000.0;
+            gpuTimelineEnd = start + duration;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            push(ProfileEvent{q.name, start, duration, q.frame, 0});
+        }
+        gpuScopeCount[slot] = 0;
+    }
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name, bool gpu) : name(name)
+    {
+        Profiler& profiler = Profiler::instance();
+        start = profiler.now();
+        gpuIndex = gpu ? profiler.beginGpu(name, start) : -1;
+    }
+
+    ~ProfileScope()
+    {
+        Profiler& profiler = Profiler::instance();
+        profiler.endGpu(gpuIndex);
+        profiler.record(name, start, profiler.now());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    double start;
+    int gpuIndex;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_FRAME_BEGIN() Profiler::instance().beginFrame()
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+#define PROFILE_DUMP(path) Profiler::instance().dumpChromeTrace(path)
+
+#else
+
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_DUMP(path) ((void)0)
+
+#endif
+
+#endif
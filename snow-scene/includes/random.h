@@ -0,0 +1,171 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// 伪随机数生成
+// Xoshiro128** 单路生成器：状态只有16字节，无全局状态，每个线程/用途各持有一个实例；
+// Xoshiro128x8 把8路独立的生成器按分量（SoA）排列，批量填充时8路的更新互不依赖，编译器可以自动向量化。
+// 两者都由SplitMix64从一个64位种子展开状态，相同种子得到完全相同的序列。
+
+inline uint64_t splitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline uint32_t rotl32(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// 取高24位映射到 [0, 1)
+inline float uintToUnitFloat(uint32_t x)
+{
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+class Xoshiro128
+{
+public:
+    explicit Xoshiro128(uint64_t seed = 1)
+    {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t seed)
+    {
+        uint64_t sm = seed;
+        uint64_t a = splitMix64(sm), b = splitMix64(sm);
+        s[0] = static_cast<uint32_t>(a);
+        s[1] = static_cast<uint32_t>(a >> 32);
+        s[2] = static_cast<uint32_t>(b);
+        s[3] = static_cast<uint32_t>(b >> 32);
+    }
+
+    uint32_t next()
+    {
+        uint32_t result = rotl32(s[1] * 5, 7) * 9;
+        uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl32(s[3], 11);
+        return result;
+    }
+
+    // [0, 1)
+    float nextFloat()
+    {
+        return uintToUnitFloat(next());
+    }
+
+    // [min, max)
+    float range(float min, float max)
+    {
+        return min + (max - min) * nextFloat();
+    }
+
+    // 泊松分布采样，mean为期望值；期望较小时用乘积法，较大时用正态近似
+    uint32_t poisson(float mean)
+    {
+        if (mean <= 0.0f)
+            return 0;
+        if (mean < 30.0f)
+        {
+            float limit = std::exp(-mean);
+            float product = nextFloat();
+            uint32_t count = 0;
+            while (product > limit)
+            {
+                count++;
+                product *= nextFloat();
+            }
+            return count;
+        }
+        // Box-Muller
+        float u1 = 1.0f - nextFloat();
+        float u2 = nextFloat();
+        float normal = std::sqrt(-2.0f * std::log(u1)) * std::cos(6.28318530718f * u2);
+        float value = std::floor(mean + std::sqrt(mean) * normal + 0.5f);
+        return value > 0.0f ? static_cast<uint32_t>(value) : 0;
+    }
+
+private:
+    uint32_t s[4];
+};
+
+class Xoshiro128x8
+{
+public:
+    static constexpr int LANES = 8;
+
+    explicit Xoshiro128x8(uint64_t seed = 1)
+    {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t seed)
+    {
+        uint64_t sm = seed;
+        for (int lane = 0; lane < LANES; lane++)
+        {
+            uint64_t a = splitMix64(sm), b = splitMix64(sm);
+            s0[lane] = static_cast<uint32_t>(a);
+            s1[lane] = static_cast<uint32_t>(a >> 32);
+            s2[lane] = static_cast<uint32_t>(b);
+            s3[lane] = static_cast<uint32_t>(b >> 32);
+        }
+    }
+
+    // 生成LANES个32位随机数
+    void next(uint32_t* out)
+    {
+        for (int lane = 0; lane < LANES; lane++)
+        {
+            uint32_t result = rotl32(s1[lane] * 5, 7) * 9;
+            uint32_t t = s1[lane] << 9;
+            s2[lane] ^= s0[lane];
+            s3[lane] ^= s1[lane];
+            s1[lane] ^= s2[lane];
+            s0[lane] ^= s3[lane];
+            s2[lane] ^= t;
+            s3[lane] = rotl32(s3[lane], 11);
+            out[lane] = result;
+        }
+    }
+
+    // 用 [min, max) 的均匀浮点数填满out[0, count)
+    void fill(float* out, size_t count, float min = 0.0f, float max = 1.0f)
+    {
+        float scale = (max - min) * (1.0f / 16777216.0f);
+        uint32_t block[LANES];
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES)
+        {
+            next(block);
+            for (int lane = 0; lane < LANES; lane++)
+                out[i + lane] = min + static_cast<float>(block[lane] >> 8) * scale;
+        }
+        if (i < count)
+        {
+            next(block);
+            for (int lane = 0; i < count; lane++, i++)
+                out[i] = min + static_cast<float>(block[lane] >> 8) * scale;
+        }
+    }
+
+private:
+    alignas(32) uint32_t s0[LANES];
+    alignas(32) uint32_t s1[LANES];
+    alignas(32) uint32_t s2[LANES];
+    alignas(32) uint32_t s3[LANES];
+};
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "commandlist.h"
+#include "glstats.h"
+#include "memstats.h"
+#include "mesh.h"
+#include "model.h"
+#include "scene.h"
+#include "shader.h"
+#include "texturestream.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ResidencyStats
+{
+    uint64_t hits = 0;      // 绘制时模型已驻留
+    uint64_t misses = 0;    // 绘制时只能画占位包围盒（或什么都不画）
+    uint64_t loads = 0;
+    uint64_t reloads = 0;   // 被驱逐后又重新加载，反映预算抖动
+    uint64_t evictions = 0; // 超出预算被驱逐
+    uint64_t unloads = 0;   // 摄像机远离后卸载
+    double importMs = 0.0;      // 所有加载的导入耗时之和
+    size_t importPeakBytes = 0; // 单次导入的主机内存峰值（Model::ImportStats::peakBytes）的最大值
+};
+
+// 模型资源驻留管理
+// 每个资源绑定一个场景节点，摄像机进入loadRadius后按距离由近到远加载（每帧最多maxLoadsPerFrame个，
+// Assimp导入在渲染线程同步完成，纹理仍经TextureStreamer异步上传）；摄像机离开loadRadius*unloadFactor后卸载，
+// 两个半径之间不加载也不卸载，避免在边界附近反复导入。
+// 驻留的资源按最近绘制时间排成LRU链表；CPU或GPU占用超过预算时先驱逐最久未绘制的，同样最近绘制的先驱逐离摄像机远的，
+// 驱逐后只保留局部包围盒，绘制时用共享的灰色立方体代替。本帧刚加载与纹理仍在上传中的资源尺寸未定，不会被驱逐。
+// 被驱逐的资源记下上次测得的占用，只有驱逐比它更远的资源后放得下时才重新加载，不会每帧加载又驱逐。
+// 占用取自内存账本中记在模型路径名下的对象：CPU为Mesh保留的顶点/索引副本，GPU为顶点/索引缓冲与纹理（含mip链）。
+class AssetResidency
+{
+public:
+    size_t cpuBudget = 256u << 20;
+    size_t gpuBudget = 512u << 20;
+    int maxLoadsPerFrame = 1;
+    float unloadFactor = 1.25f;
+
+    AssetResidency() = default;
+    AssetResidency(const AssetResidency&) = delete;
+    AssetResidency& operator=(const AssetResidency&) = delete;
+
+    // 注册资源，不加载；node为放置它的场景节点
+    int add(const std::string& path, int node, float loadRadius, TextureStreamer* streamer = nullptr)
+    {
+        Asset asset;
+        asset.path = path;
+        asset.node = node;
+        asset.loadRadius = loadRadius;
+        asset.streamer = streamer;
+        assets.push_back(std::move(asset));
+        return static_cast<int>(assets.size()) - 1;
+    }
+
+    // 立即加载并返回模型（启动时烘焙距离场等需要网格数据的场合）
+    Model& require(int handle)
+    {
+        if (!assets[handle].model)
+            load(handle);
+        touch(handle);
+        return *assets[handle].model;
+    }
+
+    bool isResident(int handle) const
+    {
+        return assets[handle].model != nullptr;
+    }
+
+    // 每帧绘制前调用一次（scene.update()之后）
+    void update(const SceneGraph& scene, const glm::vec3& cameraPos)
+    {
+        frame++;
+
+        std::vector<std::pair<float, int>> wanted;
+        for (size_t i = 0; i < assets.size(); i++)
+        {
+            Asset& a = assets[i];
+            a.distance = glm::length(glm::vec3(scene.world(a.node)[3]) - cameraPos);
+            if (a.model)
+            {
+                if (a.distance > a.loadRadius * unloadFactor && evictable(a))
+                {
+                    evict(static_cast<int>(i));
+                    counters.unloads++;
+                }
+            }
+            else if (a.distance < a.loadRadius)
+            {
+                wanted.push_back(std::make_pair(a.distance, static_cast<int>(i)));
+            }
+        }
+        std::sort(wanted.begin(), wanted.end());
+        int loaded = 0;
+        for (size_t i = 0; i < wanted.size() && loaded < maxLoadsPerFrame; i++)
+        {
+            if (!fits(wanted[i].second))
+                continue;
+            load(wanted[i].second);
+            loaded++;
+        }
+
+        // 纹理流式上传期间尺寸从占位的1x1变为实际大小，重新测量
+        for (int handle : lru)
+        {
+            if (assets[handle].measuring)
+                measure(handle);
+        }
+        enforceBudget();
+    }
+
+    // 录制资源的绘制：驻留时录制模型每个网格的纹理绑定与绘制，否则用包围盒占位；调用前应已录制world对应的model矩阵。
+    // 只读取驻留状态，可在工作线程中与其他录制并行（update()之后、回放之前）；
+    // LRU与命中计数由录制的调用在回放时更新；深度通道的着色器没有normalMatrix，传false时占位盒只设置model
+    void record(CommandList& list, int handle, const glm::mat4& world, bool normalMatrix = true)
+    {
+        const Asset& a = assets[handle];
+        list.call(&AssetResidency::useCommand, AssetUse{this, handle});
+        if (a.model)
+        {
+            for (const Mesh& mesh : a.model->meshes)
+                list.draw(mesh);
+            return;
+        }
+        if (a.boundsMin.x > a.boundsMax.x || !placeholder)
+            return; // 从未加载过，没有包围盒
+        glm::mat4 box = glm::translate(world, (a.boundsMin + a.boundsMax) * 0.5f);
+        box = glm::scale(box, glm::max((a.boundsMax - a.boundsMin) * 0.5f, glm::vec3(1e-4f))); // 扁平模型也要可逆
+        list.setMat4("model", box);
+        if (normalMatrix)
+            list.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(box))));
+        list.draw(*placeholder);
+    }
+
+    // 不经Shader绘制的场合（软件光栅化）：驻留时返回模型并计为命中，否则计为未命中并返回空
+    Model* acquire(int handle)
+    {
+        Asset& a = assets[handle];
+        if (!a.model)
+        {
+            counters.misses++;
+            return nullptr;
+        }
+        counters.hits++;
+        touch(handle);
+        return a.model.get();
+    }
+
+    const ResidencyStats& stats() const
+    {
+        return counters;
+    }
+
+    size_t cpuBytes() const
+    {
+        return cpuUsed;
+    }
+
+    size_t gpuBytes() const
+    {
+        return gpuUsed;
+    }
+
+    size_t residentCount() const
+    {
+        return lru.size();
+    }
+
+private:
+    struct Asset
+    {
+        std::string path;
+        int node = 0;
+        float loadRadius = 0.0f;
+        TextureStreamer* streamer = nullptr;
+        std::unique_ptr<Model> model;
+        std::list<int>::iterator lruPosition;
+        uint64_t lastUsed = 0;
+        uint64_t loadedFrame = 0;
+        float distance = 0.0f;
+        size_t cpuBytes = 0;
+        size_t gpuBytes = 0;
+        size_t lastCpuBytes = 0; // 驱逐前测得的占用，重新加载前用来估计是否放得下
+        size_t lastGpuBytes = 0;
+        bool measuring = false;
+        bool everLoaded = false;
+        glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+        glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+    };
+
+    std::vector<Asset> assets;
+    std::list<int> lru; // 头部为最近使用
+    uint64_t frame = 0;
+    size_t cpuUsed = 0;
+    size_t gpuUsed = 0;
+    ResidencyStats counters;
+    std::unique_ptr<Mesh> placeholder;
+
+    struct AssetUse
+    {
+        AssetResidency* residency;
+        int handle;
+    };
+
+    static void useCommand(const AssetUse& args)
+    {
+        AssetResidency& r = *args.residency;
+        if (r.assets[args.handle].model)
+        {
+            r.counters.hits++;
+            r.touch(args.handle);
+        }
+        else
+        {
+            r.counters.misses++;
+        }
+    }
+
+    void touch(int handle)
+    {
+        Asset& a = assets[handle];
+        a.lastUsed = frame;
+        lru.splice(lru.begin(), lru, a.lruPosition);
+    }
+
+    void load(int handle)
+    {
+        Asset& a = assets[handle];
+        a.model.reset(new Model(a.path, false, a.streamer));
+        counters.loads++;
+        if (a.everLoaded)
+            counters.reloads++;
+        a.everLoaded = true;
+        counters.importMs += a.model->importStats.milliseconds;
+        counters.importPeakBytes = std::max(counters.importPeakBytes, a.model->importStats.peakBytes);
+        a.lastUsed = frame;
+        a.loadedFrame = frame; // 刚加载的资源本帧不参与驱逐
+        lru.push_front(handle);
+        a.lruPosition = lru.begin();
+
+        for (const Mesh& mesh : a.model->meshes)
+        {
+            for (const Vertex& v : mesh.vertices)
+            {
+                a.boundsMin = glm::min(a.boundsMin, v.Position);
+                a.boundsMax = glm::max(a.boundsMax, v.Position);
+            }
+        }
+        measure(handle);
+    }
+
+    void measure(int handle)
+    {
+        Asset& a = assets[handle];
+        cpuUsed -= a.cpuBytes;
+        gpuUsed -= a.gpuBytes;
+
+        a.measuring = false;
+        for (const Texture& t : a.model->textures_loaded)
+        {
+            if (a.streamer != nullptr && (t.material >= 0 ? a.streamer->isStreamingMaterial(t.material)
+                                                          : a.streamer->isStreaming(t.id)))
+                a.measuring = true;
+        }
+
+        MemoryUsage usage = memstats::owner(a.path);
+        a.cpuBytes = usage.bytes(MemoryDomain::CPU);
+        a.gpuBytes = usage.bytes(MemoryDomain::GPU);
+        cpuUsed += a.cpuBytes;
+        gpuUsed += a.gpuBytes;
+    }
+
+    void evict(int handle)
+    {
+        Asset& a = assets[handle];
+        a.model->release();
+        a.model.reset();
+        lru.erase(a.lruPosition);
+        cpuUsed -= a.cpuBytes;
+        gpuUsed -= a.gpuBytes;
+        a.lastCpuBytes = a.cpuBytes;
+        a.lastGpuBytes = a.gpuBytes;
+        a.cpuBytes = a.gpuBytes = 0;
+        a.measuring = false;
+        // 占位立方体需要GL，在驱逐时（GL线程）创建，录制时只读取
+        if (!placeholder)
+            createPlaceholder();
+    }
+
+    // 本帧刚加载或纹理仍在上传的资源占用还没测准，不驱逐
+    bool evictable(const Asset& a) const
+    {
+        return a.loadedFrame != frame && !a.measuring;
+    }
+
+    // 驱逐顺序：最久未绘制的在前，同一帧绘制过的按距离由远到近
+    bool evictsBefore(int x, int y) const
+    {
+        const Asset& a = assets[x];
+        const Asset& b = assets[y];
+        if (a.lastUsed != b.lastUsed)
+            return a.lastUsed < b.lastUsed;
+        return a.distance > b.distance;
+    }
+
+    // 从未加载过的资源占用未知，总是尝试；否则驱逐所有比它更远的可驱逐资源后要放得下
+    bool fits(int handle) const
+    {
+        const Asset& a = assets[handle];
+        if (!a.everLoaded)
+            return true;
+        size_t cpu = cpuUsed, gpu = gpuUsed;
+        for (int other : lru)
+        {
+            const Asset& b = assets[other];
+            if (evictable(b) && b.distance > a.distance)
+            {
+                cpu -= b.cpuBytes;
+                gpu -= b.gpuBytes;
+            }
+        }
+        return cpu + a.lastCpuBytes <= cpuBudget && gpu + a.lastGpuBytes <= gpuBudget;
+    }
+
+    void enforceBudget()
+    {
+        if (cpuUsed <= cpuBudget && gpuUsed <= gpuBudget)
+            return;
+        std::vector<int> candidates;
+        for (int handle : lru)
+        {
+            if (evictable(assets[handle]))
+                candidates.push_back(handle);
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](int x, int y) { return evictsBefore(x, y); });
+        for (size_t i = 0; i < candidates.size() && (cpuUsed > cpuBudget || gpuUsed > gpuBudget); i++)
+        {
+            evict(candidates[i]);
+            counters.evictions++;
+        }
+    }
+
+    // 单位立方体（[-1, 1]^3），配1x1灰色纹理，所有被驱逐的资源共用
+    void createPlaceholder()
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        const glm::vec3 normals[6] = {
+            glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+            glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+        };
+        for (const glm::vec3& n : normals)
+        {
+            glm::vec3 u = glm::abs(n.y) > 0.5f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+            glm::vec3 v = glm::cross(n, u);
+            unsigned int base = static_cast<unsigned int>(vertices.size());
+            for (int k = 0; k < 4; k++)
+            {
+                float su = (k == 1 || k == 2) ? 1.0f : -1.0f, sv = k >= 2 ? 1.0f : -1.0f;
+                Vertex vertex = {};
+                vertex.Position = n + u * su + v * sv;
+                vertex.Normal = n;
+                vertex.TexCoords = glm::vec2(su, sv) * 0.5f + 0.5f;
+                vertex.Tangent = u;
+                vertex.Bitangent = v;
+                vertices.push_back(vertex);
+            }
+            const unsigned int quad[6] = {0, 1, 2, 0, 2, 3};
+            for (unsigned int q : quad)
+                indices.push_back(base + q);
+        }
+
+        memstats::OwnerScope owner("placeholder");
+        Texture grey;
+        glGenTextures(1, &grey.id);
+        unsigned char pixel[4] = {128, 128, 128, 255};
+        glBindTexture(GL_TEXTURE_2D, grey.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        memstats::trackTexture(grey.id, MemoryCategory::Texture, 4);
+        grey.type = "texture_diffuse";
+        placeholder.reset(new Mesh(std::move(vertices), std::move(indices), std::vector<Texture>{grey}));
+    }
+};
+
+#endif
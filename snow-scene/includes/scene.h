@@ -0,0 +1,225 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "workerpool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// 场景节点层级
+// 节点变换按分量连续存放（位置、旋转、缩放、局部矩阵、世界矩阵、法线矩阵各一个数组），节点用下标引用。
+// 父节点必须先于子节点添加，因此按下标顺序遍历一遍即可把脏标记传播到所有后代。
+// setter只在数值真正改变时标脏；update()只重算脏节点的局部矩阵与世界矩阵，静止的物体每帧零开销。
+// 脏节点数超过parallelThreshold时按层级分批，同一层的节点互不依赖，由多个线程并行计算；
+// 工作线程在第一次并行更新时创建并一直保留，节点少的场景不创建线程。
+class SceneGraph
+{
+public:
+    static constexpr int NO_PARENT = -1;
+
+    size_t parallelThreshold = 2048; // 脏节点数达到该值才启用多线程
+
+    SceneGraph(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : threadCount(threadCount)
+    {
+    }
+
+    // 局部变换 = 平移 * 缩放 * 旋转（欧拉角，度，依次绕X、Y、Z轴），与原先逐物体拼接矩阵的顺序一致
+    int add(int parent = NO_PARENT, const glm::vec3& position = glm::vec3(0.0f),
+            const glm::vec3& rotation = glm::vec3(0.0f), const glm::vec3& scale = glm::vec3(1.0f))
+    {
+        int node = static_cast<int>(parents.size());
+        parents.push_back(parent);
+        depths.push_back(parent == NO_PARENT ? 0 : depths[parent] + 1);
+        positions.push_back(position);
+        rotations.push_back(rotation);
+        scales.push_back(scale);
+        locals.push_back(glm::mat4(1.0f));
+        worlds.push_back(glm::mat4(1.0f));
+        normals.push_back(glm::mat3(1.0f));
+        flags.push_back(LOCAL_DIRTY);
+        return node;
+    }
+
+    size_t size() const
+    {
+        return parents.size();
+    }
+
+    int parent(int node) const
+    {
+        return parents[node];
+    }
+
+    const glm::vec3& position(int node) const
+    {
+        return positions[node];
+    }
+
+    const glm::vec3& rotation(int node) const
+    {
+        return rotations[node];
+    }
+
+    const glm::vec3& scale(int node) const
+    {
+        return scales[node];
+    }
+
+    void setPosition(int node, const glm::vec3& value)
+    {
+        if (positions[node] != value)
+        {
+            positions[node] = value;
+            flags[node] |= LOCAL_DIRTY;
+        }
+    }
+
+    void setRotation(int node, const glm::vec3& value)
+    {
+        if (rotations[node] != value)
+        {
+            rotations[node] = value;
+            flags[node] |= LOCAL_DIRTY;
+        }
+    }
+
+    void setScale(int node, const glm::vec3& value)
+    {
+        if (scales[node] != value)
+        {
+            scales[node] = value;
+            flags[node] |= LOCAL_DIRTY;
+        }
+    }
+
+    // update()之后有效
+    const glm::mat4& world(int node) const
+    {
+        return worlds[node];
+    }
+
+    // 世界矩阵左上3x3的逆转置，供法线变换
+    const glm::mat3& normalMatrix(int node) const
+    {
+        return normals[node];
+    }
+
+    // 上一次update()重算的节点数
+    size_t updatedLastFrame() const
+    {
+        return dirty.size();
+    }
+
+    void update()
+    {
+        // 按下标顺序传播：父节点总在子节点之前，一遍即可覆盖整棵子树
+        dirty.clear();
+        int maxDepth = 0;
+        for (size_t i = 0; i < parents.size(); i++)
+        {
+            int p = parents[i];
+            if (p != NO_PARENT && (flags[p] & WORLD_DIRTY))
+                flags[i] |= WORLD_DIRTY;
+            if (flags[i] & LOCAL_DIRTY)
+                flags[i] |= WORLD_DIRTY;
+            if (flags[i] & WORLD_DIRTY)
+            {
+                dirty.push_back(static_cast<int>(i));
+                maxDepth = std::max(maxDepth, depths[i]);
+            }
+        }
+        if (dirty.empty())
+            return;
+
+        if (dirty.size() < parallelThreshold || threadCount <= 1)
+        {
+            for (int node : dirty)
+                recompute(node);
+        }
+        else
+        {
+            // 同一层的节点只依赖上一层的结果；稳定排序保持层内的下标顺序，访问更连续
+            std::stable_sort(dirty.begin(), dirty.end(), [this](int a, int b) { return depths[a] < depths[b]; });
+            size_t begin = 0;
+            for (int depth = 0; depth <= maxDepth; depth++)
+            {
+                size_t end = begin;
+                while (end < dirty.size() && depths[dirty[end]] == depth)
+                    end++;
+                recomputeRange(begin, end);
+                begin = end;
+            }
+        }
+
+        for (int node : dirty)
+            flags[node] = 0;
+    }
+
+private:
+    enum : uint8_t
+    {
+        LOCAL_DIRTY = 1, // 自身的位置/旋转/缩放改变
+        WORLD_DIRTY = 2  // 自身或某个祖先改变
+    };
+
+    unsigned int threadCount;
+    std::unique_ptr<WorkerPool> workers;
+    std::vector<int> parents;
+    std::vector<int> depths;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat3> normals;
+    std::vector<uint8_t> flags;
+    std::vector<int> dirty; // 本次更新的节点，update()之间复用
+
+    void recompute(int node)
+    {
+        if (flags[node] & LOCAL_DIRTY)
+        {
+            glm::mat4 local = glm::translate(glm::mat4(1.0f), positions[node]);
+            local = glm::scale(local, scales[node]);
+            local = glm::rotate(local, glm::radians(rotations[node].x), glm::vec3(1.0f, 0.0f, 0.0f));
+            local = glm::rotate(local, glm::radians(rotations[node].y), glm::vec3(0.0f, 1.0f, 0.0f));
+            local = glm::rotate(local, glm::radians(rotations[node].z), glm::vec3(0.0f, 0.0f, 1.0f));
+            locals[node] = local;
+        }
+        int p = parents[node];
+        worlds[node] = p == NO_PARENT ? locals[node] : worlds[p] * locals[node];
+        normals[node] = glm::transpose(glm::inverse(glm::mat3(worlds[node])));
+    }
+
+    // 并行重算dirty[begin, end)，这些节点深度相同
+    void recomputeRange(size_t begin, size_t end)
+    {
+        size_t count = end - begin;
+        size_t ranges = std::min<size_t>(threadCount, (count + 255) / 256); // 每个线程至少分到256个节点
+        if (ranges <= 1)
+        {
+            for (size_t i = begin; i < end; i++)
+                recompute(dirty[i]);
+            return;
+        }
+
+        if (!workers)
+            workers.reset(new WorkerPool(threadCount));
+        size_t chunk = (count + ranges - 1) / ranges;
+        workers->parallelFor(ranges, [this, begin, end, chunk](size_t w)
+        {
+            size_t first = begin + w * chunk, last = std::min(end, first + chunk);
+            for (size_t i = first; i < last; i++)
+                recompute(dirty[i]);
+        });
+    }
+};
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef SDF_H
+#define SDF_H
+
+#include <glm/glm.hpp>
+
+#include "model.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 静态场景的稀疏有符号距离场
+// 场景按体素划分，每8x8x8个体素组成一个块；只有表面附近（窄带内）的块才分配存储，其余块视为远离表面。
+// 从Mesh数据烘焙一次并缓存到磁盘，之后每次查询是常数时间的三线性插值，与三角形数量无关。
+class SceneSDF
+{
+public:
+    static constexpr int BRICK_SIZE = 8;
+    static constexpr int BRICK_VOXELS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+    float voxelSize;
+    float bandWidth; // 窄带宽度（世界单位），窄带外的距离记为bandWidth
+
+    SceneSDF(float voxelSize = 0.05f, int bandVoxels = 3)
+        : voxelSize(voxelSize),
+          bandWidth(voxelSize * bandVoxels)
+    {
+    }
+
+    // 收集模型在世界空间中的三角形
+    void addModel(const Model& model, const glm::mat4& transform)
+    {
+        for (const Mesh& mesh : model.meshes)
+        {
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    glm::vec4 p = transform * glm::vec4(mesh.vertices[mesh.indices[i + k]].Position, 1.0f);
+                    triangles.push_back(glm::vec3(p));
+                }
+            }
+        }
+    }
+
+    // 缓存与当前三角形数据匹配时直接加载，否则烘焙并写入缓存
+    void loadOrBuild(const std::string& cachePath)
+    {
+        uint64_t key = hashInput();
+        if (load(cachePath, key))
+        {
+            std::cout << "SDF: loaded " << brickCount() << " bricks from " << cachePath << std::endl;
+        }
+        else
+        {
+            build();
+            save(cachePath, key);
+            std::cout << "SDF: baked " << brickCount() << " bricks from " << triangles.size() / 3
+                << " triangles" << std::endl;
+        }
+        triangles.clear();
+        triangles.shrink_to_fit();
+    }
+
+    size_t brickCount() const
+    {
+        return bricks.size() / BRICK_VOXELS;
+    }
+
+    // 三线性插值的有符号距离，窄带与场景范围之外返回bandWidth
+    float distance(const glm::vec3& p) const
+    {
+        glm::vec3 g = (p - origin) / voxelSize;
+        if (g.x < 0.0f || g.y < 0.0f || g.z < 0.0f ||
+            g.x >= dims.x - 1 || g.y >= dims.y - 1 || g.z >= dims.z - 1)
+            return bandWidth;
+
+        int x = static_cast<int>(g.x), y = static_cast<int>(g.y), z = static_cast<int>(g.z);
+        float fx = g.x - x, fy = g.y - y, fz = g.z - z;
+        float c000 = voxel(x, y, z), c100 = voxel(x + 1, y, z);
+        float c010 = voxel(x, y + 1, z), c110 = voxel(x + 1, y + 1, z);
+        float c001 = voxel(x, y, z + 1), c101 = voxel(x + 1, y, z + 1);
+        float c011 = voxel(x, y + 1, z + 1), c111 = voxel(x + 1, y + 1, z + 1);
+        float c00 = c000 + (c100 - c000) * fx, c10 = c010 + (c110 - c010) * fx;
+        float c01 = c001 + (c101 - c001) * fx, c11 = c011 + (c111 - c011) * fx;
+        float c0 = c00 + (c10 - c00) * fy, c1 = c01 + (c11 - c01) * fy;
+        return c0 + (c1 - c0) * fz;
+    }
+
+    // 距离场梯度（中心差分），指向距离增大的方向，即表面法线
+    glm::vec3 gradient(const glm::vec3& p) const
+    {
+        float h = voxelSize;
+        glm::vec3 g(distance(p + glm::vec3(h, 0.0f, 0.0f)) - distance(p - glm::vec3(h, 0.0f, 0.0f)),
+                    distance(p + glm::vec3(0.0f, h, 0.0f)) - distance(p - glm::vec3(0.0f, h, 0.0f)),
+                    distance(p + glm::vec3(0.0f, 0.0f, h)) - distance(p - glm::vec3(0.0f, 0.0f, h)));
+        float len = glm::length(g);
+        return len > 1e-6f ? g / len : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+private:
+    static constexpr uint32_t CACHE_MAGIC = 0x46445353; // "SSDF"
+    static constexpr uint32_t CACHE_VERSION = 1;
+
+    std::vector<glm::vec3> triangles; // 烘焙输入，每3个点一个三角形
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::ivec3 dims = glm::ivec3(0); // 体素数
+    glm::ivec3 brickDims = glm::ivec3(0);
+    std::vector<int32_t> brickIndex; // -1 表示该块不在窄带内
+    std::vector<float> bricks;
+
+    float voxel(int x, int y, int z) const
+    {
+        int b = brickIndex[((z / BRICK_SIZE) * brickDims.y + y / BRICK_SIZE) * brickDims.x + x / BRICK_SIZE];
+        if (b < 0)
+            return bandWidth;
+        int local = ((z % BRICK_SIZE) * BRICK_SIZE + y % BRICK_SIZE) * BRICK_SIZE + x % BRICK_SIZE;
+        return bricks[static_cast<size_t>(b) * BRICK_VOXELS + local];
+    }
+
+    uint64_t hashInput() const
+    {
+        // FNV-1a，覆盖三角形坐标与烘焙参数
+        uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+        mix(triangles.data(), triangles.size() * sizeof(glm::vec3));
+        mix(&voxelSize, sizeof(voxelSize));
+        mix(&bandWidth, sizeof(bandWidth));
+        return hash;
+    }
+
+    static glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b,
+                                            const glm::vec3& c)
+    {
+        glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return a;
+        glm::vec3 bp = p - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return b;
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+        glm::vec3 cp = p - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return c;
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        float denom = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    void build()
+    {
+        if (triangles.empty())
+        {
+            dims = brickDims = glm::ivec3(0);
+            return;
+        }
+
+        glm::vec3 lo = triangles[0], hi = triangles[0];
+        for (const glm::vec3& p : triangles)
+        {
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        origin = lo - glm::vec3(bandWidth + voxelSize);
+        glm::vec3 size = hi - lo + glm::vec3(2.0f * (bandWidth + voxelSize));
+        brickDims = glm::ivec3(glm::ceil(size / (voxelSize * BRICK_SIZE)));
+        dims = brickDims * BRICK_SIZE;
+        brickIndex.assign(static_cast<size_t>(brickDims.x) * brickDims.y * brickDims.z, -1);
+
+        // 第一步：把三角形（按窄带扩展后的包围盒）分配到它覆盖的块
+        std::vector<std::vector<uint32_t>> binned(brickIndex.size());
+        float brickWorld = voxelSize * BRICK_SIZE;
+        for (uint32_t t = 0; t < triangles.size() / 3; t++)
+        {
+            const glm::vec3& a = triangles[t * 3];
+            const glm::vec3& b = triangles[t * 3 + 1];
+            const glm::vec3& c = triangles[t * 3 + 2];
+            glm::vec3 tlo = glm::min(glm::min(a, b), c) - glm::vec3(bandWidth) - origin;
+            glm::vec3 thi = glm::max(glm::max(a, b), c) + glm::vec3(bandWidth) - origin;
+            glm::ivec3 b0 = glm::max(glm::ivec3(glm::floor(tlo / brickWorld)), glm::ivec3(0));
+            glm::ivec3 b1 = glm::min(glm::ivec3(glm::floor(thi / brickWorld)), brickDims - glm::ivec3(1));
+            for (int z = b0.z; z <= b1.z; z++)
+                for (int y = b0.y; y <= b1.y; y++)
+                    for (int x = b0.x; x <= b1.x; x++)
+                        binned[(static_cast<size_t>(z) * brickDims.y + y) * brickDims.x + x].push_back(t);
+        }
+
+        std::vector<size_t> active;
+        for (size_t i = 0; i < binned.size(); i++)
+        {
+            if (!binned[i].empty())
+            {
+                brickIndex[i] = static_cast<int32_t>(active.size());
+                active.push_back(i);
+            }
+        }
+        bricks.assign(active.size() * BRICK_VOXELS, bandWidth);
+
+        // 第二步：各块互不重叠，按块并行计算每个体素到所分配三角形的最近有符号距离
+        std::atomic<size_t> next{0};
+        auto worker = [&]()
+        {
+            for (size_t n = next++; n < active.size(); n = next++)
+            {
+                size_t cell = active[n];
+                glm::ivec3 brick(static_cast<int>(cell % brickDims.x),
+                                 static_cast<int>((cell / brickDims.x) % brickDims.y),
+                                 static_cast<int>(cell / (static_cast<size_t>(brickDims.x) * brickDims.y)));
+                float* out = &bricks[n * BRICK_VOXELS];
+                for (int i = 0; i < BRICK_VOXELS; i++)
+                {
+                    glm::ivec3 v = brick * BRICK_SIZE +
+                        glm::ivec3(i % BRICK_SIZE, (i / BRICK_SIZE) % BRICK_SIZE, i / (BRICK_SIZE * BRICK_SIZE));
+                    glm::vec3 p = origin + glm::vec3(v) * voxelSize;
+                    float best = bandWidth;
+                    float bestSigned = bandWidth;
+                    for (uint32_t t : binned[cell])
+                    {
+                        const glm::vec3& a = triangles[t * 3];
+                        const glm::vec3& b = triangles[t * 3 + 1];
+                        const glm::vec3& c = triangles[t * 3 + 2];
+                        glm::vec3 q = closestPointOnTriangle(p, a, b, c);
+                        float d = glm::length(p - q);
+                        if (d < best)
+                        {
+                            // 符号取自三角形朝向：位于背面一侧视为在物体内部
+                            glm::vec3 n = glm::cross(b - a, c - a);
+                            best = d;
+                            bestSigned = glm::dot(p - q, n) < 0.0f ? -d : d;
+                        }
+                    }
+                    out[i] = bestSigned;
+                }
+            }
+        };
+        unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < threadCount; i++)
+            threads.emplace_back(worker);
+        worker();
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    bool load(const std::string& path, uint64_t key)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        uint32_t magic = 0, version = 0;
+        uint64_t storedKey = 0;
+        uint64_t indexCount = 0, brickFloats = 0;
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+        if (!in || magic != CACHE_MAGIC || version != CACHE_VERSION || storedKey != key)
+            return false;
+        in.read(reinterpret_cast<char*>(&origin), sizeof(origin));
+        in.read(reinterpret_cast<char*>(&brickDims), sizeof(brickDims));
+        in.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
+        in.read(reinterpret_cast<char*>(&brickFloats), sizeof(brickFloats));
+        if (!in || brickDims.x <= 0 || brickDims.y <= 0 || brickDims.z <= 0 ||
+            indexCount != static_cast<uint64_t>(brickDims.x) * brickDims.y * brickDims.z ||
+            brickFloats % BRICK_VOXELS != 0)
+            return false;
+        brickIndex.resize(indexCount);
+        bricks.resize(brickFloats);
+        in.read(reinterpret_cast<char*>(brickIndex.data()), indexCount * sizeof(int32_t));
+        in.read(reinterpret_cast<char*>(bricks.data()), brickFloats * sizeof(float));
+        if (!in)
+            return false;
+        // 键相同但内容截断或损坏时，越界的块号会让distance()（经voxel()查块）读到bricks之外
+        const int64_t count = static_cast<int64_t>(brickFloats / BRICK_VOXELS);
+        for (int32_t b : brickIndex)
+        {
+            if (b < -1 || b >= count)
+                return false;
+        }
+        dims = brickDims * BRICK_SIZE;
+        return true;
+    }
+
+    void save(const std::string& path, uint64_t key) const
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+        {
+            std::cout << "SDF: failed to write cache " << path << std::endl;
+            return;
+        }
+        uint32_t magic = CACHE_MAGIC, version = CACHE_VERSION;
+        uint64_t indexCount = brickIndex.size(), brickFloats = bricks.size();
+        out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        out.write(reinterpret_cast<const char*>(&origin), sizeof(origin));
+        out.write(reinterpret_cast<const char*>(&brickDims), sizeof(brickDims));
+        out.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+        out.write(reinterpret_cast<const char*>(&brickFloats), sizeof(brickFloats));
+        out.write(reinterpret_cast<const char*>(brickIndex.data()), indexCount * sizeof(int32_t));
+        out.write(reinterpret_cast<const char*>(bricks.data()), brickFloats * sizeof(float));
+    }
+};
+
+#endif
@@ -4,17 +4,58 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "glstats.h"
+#include "shadercache.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <memory>
+
+// 着色器特性位：构建排列时转换为#define，着色器中用#ifdef选择代码路径
+enum ShaderFeature : unsigned int
+{
+    SHADER_UNLIT_COLOR = 1 << 0, // 直接输出uniform color，不做光照
+    SHADER_SHADOWED = 1 << 1, // 采样级联阴影
+    SHADER_INSTANCED = 1 << 2, // 每实例平移（location 7）+ 统一缩放，代替model矩阵
+    SHADER_NORMAL_MATRIX = 1 << 3, // 使用CPU计算的normalMatrix，不在顶点着色器中求逆
+    SHADER_CLUSTERED_LIGHTS = 1 << 4, // 叠加分簇点光源
+    SHADER_MATERIAL_ARRAY = 1 << 5 // 漫反射纹理取自纹理数组（TextureArrayPool）
+};
+
+inline std::string shaderDefines(unsigned int features)
+{
+    std::string defines;
+    if (features & SHADER_UNLIT_COLOR)
+        defines += "#define UNLIT_COLOR\n";
+    if (features & SHADER_SHADOWED)
+        defines += "#define SHADOWED\n";
+    if (features & SHADER_INSTANCED)
+        defines += "#define INSTANCED\n";
+    if (features & SHADER_NORMAL_MATRIX)
+        defines += "#define NORMAL_MATRIX\n";
+    if (features & SHADER_CLUSTERED_LIGHTS)
+        defines += "#define CLUSTERED_LIGHTS\n";
+    if (features & SHADER_MATERIAL_ARRAY)
+        defines += "#define MATERIAL_ARRAY\n";
+    return defines;
+}
 
 class Shader
 {
 public:
     unsigned int ID;
+    unsigned int generation = 0; // ID每次被热重载替换时加一，缓存uniform位置的地方据此失效
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string defines; // 插入到#version之后的预处理定义
 
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "")
+        : vertexPath(vertexPath),
+          fragmentPath(fragmentPath),
+          defines(defines)
     {
         std::string vertexCode;
         std::string fragmentCode;
@@ -31,13 +72,42 @@ public:
             fShaderStream << fShaderFile.rdbuf();
             vShaderFile.close();
             fShaderFile.close();
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            vertexCode = injectDefines(vShaderStream.str(), defines);
+            fragmentCode = injectDefines(fShaderStream.str(), defines);
         }
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+
+        // 优先从程序二进制缓存加载
+        ShaderCache& cache = ShaderCache::instance();
+        uint64_t key = cache.key(vertexCode, fragmentCode);
+        ID = glCreateProgram();
+        if (cache.load(ID, key))
+            return;
+        glDeleteProgram(ID); // 加载失败的程序对象状态不确定，换一个新的
+        ID = glCreateProgram();
+        cache.prepare(ID);
+        if (buildProgram(ID, vertexCode, fragmentCode))
+            cache.store(ID, key);
+    }
+
+    // #version必须是第一条语句，定义插在它的下一行
+    static std::string injectDefines(const std::string& code, const std::string& defines)
+    {
+        if (defines.empty())
+            return code;
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return defines + code;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
+
+    // 编译并链接到program，返回是否链接成功；热重载线程也用它在共享上下文中构建程序
+    static bool buildProgram(GLuint program, const std::string& vertexCode, const std::string& fragmentCode)
+    {
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
 
@@ -52,14 +122,16 @@ public:
         glCompileShader(fragment);
         checkCompileErrors(fragment, "FRAGMENT");
 
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        bool linked = checkCompileErrors(program, "PROGRAM");
 
+        glDetachShader(program, vertex);
+        glDetachShader(program, fragment);
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        return linked;
     }
 
     void use() const
@@ -128,7 +200,7 @@ public:
     }
 
 private:
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -152,6 +224,36 @@ private:
                     "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success == GL_TRUE;
+    }
+};
+
+// 同一对着色器文件按特性位构建的程序集合，首次请求某个组合时编译
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath)
+        : vertexPath(vertexPath),
+          fragmentPath(fragmentPath)
+    {
+    }
+
+    // 返回的引用在本对象销毁前一直有效
+    Shader& get(unsigned int features)
+    {
+        auto it = permutations.find(features);
+        if (it == permutations.end())
+        {
+            std::unique_ptr<Shader> shader(new Shader(vertexPath.c_str(), fragmentPath.c_str(),
+                                                      shaderDefines(features)));
+            it = permutations.emplace(features, std::move(shader)).first;
+        }
+        return *it->second;
     }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::map<unsigned int, std::unique_ptr<Shader>> permutations;
 };
 #endif
@@ -0,0 +1,178 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// GL 4.1 / ARB_get_program_binary，GL 3.3的glad不包含这些入口，运行时查询
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// 着色器程序二进制缓存
+// 链接成功的程序通过glGetProgramBinary写入磁盘，键为 GLSL源码 + 驱动厂商/渲染器/版本 的哈希；
+// 下次启动时直接glProgramBinary加载，跳过编译与链接。驱动更新或源码改动都会得到新的键，
+// 驱动拒绝旧二进制时（链接状态为假）回退到从源码编译。
+class ShaderCache
+{
+public:
+    std::string directory = "shader-cache";
+
+    static ShaderCache& instance()
+    {
+        static ShaderCache cache;
+        return cache;
+    }
+
+    // gladLoadGLLoader之后调用一次；驱动不支持程序二进制时缓存保持关闭
+    void initialize(GLADloadproc loader)
+    {
+        getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(loader("glGetProgramBinary"));
+        programBinary = reinterpret_cast<ProgramBinaryProc>(loader("glProgramBinary"));
+        programParameteri = reinterpret_cast<ProgramParameteriProc>(loader("glProgramParameteri"));
+        GLint formats = 0;
+        if (getProgramBinary != nullptr && programBinary != nullptr && programParameteri != nullptr)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        enabled = formats > 0;
+
+        const char* vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+        driver = std::string(vendor ? vendor : "") + '\n' + (renderer ? renderer : "") + '\n' + (version ? version : "");
+
+        if (enabled)
+        {
+#ifdef _WIN32
+            _mkdir(directory.c_str());
+#else
+            mkdir(directory.c_str(), 0755);
+#endif
+        }
+        else
+        {
+            std::cout << "shader cache: program binaries not supported, compiling from source" << std::endl;
+        }
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    uint64_t key(const std::string& vertexCode, const std::string& fragmentCode) const
+    {
+        uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](const std::string& text)
+        {
+            for (unsigned char c : text)
+            {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            hash ^= 0xFF; // 分隔符，避免不同切分得到相同哈希
+            hash *= 1099511628211ull;
+        };
+        mix(vertexCode);
+        mix(fragmentCode);
+        mix(driver);
+        return hash;
+    }
+
+    // 链接前调用，要求驱动保留可取回的二进制
+    void prepare(GLuint program) const
+    {
+        if (enabled)
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // 把缓存的二进制加载到program，成功返回true
+    bool load(GLuint program, uint64_t key) const
+    {
+        if (!enabled)
+            return false;
+        std::ifstream in(path(key), std::ios::binary);
+        if (!in)
+            return false;
+        uint32_t magic = 0;
+        GLenum format = 0;
+        int32_t length = 0;
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        in.read(reinterpret_cast<char*>(&format), sizeof(format));
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!in || magic != CACHE_MAGIC || length <= 0)
+            return false;
+        std::vector<char> binary(length);
+        in.read(binary.data(), length);
+        if (!in)
+            return false;
+
+        programBinary(program, format, binary.data(), length);
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success == GL_TRUE;
+    }
+
+    void store(GLuint program, uint64_t key) const
+    {
+        if (!enabled)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::ofstream out(path(key), std::ios::binary);
+        if (!out)
+            return;
+        uint32_t magic = CACHE_MAGIC;
+        int32_t size = length;
+        out.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(binary.data(), length);
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void*, GLsizei);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+
+    static constexpr uint32_t CACHE_MAGIC = 0x42505353; // "SSPB"
+
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+    bool enabled = false;
+    std::string driver;
+
+    ShaderCache() = default;
+
+    std::string path(uint64_t key) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return directory + '/' + name;
+    }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef SHADERRELOAD_H
+#define SHADERRELOAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "shader.h"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+// 开发模式下的着色器热重载
+// 后台线程轮询被监视着色器的.glsl修改时间；文件变化后在与主窗口共享的隐藏上下文中重新编译链接，
+// 渲染线程不会因编译而卡顿。只有链接成功的新程序才会在apply()中替换Shader::ID，失败时保留旧程序并打印日志。
+// 必须在主线程创建与stop()（GLFW窗口操作的要求），且stop()要在glfwTerminate之前调用。
+class ShaderHotReload
+{
+public:
+    ShaderHotReload(GLFWwindow* mainWindow, int pollIntervalMs = 500)
+        : pollInterval(pollIntervalMs)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        context = glfwCreateWindow(1, 1, "shader-reload", nullptr, mainWindow);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (context == nullptr)
+            std::cout << "shader reload: failed to create shared context" << std::endl;
+    }
+
+    ~ShaderHotReload()
+    {
+        stop();
+    }
+
+    ShaderHotReload(const ShaderHotReload&) = delete;
+    ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+    // shader的生命周期必须覆盖监视期间
+    void watch(Shader& shader)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(Entry{&shader, shader.vertexPath, shader.fragmentPath, shader.defines,
+                                modifiedTime(shader.vertexPath), modifiedTime(shader.fragmentPath)});
+    }
+
+    void start()
+    {
+        if (context == nullptr || running.exchange(true))
+            return;
+        worker = std::thread(&ShaderHotReload::run, this);
+    }
+
+    void stop()
+    {
+        if (running.exchange(false) && worker.joinable())
+            worker.join();
+        if (context != nullptr)
+        {
+            glfwDestroyWindow(context);
+            context = nullptr;
+        }
+    }
+
+    // 渲染线程每帧调用，替换已经重新链接成功的程序
+    void apply()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Reloaded& r : reloaded)
+        {
+            glDeleteProgram(r.shader->ID);
+            r.shader->ID = r.program;
+            r.shader->generation++;
+            std::cout << "shader reload: " << r.shader->vertexPath << " + " << r.shader->fragmentPath << std::endl;
+        }
+        reloaded.clear();
+    }
+
+private:
+    struct Entry
+    {
+        Shader* shader;
+        std::string vertexPath;
+        std::string fragmentPath;
+        std::string defines;
+        std::time_t vertexTime;
+        std::time_t fragmentTime;
+    };
+
+    struct Reloaded
+    {
+        Shader* shader;
+        GLuint program;
+    };
+
+    GLFWwindow* context = nullptr;
+    std::chrono::milliseconds pollInterval;
+    std::atomic<bool> running{false};
+    std::thread worker;
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    std::vector<Reloaded> reloaded;
+
+    static std::time_t modifiedTime(const std::string& path)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return 0;
+        return info.st_mtime;
+    }
+
+    static bool readFile(const std::string& path, std::string& text)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    void run()
+    {
+        glfwMakeContextCurrent(context);
+        while (running.load())
+        {
+            std::this_thread::sleep_for(pollInterval);
+
+            std::vector<Entry> changed;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (Entry& e : entries)
+                {
+                    std::time_t v = modifiedTime(e.vertexPath), f = modifiedTime(e.fragmentPath);
+                    if (v != e.vertexTime || f != e.fragmentTime)
+                    {
+                        e.vertexTime = v;
+                        e.fragmentTime = f;
+                        changed.push_back(e);
+                    }
+                }
+            }
+
+            for (const Entry& e : changed)
+            {
+                std::string vertexCode, fragmentCode;
+                if (!readFile(e.vertexPath, vertexCode) || !readFile(e.fragmentPath, fragmentCode))
+                    continue; // 编辑器保存过程中文件可能暂时不可读，下次修改时再试
+                vertexCode = Shader::injectDefines(vertexCode, e.defines);
+                fragmentCode = Shader::injectDefines(fragmentCode, e.defines);
+                GLuint program = glCreateProgram();
+                if (!Shader::buildProgram(program, vertexCode, fragmentCode))
+                {
+                    glDeleteProgram(program);
+                    continue;
+                }
+                // 确保链接在共享上下文中完成后再交给渲染线程
+                glFinish();
+                std::lock_guard<std::mutex> lock(mutex);
+                reloaded.push_back(Reloaded{e.shader, program});
+            }
+        }
+        glfwMakeContextCurrent(nullptr);
+    }
+};
+
+#endif
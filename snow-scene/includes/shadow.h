@@ -0,0 +1,210 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "shader.h"
+
+#include <string>
+#include <cmath>
+#include <iostream>
+
+// 阴影贴图使用的纹理单元，避开Mesh::Draw占用的0..N号单元
+const int SHADOW_TEXTURE_UNIT = 8;
+
+// 级联阴影贴图
+// 把摄像机视锥按距离切成若干段，每段拟合一个正交光源视锥，深度存放在二维纹理数组的不同层中。
+// 第0级联每帧更新，远处的级联按轮询方式每N帧更新一次，保证每帧的阴影开销有上限。
+class CascadedShadowMap
+{
+public:
+    static constexpr int MAX_CASCADES = 4;
+
+    int cascadeCount;
+    int resolution;
+    int farUpdateInterval; // 远级联的刷新间隔（帧）
+    float splitLambda = 0.75f; // 对数划分与均匀划分的混合系数
+    float shadowDistance = 60.0f; // 超过该距离不再计算阴影
+    float casterMargin = 20.0f; // 光源方向上额外包含的遮挡物范围
+
+    unsigned int FBO;
+    unsigned int depthTextureArray;
+    glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+    float cascadeSplits[MAX_CASCADES]; // 每个级联在视空间中的远端距离
+
+    CascadedShadowMap(int cascadeCount = 4, int resolution = 2048, int farUpdateInterval = 3)
+        : cascadeCount(glm::clamp(cascadeCount, 1, MAX_CASCADES)),
+          resolution(resolution),
+          farUpdateInterval(farUpdateInterval < 1 ? 1 : farUpdateInterval)
+    {
+        for (int i = 0; i < MAX_CASCADES; i++)
+        {
+            lightSpaceMatrices[i] = glm::mat4(1.0f);
+            cascadeSplits[i] = 0.0f;
+            pendingRender[i] = false;
+        }
+
+        glGenTextures(1, &depthTextureArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthTextureArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, this->cascadeCount,
+                     0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        // 线性过滤 + 比较模式：硬件对相邻2x2纹素做深度比较并双线性混合
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        memstats::OwnerScope owner("shadow map");
+        memstats::trackTexture(depthTextureArray, MemoryCategory::RenderTarget,
+                               memstats::textureBytes(resolution, resolution, this->cascadeCount, 4));
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTextureArray, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::SHADOW:: cascade framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~CascadedShadowMap()
+    {
+        release();
+    }
+
+    CascadedShadowMap(const CascadedShadowMap&) = delete;
+    CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+    // 删除深度纹理数组与FBO；main中的实例在GL上下文销毁之前显式调用，之后不能再使用
+    void release()
+    {
+        if (FBO == 0)
+            return;
+        memstats::untrackTexture(depthTextureArray);
+        glDeleteTextures(1, &depthTextureArray);
+        glDeleteFramebuffers(1, &FBO);
+        FBO = depthTextureArray = 0;
+    }
+
+    // 根据当前摄像机与光源方向计算本帧需要刷新的级联及其光源矩阵
+    void update(const glm::mat4& view, float fovy, float aspect, float nearPlane, float farPlane,
+                glm::vec3 lightDir)
+    {
+        float farShadow = glm::min(farPlane, shadowDistance);
+        lightDir = glm::normalize(lightDir);
+
+        float splitNear = nearPlane;
+        for (int i = 0; i < cascadeCount; i++)
+        {
+            float p = static_cast<float>(i + 1) / static_cast<float>(cascadeCount);
+            float logSplit = nearPlane * std::pow(farShadow / nearPlane, p);
+            float uniformSplit = nearPlane + (farShadow - nearPlane) * p;
+            float splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+
+            // 第0级联每帧刷新；其余级联按 frameIndex 轮询，首帧全部刷新
+            bool refresh = i == 0 || frameIndex == 0 ||
+                (frameIndex % farUpdateInterval) == static_cast<unsigned int>((i - 1) % farUpdateInterval);
+            pendingRender[i] = refresh;
+            if (refresh)
+            {
+                cascadeSplits[i] = splitFar;
+                lightSpaceMatrices[i] = fitCascade(view, fovy, aspect, splitNear, splitFar, lightDir);
+            }
+            splitNear = splitFar;
+        }
+        frameIndex++;
+    }
+
+    bool needsRender(int cascade) const
+    {
+        return pendingRender[cascade];
+    }
+
+    // 绑定第cascade层作为深度附件，并设置视口
+    void beginCascade(int cascade)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTextureArray, 0, cascade);
+        glViewport(0, 0, resolution, resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    void end(int viewportWidth, int viewportHeight)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, viewportWidth, viewportHeight);
+    }
+
+    // 把级联矩阵、划分距离与深度纹理数组绑定到光照着色器
+    void bind(const Shader& shader) const
+    {
+        shader.setInt("shadowMap", SHADOW_TEXTURE_UNIT);
+        shader.setInt("cascadeCount", cascadeCount);
+        for (int i = 0; i < cascadeCount; i++)
+        {
+            std::string index = "[" + std::to_string(i) + "]";
+            shader.setMat4("lightSpaceMatrices" + index, lightSpaceMatrices[i]);
+            shader.setFloat("cascadeSplits" + index, cascadeSplits[i]);
+        }
+        glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthTextureArray);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    unsigned int frameIndex = 0;
+    bool pendingRender[MAX_CASCADES];
+
+    // 用包围球拟合视锥切片，保证光源投影大小不随摄像机旋转变化，并按纹素对齐防止阴影边缘闪烁
+    glm::mat4 fitCascade(const glm::mat4& view, float fovy, float aspect, float splitNear, float splitFar,
+                         glm::vec3 lightDir) const
+    {
+        glm::mat4 invViewProj = glm::inverse(glm::perspective(fovy, aspect, splitNear, splitFar) * view);
+        glm::vec3 corners[8];
+        glm::vec3 center = glm::vec3(0.0f);
+        int n = 0;
+        for (int x = -1; x <= 1; x += 2)
+            for (int y = -1; y <= 1; y += 2)
+                for (int z = -1; z <= 1; z += 2)
+                {
+                    glm::vec4 corner = invViewProj * glm::vec4(static_cast<float>(x), static_cast<float>(y),
+                                                               static_cast<float>(z), 1.0f);
+                    corners[n] = glm::vec3(corner) / corner.w;
+                    center += corners[n];
+                    n++;
+                }
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for (int i = 0; i < 8; i++)
+            radius = glm::max(radius, glm::length(corners[i] - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(center - lightDir * (radius + casterMargin), center, up);
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f,
+                                               2.0f * radius + casterMargin);
+
+        // 把世界原点在阴影贴图中的位置对齐到整数纹素
+        glm::mat4 shadowMatrix = lightProjection * lightView;
+        glm::vec4 origin = shadowMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        origin *= static_cast<float>(resolution) / 2.0f;
+        glm::vec4 offset = (glm::round(origin) - origin) * (2.0f / static_cast<float>(resolution));
+        offset.z = 0.0f;
+        offset.w = 0.0f;
+        lightProjection[3] += offset;
+
+        return lightProjection * lightView;
+    }
+};
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+
+#include "snowflake.h"
+#include "snowcover.h"
+#include "profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// 无锁三缓冲：写线程总是写后台缓冲，发布时与中间缓冲交换；读线程在有新数据时把前台缓冲与中间缓冲交换。
+// 双方都不会等待对方，读线程总能拿到最近一次完整发布的数据。
+template <typename T>
+class TripleBuffer
+{
+public:
+    T& writeBuffer()
+    {
+        return buffers[backIndex];
+    }
+
+    void publish()
+    {
+        backIndex = middle.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // 有新数据时切换前台缓冲并返回true
+    bool fetch()
+    {
+        if ((middle.load(std::memory_order_acquire) & FRESH_BIT) == 0)
+            return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& readBuffer() const
+    {
+        return buffers[frontIndex];
+    }
+
+private:
+    static constexpr int FRESH_BIT = 4;
+    static constexpr int INDEX_MASK = 3;
+
+    T buffers[3];
+    std::atomic<int> middle{1};
+    int backIndex = 0;
+    int frontIndex = 2;
+};
+
+// 一次模拟步完成后的快照，同时保存步前与步后的位置，渲染线程在两者之间插值
+struct SimulationState
+{
+    std::vector<glm::vec3> previousPositions;
+    std::vector<glm::vec3> positions;
+    glm::vec3 previousLightPos = glm::vec3(0.0f);
+    glm::vec3 lightPos = glm::vec3(0.0f);
+    double time = 0.0; // 本步完成的时刻（秒，SimulationThread::now()）
+    uint64_t tick = 0;
+};
+
+// 独立的模拟线程：以固定步长更新雪花与太阳位置，通过三缓冲把结果交给渲染线程
+class SimulationThread
+{
+public:
+    double tickRate;
+    std::atomic<bool> snowing{true}; // 由渲染线程的输入处理写入
+    std::atomic<bool> sunMoving{true};
+    glm::vec3 initialLightPos = glm::vec3(10.0f, 10.0f, 10.0f);
+    SnowCover* snowCover = nullptr; // 不为空时把落地的雪花叠加到积雪高度场
+
+    SimulationThread(SnowflakeGenerator& generator, double tickRate = 60.0)
+        : tickRate(tickRate),
+          generator(generator)
+    {
+    }
+
+    ~SimulationThread()
+    {
+        stop();
+    }
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    double now() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    double tickInterval() const
+    {
+        return 1.0 / tickRate;
+    }
+
+    void start()
+    {
+        if (running.exchange(true))
+            return;
+        worker = std::thread(&SimulationThread::run, this);
+    }
+
+    void stop()
+    {
+        if (!running.exchange(false))
+            return;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // 执行一个固定步长的模拟步并发布结果；线程未启动时也可手动调用
+    void step()
+    {
+        PROFILE_SCOPE("simulation tick");
+        float dt = static_cast<float>(tickInterval());
+        simTime += dt;
+
+        // 同步渲染线程发来的开关
+        bool snowingNow = snowing.load(std::memory_order_relaxed);
+        if (generator.isSnowing && !snowingNow)
+            generator.clearSnowflakes(); // 清除所有雪花
+        generator.isSnowing = snowingNow;
+        generator.update(dt);
+        if (snowCover != nullptr)
+            snowCover->splat(generator.landed);
+
+        glm::vec3 previousLightPos = lightPos;
+        if (sunMoving.load(std::memory_order_relaxed))
+        {
+            // 计算移动时间
+            float speedFactor = 0.2f;
+            float timeValue = static_cast<float>(simTime) * speedFactor;
+            // 使用球面坐标计算光源位置
+            float maxAltitude = 1.0f;
+            lightPos = glm::vec3(20.0f * std::cos(timeValue), 20.0f * std::sin(timeValue),
+                                 std::sin(timeValue) * maxAltitude);
+        }
+        else
+        {
+            lightPos = initialLightPos; // 暂停时移动到初始位置
+        }
+        if (tick == 0)
+            previousLightPos = lightPos;
+
+        // 写入后台缓冲，复用其中vector的容量，稳定后不再分配内存
+        SimulationState& state = states.writeBuffer();
+        size_t count = generator.snowflakes.size();
+        state.previousPositions.resize(count);
+        state.positions.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            state.previousPositions[i] = generator.snowflakes[i].previousPosition;
+            state.positions[i] = generator.snowflakes[i].position;
+        }
+        state.previousLightPos = previousLightPos;
+        state.lightPos = lightPos;
+        state.time = now();
+        state.tick = ++tick;
+        states.publish();
+    }
+
+    // 渲染线程调用：取最新快照并按当前时刻插值，没有任何快照时返回false
+    bool interpolate(double time, std::vector<glm::vec3>& positions, glm::vec3& outLightPos)
+    {
+        states.fetch();
+        const SimulationState& state = states.readBuffer();
+        if (state.tick == 0)
+            return false;
+
+        // 快照表示 [time - dt, time] 区间的两端，渲染滞后一个步长以便总能在两端之间插值
+        float alpha = static_cast<float>((time - state.time) / tickInterval());
+        blend(state, glm::clamp(alpha, 0.0f, 1.0f), positions, outLightPos);
+        return true;
+    }
+
+    // 取最新快照的步后状态，不插值；线程未启动、由调用方手动step()时使用
+    bool latest(std::vector<glm::vec3>& positions, glm::vec3& outLightPos)
+    {
+        states.fetch();
+        const SimulationState& state = states.readBuffer();
+        if (state.tick == 0)
+            return false;
+        blend(state, 1.0f, positions, outLightPos);
+        return true;
+    }
+
+private:
+    SnowflakeGenerator& generator;
+    TripleBuffer<SimulationState> states;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    std::atomic<bool> running{false};
+    std::thread worker;
+    double simTime = 0.0;
+    uint64_t tick = 0;
+    glm::vec3 lightPos = glm::vec3(0.0f);
+
+    static void blend(const SimulationState& state, float alpha, std::vector<glm::vec3>& positions,
+                      glm::vec3& outLightPos)
+    {
+        size_t count = state.positions.size();
+        positions.resize(count);
+        for (size_t i = 0; i < count; i++)
+            positions[i] = glm::mix(state.previousPositions[i], state.positions[i], alpha);
+        outLightPos = glm::mix(state.previousLightPos, state.lightPos, alpha);
+    }
+
+    void run()
+    {
+        using clock = std::chrono::steady_clock;
+        auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(tickInterval()));
+        auto next = clock::now();
+        while (running.load(std::memory_order_relaxed))
+        {
+            step();
+            next += interval;
+            // 落后太多（例如调试器暂停）时放弃追赶，避免连续执行大量模拟步
+            if (clock::now() - next > interval * 5)
+                next = clock::now();
+            std::this_thread::sleep_until(next);
+        }
+    }
+};
+
+#endif
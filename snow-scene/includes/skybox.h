@@ -6,14 +6,16 @@
 #include <iostream>
 #include <glad/glad.h>
 
+#include "glstats.h"
+#include "memstats.h"
 #include "shader.h"
+#include "atmosphere.h"
 
 class Skybox
 {
 private:
     Shader skyboxShader;
     unsigned int skyboxVAO, skyboxVBO;
-    unsigned int cubemapTexture;
     float skyboxVertices[108] = {
         -1.0f, 1.0f, -1.0f,
         -1.0f, -1.0f, -1.0f,
@@ -59,65 +61,33 @@ private:
     };
 
 public:
-    Skybox(std::vector<std::string> faces)
-        : skyboxShader("shaders/skybox-vert.glsl", "shaders/skybox-frag.glsl"),
-          cubemapTexture(loadCubemap(faces))
+    // 天空颜色来自Atmosphere的查找表，不再加载立方体贴图
+    Skybox()
+        : skyboxShader("shaders/skybox-vert.glsl", "shaders/skybox-frag.glsl")
     {
         glGenVertexArrays(1, &skyboxVAO);
         glGenBuffers(1, &skyboxVBO);
         glBindVertexArray(skyboxVAO);
         glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        memstats::OwnerScope owner("skybox");
+        memstats::trackBuffer(skyboxVBO, MemoryCategory::VertexBuffer, sizeof(skyboxVertices));
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
     }
 
-    void draw(glm::mat4 view, glm::mat4 projection)
+    void draw(glm::mat4 view, glm::mat4 projection, const Atmosphere& atmosphere)
     {
         glDepthFunc(GL_LEQUAL);
         skyboxShader.use();
         skyboxShader.setMat4("view", view);
         skyboxShader.setMat4("projection", projection);
+        atmosphere.bind(skyboxShader);
         glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
         glBindVertexArray(0);
         glDepthFunc(GL_LESS);
     }
-
-private:
-    unsigned int loadCubemap(std::vector<std::string> faces)
-    {
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-        int width, height, nrChannels;
-        for (unsigned int i = 0; i < faces.size(); i++)
-        {
-            unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-            if (data)
-            {
-                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                             0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-                );
-                stbi_image_free(data);
-            }
-            else
-            {
-                std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-                stbi_image_free(data);
-            }
-        }
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-        return textureID;
-    }
 };
 
 #endif
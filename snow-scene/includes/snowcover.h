@@ -0,0 +1,302 @@
+#ifndef SNOWCOVER_H
+#define SNOWCOVER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// 积雪高度场使用的纹理单元
+const int SNOW_COVER_TEXTURE_UNIT = 9;
+
+// 地面积雪高度场
+// 雪花落地时在CPU上把一个小核叠加到高度场中，并把覆盖到的32x32分块标记为脏；
+// 每帧只把脏分块经像素缓冲对象(PBO)用glTexSubImage2D上传，开销与落地的雪花数量成正比，与高度场大小无关。
+class SnowCover
+{
+public:
+    static constexpr int TILE_SIZE = 32;
+
+    int resolution; // 高度场边长（纹素）
+    float extent; // 覆盖世界坐标 [-extent, extent]
+    float splatRadius = 0.12f; // 单片雪花的影响半径（世界单位）
+    float splatDepth = 0.004f; // 单片雪花在中心处增加的厚度
+    float maxDepth = 0.6f; // 积雪最大厚度
+    float fullCoverDepth = 0.02f; // 达到该厚度时完全显示为雪
+
+    unsigned int texture;
+
+    SnowCover(int resolution = 512, float extent = 12.0f)
+        : resolution(resolution),
+          extent(extent),
+          tilesPerRow((resolution + TILE_SIZE - 1) / TILE_SIZE),
+          heights(static_cast<size_t>(resolution) * resolution, 0.0f),
+          tileDirty(static_cast<size_t>(tilesPerRow) * tilesPerRow, 0)
+    {
+        memstats::OwnerScope owner("snow cover");
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, heights.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // 地面底色
+        unsigned char groundColor[4] = {89, 77, 64, 255};
+        glGenTextures(1, &groundTexture);
+        glBindTexture(GL_TEXTURE_2D, groundTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, groundColor);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        memstats::trackTexture(texture, MemoryCategory::Texture, memstats::textureBytes(resolution, resolution, 1, 4));
+        memstats::trackTexture(groundTexture, MemoryCategory::Texture, 4);
+        memstats::trackHost(heights.data(), MemoryCategory::HostData, heights.size() * sizeof(float));
+
+        glGenBuffers(1, &PBO);
+        memstats::trackBuffer(PBO, MemoryCategory::StreamBuffer, 0);
+        setupGround();
+    }
+
+    ~SnowCover()
+    {
+        release();
+    }
+
+    SnowCover(const SnowCover&) = delete;
+    SnowCover& operator=(const SnowCover&) = delete;
+
+    // 删除高度纹理、地面纹理、PBO与地面网格；main中的实例在GL上下文销毁之前显式调用，之后不能再使用
+    void release()
+    {
+        if (texture == 0)
+            return;
+        memstats::untrackTexture(texture);
+        memstats::untrackTexture(groundTexture);
+        memstats::untrackHost(heights.data());
+        memstats::untrackBuffer(PBO);
+        memstats::untrackBuffer(groundVBO);
+        memstats::untrackBuffer(groundEBO);
+        glDeleteTextures(1, &texture);
+        glDeleteTextures(1, &groundTexture);
+        glDeleteBuffers(1, &PBO);
+        glDeleteVertexArrays(1, &groundVAO);
+        glDeleteBuffers(1, &groundVBO);
+        glDeleteBuffers(1, &groundEBO);
+        texture = groundTexture = PBO = groundVAO = groundVBO = groundEBO = 0;
+    }
+
+    // 把一批落地位置叠加到高度场中，可在模拟线程中调用
+    void splat(const std::vector<glm::vec3>& landings)
+    {
+        if (landings.empty())
+            return;
+
+        float texelsPerUnit = resolution / (2.0f * extent);
+        float radius = splatRadius * texelsPerUnit;
+        int r = static_cast<int>(std::ceil(radius));
+        float invRadius2 = 1.0f / (radius * radius);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const glm::vec3& p : landings)
+        {
+            float cx = (p.x + extent) * texelsPerUnit;
+            float cy = (p.z + extent) * texelsPerUnit;
+            int ix = static_cast<int>(cx);
+            int iy = static_cast<int>(cy);
+            if (ix + r < 0 || iy + r < 0 || ix - r >= resolution || iy - r >= resolution)
+                continue;
+
+            int x0 = glm::max(ix - r, 0), x1 = glm::min(ix + r, resolution - 1);
+            int y0 = glm::max(iy - r, 0), y1 = glm::min(iy + r, resolution - 1);
+            for (int y = y0; y <= y1; y++)
+            {
+                float dy = y + 0.5f - cy;
+                float* row = &heights[static_cast<size_t>(y) * resolution];
+                for (int x = x0; x <= x1; x++)
+                {
+                    float dx = x + 0.5f - cx;
+                    float w = 1.0f - (dx * dx + dy * dy) * invRadius2;
+                    if (w <= 0.0f)
+                        continue;
+                    row[x] = glm::min(row[x] + splatDepth * w * w, maxDepth);
+                }
+            }
+            markDirty(x0, y0, x1, y1);
+        }
+    }
+
+    // 清除全部积雪
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::fill(heights.begin(), heights.end(), 0.0f);
+        markDirty(0, 0, resolution - 1, resolution - 1);
+    }
+
+    // 渲染线程调用：把脏分块写入PBO，再逐块从PBO更新纹理
+    void upload()
+    {
+        const size_t tileFloats = static_cast<size_t>(TILE_SIZE) * TILE_SIZE;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (dirtyTiles.empty())
+                return;
+            uploadTiles.swap(dirtyTiles);
+            dirtyTiles.clear();
+
+            const GLsizeiptr bytes = static_cast<GLsizeiptr>(uploadTiles.size() * tileFloats * sizeof(float));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+            // 重新分配存储，避免与上一帧仍在使用的数据同步
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+            memstats::trackBuffer(PBO, MemoryCategory::StreamBuffer, static_cast<size_t>(bytes));
+            float* staging = static_cast<float*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            for (size_t i = 0; i < uploadTiles.size(); i++)
+            {
+                int tile = uploadTiles[i];
+                tileDirty[tile] = 0; // 之后再落在该分块上的雪花会重新标记
+                if (staging == nullptr)
+                    continue;
+                int x = (tile % tilesPerRow) * TILE_SIZE, y = (tile / tilesPerRow) * TILE_SIZE;
+                int width = glm::min(TILE_SIZE, resolution - x), height = glm::min(TILE_SIZE, resolution - y);
+                float* dst = staging + i * tileFloats;
+                for (int row = 0; row < height; row++)
+                    std::memcpy(dst + row * TILE_SIZE, &heights[static_cast<size_t>(y + row) * resolution + x],
+                                width * sizeof(float));
+            }
+            if (staging == nullptr)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                uploadTiles.clear();
+                markDirty(0, 0, resolution - 1, resolution - 1);
+                return;
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        // 纹理更新不需要持有锁，模拟线程可以同时继续写高度场
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, TILE_SIZE);
+        for (size_t i = 0; i < uploadTiles.size(); i++)
+        {
+            int tile = uploadTiles[i];
+            int x = (tile % tilesPerRow) * TILE_SIZE, y = (tile / tilesPerRow) * TILE_SIZE;
+            int width = glm::min(TILE_SIZE, resolution - x), height = glm::min(TILE_SIZE, resolution - y);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RED, GL_FLOAT,
+                            reinterpret_cast<const void*>(i * tileFloats * sizeof(float)));
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        uploadTiles.clear();
+    }
+
+    // 设置光照着色器采样高度场所需的uniform
+    void bind(const Shader& shader) const
+    {
+        shader.setInt("snowCover", SNOW_COVER_TEXTURE_UNIT);
+        shader.setFloat("snowCoverExtent", extent);
+        shader.setFloat("snowFullCoverDepth", fullCoverDepth);
+        glActiveTexture(GL_TEXTURE0 + SNOW_COVER_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // 绘制按高度场位移的地面网格，groundShader使用ground-vert.glsl与光照片段着色器
+    void drawGround(const Shader& groundShader, const glm::mat4& view, const glm::mat4& projection) const
+    {
+        groundShader.use();
+        groundShader.setMat4("view", view);
+        groundShader.setMat4("projection", projection);
+        bind(groundShader);
+        groundShader.setInt("texture_diffuse1", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, groundTexture);
+        glBindVertexArray(groundVAO);
+        glDrawElements(GL_TRIANGLES, groundIndexCount, GL_UNSIGNED_INT, nullptr);
+        glBindVertexArray(0);
+    }
+
+private:
+    int tilesPerRow;
+    std::vector<float> heights;
+    std::vector<unsigned char> tileDirty;
+    std::vector<int> dirtyTiles; // 脏分块列表，上传时无需扫描整个高度场
+    std::vector<int> uploadTiles;
+    std::mutex mutex;
+    unsigned int PBO;
+    unsigned int groundTexture;
+    unsigned int groundVAO, groundVBO, groundEBO;
+    int groundIndexCount = 0;
+
+    void markDirty(int x0, int y0, int x1, int y1)
+    {
+        for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+        {
+            for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+            {
+                int tile = ty * tilesPerRow + tx;
+                if (!tileDirty[tile])
+                {
+                    tileDirty[tile] = 1;
+                    dirtyTiles.push_back(tile);
+                }
+            }
+        }
+    }
+
+    // 地面网格：位置(location 0)与纹理坐标(location 2)，纹理坐标同时用于采样高度场
+    void setupGround()
+    {
+        const int cells = 128;
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        vertices.reserve((cells + 1) * (cells + 1) * 5);
+        indices.reserve(cells * cells * 6);
+        for (int z = 0; z <= cells; z++)
+        {
+            for (int x = 0; x <= cells; x++)
+            {
+                float u = static_cast<float>(x) / cells, v = static_cast<float>(z) / cells;
+                vertices.insert(vertices.end(), {(u * 2.0f - 1.0f) * extent, 0.0f, (v * 2.0f - 1.0f) * extent, u, v});
+            }
+        }
+        for (int z = 0; z < cells; z++)
+        {
+            for (int x = 0; x < cells; x++)
+            {
+                unsigned int i0 = z * (cells + 1) + x, i1 = i0 + 1, i2 = i0 + cells + 1, i3 = i2 + 1;
+                indices.insert(indices.end(), {i0, i2, i1, i1, i2, i3});
+            }
+        }
+        groundIndexCount = static_cast<int>(indices.size());
+
+        glGenVertexArrays(1, &groundVAO);
+        glGenBuffers(1, &groundVBO);
+        glGenBuffers(1, &groundEBO);
+        glBindVertexArray(groundVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, groundVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, groundEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        memstats::trackBuffer(groundVBO, MemoryCategory::VertexBuffer, vertices.size() * sizeof(float));
+        memstats::trackBuffer(groundEBO, MemoryCategory::VertexBuffer, indices.size() * sizeof(unsigned int));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+        glBindVertexArray(0);
+    }
+};
+
+#endif
@@ -5,22 +5,32 @@
 
 
 #include "shader.h"
+#include "memstats.h"
 #include "model.h"
+#include "commandlist.h"
+#include "sdf.h"
+#include "windfield.h"
+#include "random.h"
+
+#include <vector>
 
 class Snowflake
 {
 public:
     glm::vec3 position;
+    glm::vec3 previousPosition; // 上一次更新前的位置，用于渲染插值
     glm::vec3 velocity;
 
     Snowflake(glm::vec3 pos, glm::vec3 vel) :
         position(pos),
+        previousPosition(pos),
         velocity(vel)
     {
     }
 
     void update(float deltaTime)
     {
+        previousPosition = position;
         position += velocity * deltaTime;
     }
 };
@@ -30,84 +40,181 @@ class SnowflakeGenerator
 public:
     bool isSnowing = true; // 控制是否下雪的变量
     std::vector<Snowflake> snowflakes;
-    float spawnInterval = 1.0f; // 每秒生成雪花的时间间隔
-    float elapsedTime = 0.0f;
+    std::vector<glm::vec3> landed; // 本次update中落地的雪花位置
+    float spawnRate = 3.0f; // 平均每秒生成的雪花数，每步的生成数服从泊松分布
     float xRange = 16.0f; // x轴范围
     float yStart = 10.0f; // y轴起始高度
     float zRange = 16.0f; // z轴范围
     float xVelRange = 1.0f; // x轴速度范围
     float yVel = -2.0f; // y轴速度（向下）
     float zVelRange = 1.0f; // z轴速度范围
+    const SceneSDF* collider = nullptr; // 静态场景的距离场，为空时只检测地面
+    float flakeRadius = 0.05f; // 雪花碰撞半径
+    WindField* wind = nullptr; // 风场，为空时雪花保持生成时的速度
+    float windResponse = 1.5f; // 雪花速度趋向风速的快慢（1/秒）
 
-    SnowflakeGenerator()
+    // 雪花实例的缩放与颜色，GL与软件光栅两个后端共用，保证--diff-backends比较的是同一画面
+    static float flakeScale()
     {
+        return 0.2f;
+    }
+
+    static glm::vec4 flakeColor()
+    {
+        return glm::vec4(209.0f / 255.0f, 225.0f / 255.0f, 255.0f / 255.0f, 1.0f);
+    }
+
+    // 相同的种子得到相同的雪花序列
+    explicit SnowflakeGenerator(uint64_t seed = 1)
+    {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t seed)
+    {
+        rng.seed(seed);
+        bulkRng.seed(seed ^ 0xD1B54A32D192ED03ull);
     }
 
     void update(float deltaTime)
     {
+        landed.clear();
+        if (wind != nullptr)
+            wind->advance(deltaTime);
         if (!isSnowing) return; // 如果不下雪，直接返回
-        elapsedTime += deltaTime;
-        if (elapsedTime >= spawnInterval)
+        spawn(rng.poisson(spawnRate * deltaTime));
+
+        // 速度以指数衰减的方式趋向 下落速度 + 风速，步长变化时行为一致
+        float windBlend = 1.0f - std::exp(-windResponse * deltaTime);
+
+        // 落地的雪花与末尾元素交换后删除，避免vector中间删除的O(n)搬移
+        for (size_t i = 0; i < snowflakes.size();)
         {
-            elapsedTime = 0.0f;
-            int count = rand() % 5 + 1; // 随机生成1到5朵雪花
-            for (int i = 0; i < count; i++)
+            if (wind != nullptr)
             {
-                float x = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * xRange - 8.0f;
-                float y = yStart;
-                float z = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * zRange - 8.0f;
-
-                float xVel = (static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * xVelRange) - xVelRange / 2.0f;
-                float zVel = (static_cast<float>(rand()) / static_cast<float>(RAND_MAX) * zVelRange) - zVelRange / 2.0f;
-                glm::vec3 pos = glm::vec3(x, y, z);
-                glm::vec3 vel = glm::vec3(xVel, yVel, zVel);
-                snowflakes.push_back(Snowflake(pos, vel));
+                glm::vec3 target = glm::vec3(0.0f, yVel, 0.0f) + wind->sample(snowflakes[i].position);
+                snowflakes[i].velocity += (target - snowflakes[i].velocity) * windBlend;
+            }
+            snowflakes[i].update(deltaTime);
+            bool removed = false;
+            if (snowflakes[i].position.y <= 0)
+            {
+                landed.push_back(snowflakes[i].position);
+                removed = true;
+            }
+            else if (collider != nullptr)
+            {
+                removed = collide(snowflakes[i]);
             }
-        }
 
-        for (auto it = snowflakes.begin(); it != snowflakes.end();)
-        {
-            it->update(deltaTime);
-            if (it->position.y <= 0)
+            if (removed)
             {
-                it = snowflakes.erase(it);
+                snowflakes[i] = snowflakes.back();
+                snowflakes.pop_back();
             }
             else
             {
-                ++it;
+                ++i;
             }
         }
     }
 
-    void draw(Shader& shader, Model& model, Camera& camera, int SRC_WIDTH, int SRC_HEIGHT)
+    // 雪花由模拟线程更新，渲染线程只拿到插值后的位置；所有雪花一次实例化绘制
+    // shader需要 SHADER_UNLIT_COLOR | SHADER_INSTANCED 排列
+    // 只录制命令，可在工作线程调用；实例数据在回放时上传，positions要保持到回放结束
+    void record(CommandList& list, Shader& shader, Model& model, const glm::mat4& view, const glm::mat4& projection,
+                const std::vector<glm::vec3>& positions)
     {
-        shader.use();
-        for (const auto& snowflake : snowflakes)
+        if (positions.empty())
+            return;
+        list.call(&SnowflakeGenerator::uploadCommand, InstanceUpload{this, &model, &positions});
+        list.use(shader);
+        list.setMat4("projection", projection);
+        list.setMat4("view", view);
+        list.setFloat("instanceScale", flakeScale());
+        list.setVec4("color", flakeColor());
+        for (Mesh& mesh : model.meshes)
+            list.draw(mesh, static_cast<GLsizei>(positions.size()));
+    }
+
+    // 批量生成count朵雪花：一次性填充全部随机数，再连续写入雪花数组
+    void spawn(uint32_t count)
+    {
+        if (count == 0)
+            return;
+        // 每朵雪花4个随机数：x, z, x速度, z速度，统一取[0, 1)后按范围映射
+        spawnScratch.resize(static_cast<size_t>(count) * 4);
+        bulkRng.fill(spawnScratch.data(), spawnScratch.size());
+        snowflakes.reserve(snowflakes.size() + count);
+        const float* r = spawnScratch.data();
+        for (uint32_t i = 0; i < count; i++, r += 4)
         {
-            drawCrystal(shader, model, snowflake.position, camera, SRC_WIDTH, SRC_HEIGHT);
+            glm::vec3 pos = glm::vec3(r[0] * xRange - 8.0f, yStart, r[1] * zRange - 8.0f);
+            glm::vec3 vel = glm::vec3(r[2] * xVelRange - xVelRange / 2.0f, yVel, r[3] * zVelRange - zVelRange / 2.0f);
+            snowflakes.emplace_back(pos, vel);
         }
     }
 
+    // 与距离场碰撞：落在朝上的表面（屋顶、雪人头顶）时停住并移除，返回true；
+    // 碰到侧面时推出表面并去掉指向表面的速度分量，沿表面继续下滑
+    bool collide(Snowflake& flake) const
+    {
+        float d = collider->distance(flake.position);
+        if (d >= flakeRadius)
+            return false;
+        glm::vec3 normal = collider->gradient(flake.position);
+        if (normal.y > 0.5f)
+            return true;
+        flake.position += normal * (flakeRadius - d);
+        float into = glm::dot(flake.velocity, normal);
+        if (into < 0.0f)
+            flake.velocity -= normal * into;
+        return false;
+    }
+
     void clearSnowflakes()
     {
         snowflakes.clear(); // 清除所有雪花
     }
 
-    void drawCrystal(Shader& shader, Model& crystal, glm::vec3 position, Camera& camera, int SCR_WIDTH, int SCR_HEIGHT)
+private:
+    Xoshiro128 rng; // 泊松计数
+    Xoshiro128x8 bulkRng; // 批量填充生成参数
+    std::vector<float> spawnScratch;
+    unsigned int instanceVBO = 0; // 雪花位置，渲染线程首次绘制时创建
+    const Model* instancedModel = nullptr;
+
+    struct InstanceUpload
     {
-        glm::mat4 projectionMat = glm::perspective(glm::radians(camera.Zoom),
-                                                   (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                                                   0.1f,
-                                                   100.0f);
-        glm::mat4 viewMat = camera.GetViewMatrix();
-        shader.setMat4("projection", projectionMat);
-        shader.setMat4("view", viewMat);
-        glm::mat4 modelMat = glm::translate(glm::mat4(1.0f), position);
-        modelMat = glm::scale(modelMat, glm::vec3(0.2f, 0.2f, 0.2f));
-        shader.setMat4("model", modelMat);
-        shader.setVec4("color", glm::vec4(209.0f / 255.0f, 225.0f / 255.0f, 255.0f / 255.0f, 1.0f));
-        crystal.Draw(shader);
-        shader.setVec4("color", glm::vec4(0.0f));
+        SnowflakeGenerator* generator;
+        Model* model;
+        const std::vector<glm::vec3>* positions;
+    };
+
+    static void uploadCommand(const InstanceUpload& upload)
+    {
+        upload.generator->uploadInstances(*upload.model, *upload.positions);
+    }
+
+    // 把雪花位置写入实例缓冲，首次绘制某个模型时把缓冲挂到它的VAO上
+    void uploadInstances(Model& model, const std::vector<glm::vec3>& positions)
+    {
+        if (instanceVBO == 0)
+        {
+            glGenBuffers(1, &instanceVBO);
+            memstats::OwnerScope owner("snowflakes");
+            memstats::trackBuffer(instanceVBO, MemoryCategory::StreamBuffer, 0);
+        }
+        if (instancedModel != &model)
+        {
+            for (Mesh& mesh : model.meshes)
+                mesh.setInstanceBuffer(instanceVBO);
+            instancedModel = &model;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STREAM_DRAW);
+        memstats::trackBuffer(instanceVBO, MemoryCategory::StreamBuffer, positions.size() * sizeof(glm::vec3));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 };
 
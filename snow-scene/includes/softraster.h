@@ -0,0 +1,930 @@
+#ifndef SOFTRASTER_H
+#define SOFTRASTER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "atmosphere.h"
+#include "memstats.h"
+#include "mesh.h"
+#include "model.h"
+#include "shadow.h"
+#include "workerpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTRASTER_SSE2 1
+#endif
+
+// 纹理的CPU副本，RGBA浮点，行顺序与GL纹理相同（第0行对应t=0）
+struct SoftwareImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec4> texels;
+
+    // 双线性过滤；wrap为true时重复，否则截取到边缘
+    glm::vec4 sample(glm::vec2 uv, bool wrapS = true, bool wrapT = true) const
+    {
+        float x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+        float fx = std::floor(x), fy = std::floor(y);
+        int x0 = static_cast<int>(fx), y0 = static_cast<int>(fy);
+        float tx = x - fx, ty = y - fy;
+        glm::vec4 a = texel(x0, y0, wrapS, wrapT), b = texel(x0 + 1, y0, wrapS, wrapT);
+        glm::vec4 c = texel(x0, y0 + 1, wrapS, wrapT), d = texel(x0 + 1, y0 + 1, wrapS, wrapT);
+        return glm::mix(glm::mix(a, b, tx), glm::mix(c, d, tx), ty);
+    }
+
+    glm::vec4 texel(int x, int y, bool wrapS, bool wrapT) const
+    {
+        x = wrapS ? ((x % width) + width) % width : std::min(std::max(x, 0), width - 1);
+        y = wrapT ? ((y % height) + height) % height : std::min(std::max(y, 0), height - 1);
+        return texels[static_cast<size_t>(y) * width + x];
+    }
+
+    // 与TextureFromFile一致：单通道按GL_RED（其余分量为0），三通道alpha为1
+    bool load(const std::string& path)
+    {
+        int components = 0;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if (data == nullptr)
+            return false;
+        texels.resize(static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < texels.size(); i++)
+        {
+            const unsigned char* p = data + i * components;
+            glm::vec4 c(0.0f, 0.0f, 0.0f, 1.0f);
+            for (int k = 0; k < components && k < 4; k++)
+                c[k] = p[k] / 255.0f;
+            texels[i] = c;
+        }
+        stbi_image_free(data);
+        return true;
+    }
+};
+
+// 多线程分块软件光栅化器，绘制与GL路径相同的模型网格、雪花与天空，输出供逐像素比对
+// 每个通道（阴影级联、主视图）分三步，每步都在WorkerPool上并行：
+//   1. 顶点变换到裁剪空间
+//   2. 三角形按块分给线程做近平面裁剪与建立（边函数、深度平面、多边形偏移），再按64x64像素的屏幕分块装箱
+//   3. 每个分块由一个线程独占光栅化，按提交顺序遍历各线程的装箱结果；SSE2一次计算4个像素的边函数与深度，
+//      每8x8像素维护最大深度（分层深度），三角形的最小深度不小于它时整块跳过
+// 主视图只记录可见三角形与透视校正后的重心坐标（可见性缓冲），光栅化结束后每个像素只着色一次，
+// 光照、级联阴影（3x3 PCF，每次采样2x2比较加双线性混合）和天空与model-frag.glsl、skybox-frag.glsl逐项对应。
+// 不实现积雪覆盖、分簇点光源与积雪地面；纹理只做双线性过滤（GL使用三线性mipmap）。
+// 资源加载、大气LUT烘焙与最终显示仍需要GL上下文。
+class SoftwareRasterizer
+{
+public:
+    static constexpr int TILE_SIZE = 64;
+    static constexpr int BLOCK_SIZE = 8; // 分层深度的块边长
+    static constexpr uint32_t NO_TRIANGLE = 0xFFFFFFFFu;
+
+    glm::vec3 clearColor = glm::vec3(0.05f);
+    glm::vec3 objectColor = glm::vec3(0.0f); // 对应model-frag.glsl的objectColor，GL路径未设置，保持为0
+    int shadowResolution = 0; // 0表示与GPU阴影贴图相同
+    float polygonOffsetFactor = 2.0f; // 与recordShadowMap中的多边形偏移一致
+    float polygonOffsetUnits = 4.0f;
+
+    SoftwareRasterizer(int width, int height,
+                       unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency()))
+        : workers(threadCount)
+    {
+        resize(width, height);
+    }
+
+    SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+    void resize(int width, int height)
+    {
+        screen.resize(width, height);
+        triangleIds.assign(screen.depth.size(), NO_TRIANGLE);
+        barycentrics.assign(screen.depth.size(), glm::vec2(0.0f));
+        color.assign(screen.depth.size(), 0);
+    }
+
+    int width() const
+    {
+        return screen.width;
+    }
+
+    int height() const
+    {
+        return screen.height;
+    }
+
+    // 每帧开始时调用，清空上一帧提交的绘制
+    void beginFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos,
+                    const glm::vec3& lightPos, const glm::vec3& lightColor)
+    {
+        this->view = view;
+        this->projection = projection;
+        this->viewPos = viewPos;
+        this->lightPos = lightPos;
+        this->lightColor = lightColor;
+        jobs.clear();
+        materials.clear();
+        vertexCount = 0;
+        triangleCount = 0;
+    }
+
+    // 复制级联的矩阵与分割距离；GL路径本帧不刷新的远级联在这里同样沿用上一次的深度
+    void setShadows(const CascadedShadowMap& shadowMap)
+    {
+        int resolution = shadowResolution > 0 ? shadowResolution : shadowMap.resolution;
+        cascadeCount = shadowMap.cascadeCount;
+        if (static_cast<int>(cascades.size()) != cascadeCount || cascades[0].width != resolution)
+        {
+            cascades.assign(cascadeCount, Target());
+            for (Target& t : cascades)
+                t.resize(resolution, resolution);
+            cascadeValid.assign(cascadeCount, false);
+        }
+        for (int i = 0; i < cascadeCount; i++)
+        {
+            cascadeRender[i] = shadowMap.needsRender(i) || !cascadeValid[i];
+            if (cascadeRender[i])
+                lightSpaceMatrices[i] = shadowMap.lightSpaceMatrices[i];
+            cascadeSplits[i] = shadowMap.cascadeSplits[i];
+        }
+        shadowsEnabled = true;
+    }
+
+    // 天空视图LUT刷新后才重新读回
+    void setSky(const Atmosphere& atmosphere)
+    {
+        if (atmosphere.revision() != skyRevision)
+        {
+            std::vector<glm::vec4> transmittance, skyView;
+            atmosphere.readLUTs(transmittance, skyView);
+            transmittanceLUT.width = Atmosphere::TRANSMITTANCE_WIDTH;
+            transmittanceLUT.height = Atmosphere::TRANSMITTANCE_HEIGHT;
+            transmittanceLUT.texels.swap(transmittance);
+            skyViewLUT.width = Atmosphere::SKY_VIEW_WIDTH;
+            skyViewLUT.height = Atmosphere::SKY_VIEW_HEIGHT;
+            skyViewLUT.texels.swap(skyView);
+            skyRevision = atmosphere.revision();
+        }
+        sunDirection = atmosphere.sunDirection();
+        sunIntensity = atmosphere.sunIntensity;
+        viewHeight = atmosphere.viewHeight;
+        exposure = atmosphere.exposure;
+        skyEnabled = true;
+    }
+
+    // 带光照与阴影的模型，矩阵同setModelMatrix
+    void drawModel(const Model& model, const glm::mat4& world, const glm::mat3& normalMatrix)
+    {
+        for (const Mesh& mesh : model.meshes)
+        {
+            Material material;
+            material.texture = diffuseTexture(model, mesh);
+            addJob(mesh, world, normalMatrix, addMaterial(material));
+        }
+    }
+
+    // 不做光照的实例化绘制（雪花），每个实例为统一缩放加平移
+    void drawInstances(const Model& model, const std::vector<glm::vec3>& offsets, float scale,
+                       const glm::vec4& unlitColor)
+    {
+        Material material;
+        material.unlit = true;
+        material.color = unlitColor;
+        uint32_t index = addMaterial(material);
+        for (const glm::vec3& offset : offsets)
+        {
+            glm::mat4 world = glm::scale(glm::translate(glm::mat4(1.0f), offset), glm::vec3(scale));
+            for (const Mesh& mesh : model.meshes)
+                addJob(mesh, world, glm::mat3(1.0f), index);
+        }
+    }
+
+    // 渲染本帧提交的全部绘制
+    void render()
+    {
+        transformVertices();
+
+        if (shadowsEnabled)
+        {
+            for (int i = 0; i < cascadeCount; i++)
+            {
+                if (!cascadeRender[i])
+                    continue;
+                cascades[i].clear();
+                rasterize(cascades[i], lightSpaceMatrices[i], true);
+                cascadeValid[i] = true;
+            }
+        }
+
+        screen.clear();
+        std::fill(triangleIds.begin(), triangleIds.end(), NO_TRIANGLE);
+        rasterize(screen, projection * view, false);
+        shade();
+    }
+
+    // 颜色缓冲，RGBA8，行自下而上，行距为stride()个像素
+    const std::vector<uint32_t>& colorBuffer() const
+    {
+        return color;
+    }
+
+    int stride() const
+    {
+        return screen.stride;
+    }
+
+    // 上传颜色缓冲并拉伸复制到当前绑定的绘制帧缓冲
+    void present(int targetWidth, int targetHeight)
+    {
+        GLint target = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        if (presentTexture == 0)
+        {
+            glGenTextures(1, &presentTexture);
+            glGenFramebuffers(1, &presentFBO);
+        }
+        glBindTexture(GL_TEXTURE_2D, presentTexture);
+        if (presentWidth != screen.width || presentHeight != screen.height)
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, screen.width, screen.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            memstats::OwnerScope owner("software raster");
+            memstats::trackTexture(presentTexture, MemoryCategory::Texture,
+                                   memstats::textureBytes(screen.width, screen.height, 1, 4));
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFBO);
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, presentTexture, 0);
+            presentWidth = screen.width;
+            presentHeight = screen.height;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, screen.stride);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, screen.width, screen.height, GL_RGBA, GL_UNSIGNED_BYTE, color.data());
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, presentFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+        bool scaled = targetWidth != screen.width || targetHeight != screen.height;
+        glBlitFramebuffer(0, 0, screen.width, screen.height, 0, 0, targetWidth, targetHeight, GL_COLOR_BUFFER_BIT,
+                          scaled ? GL_LINEAR : GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+    }
+
+    // 上一次render()提交的三角形数
+    size_t triangles() const
+    {
+        return triangleCount;
+    }
+
+private:
+    struct Material
+    {
+        const SoftwareImage* texture = nullptr; // 为空时按白色
+        bool unlit = false;                     // 不做光照、不投射阴影（雪花）
+        glm::vec4 color = glm::vec4(1.0f);
+    };
+
+    // 一个网格（或一个实例的网格）的世界变换，顶点与三角形写入各自预留的区间
+    struct Job
+    {
+        const Mesh* mesh;
+        glm::mat4 world;
+        glm::mat3 normalMatrix;
+        uint32_t material;
+        size_t firstVertex;
+        size_t firstTriangle;
+    };
+
+    struct WorldVertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    struct Triangle
+    {
+        uint32_t v[3];
+        uint32_t material;
+    };
+
+    // 建立好的屏幕空间三角形：lambda_i = a[i] * x + b[i] * y + c[i]（像素中心坐标）即重心坐标
+    struct SetupTriangle
+    {
+        float a[3], b[3], c[3];
+        float z[3];       // 窗口深度，已加多边形偏移
+        float invW[3];
+        glm::vec3 bary[3]; // 各顶点在原三角形中的重心坐标（近平面裁剪会产生新顶点）
+        float minZ;
+        int minX, minY, maxX, maxY;
+        uint32_t triangle;
+    };
+
+    struct ClipVertex
+    {
+        glm::vec4 position;
+        glm::vec3 bary;
+    };
+
+    // 深度缓冲与分层深度；行距补齐到4的倍数，SIMD读写不会越过行尾
+    struct Target
+    {
+        int width = 0, height = 0, stride = 0;
+        int tilesX = 0, tilesY = 0;
+        int blocksX = 0, blocksY = 0;
+        std::vector<float> depth;
+        std::vector<float> hiz; // 每块的最大深度
+
+        void resize(int w, int h)
+        {
+            width = w;
+            height = h;
+            stride = (w + 3) & ~3;
+            tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+            tilesY = (h + TILE_SIZE - 1) / TILE_SIZE;
+            blocksX = (w + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            blocksY = (h + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            depth.assign(static_cast<size_t>(stride) * h, 1.0f);
+            hiz.assign(static_cast<size_t>(blocksX) * blocksY, 1.0f);
+        }
+
+        void clear()
+        {
+            std::fill(depth.begin(), depth.end(), 1.0f);
+            std::fill(hiz.begin(), hiz.end(), 1.0f);
+        }
+    };
+
+    // 一个建立任务的输出：三角形与每个屏幕分块中的三角形下标
+    struct Bin
+    {
+        std::vector<SetupTriangle> triangles;
+        std::vector<std::vector<uint32_t>> tiles;
+    };
+
+    WorkerPool workers;
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 viewPos = glm::vec3(0.0f);
+    glm::vec3 lightPos = glm::vec3(0.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f);
+
+    std::vector<Job> jobs;
+    std::vector<Material> materials;
+    std::vector<WorldVertex> vertices;
+    std::vector<Triangle> triangleList;
+    std::vector<glm::vec4> clipPositions;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    std::vector<Bin> bins;
+    std::map<std::string, std::unique_ptr<SoftwareImage>> textures; // 按完整路径缓存
+
+    Target screen;
+    std::vector<uint32_t> triangleIds;
+    std::vector<glm::vec2> barycentrics; // 原三角形中顶点1、2的权重
+    std::vector<uint32_t> color;
+
+    bool shadowsEnabled = false;
+    int cascadeCount = 0;
+    std::vector<Target> cascades;
+    std::vector<bool> cascadeValid;
+    bool cascadeRender[CascadedShadowMap::MAX_CASCADES] = {};
+    glm::mat4 lightSpaceMatrices[CascadedShadowMap::MAX_CASCADES];
+    float cascadeSplits[CascadedShadowMap::MAX_CASCADES] = {};
+
+    bool skyEnabled = false;
+    int skyRevision = -1;
+    SoftwareImage transmittanceLUT;
+    SoftwareImage skyViewLUT;
+    glm::vec3 sunDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+    float sunIntensity = 1.0f;
+    float viewHeight = 0.2f;
+    float exposure = 10.0f;
+
+    unsigned int presentTexture = 0;
+    unsigned int presentFBO = 0;
+    int presentWidth = 0, presentHeight = 0;
+
+    uint32_t addMaterial(const Material& material)
+    {
+        materials.push_back(material);
+        return static_cast<uint32_t>(materials.size()) - 1;
+    }
+
+    void addJob(const Mesh& mesh, const glm::mat4& world, const glm::mat3& normalMatrix, uint32_t material)
+    {
+        jobs.push_back(Job{&mesh, world, normalMatrix, material, vertexCount, triangleCount});
+        vertexCount += mesh.vertices.size();
+        triangleCount += mesh.indices.size() / 3;
+    }
+
+    // 网格的第一张漫反射纹理，与Mesh::Draw绑定到texture_diffuse1的是同一张
+    const SoftwareImage* diffuseTexture(const Model& model, const Mesh& mesh)
+    {
+        for (const Texture& t : mesh.textures)
+        {
+            if (t.type != "texture_diffuse")
+                continue;
+            std::string path = model.directory + '/' + t.path;
+            auto it = textures.find(path);
+            if (it == textures.end())
+            {
+                std::unique_ptr<SoftwareImage> image(new SoftwareImage());
+                if (!image->load(path))
+                    image.reset();
+                it = textures.emplace(path, std::move(image)).first;
+            }
+            return it->second.get();
+        }
+        return nullptr;
+    }
+
+    void transformVertices()
+    {
+        vertices.resize(vertexCount);
+        triangleList.resize(triangleCount);
+        workers.parallelFor(jobs.size(), [this](size_t j)
+        {
+            const Job& job = jobs[j];
+            const Mesh& mesh = *job.mesh;
+            for (size_t i = 0; i < mesh.vertices.size(); i++)
+            {
+                const Vertex& v = mesh.vertices[i];
+                WorldVertex& out = vertices[job.firstVertex + i];
+                out.position = glm::vec3(job.world * glm::vec4(v.Position, 1.0f));
+                out.normal = job.normalMatrix * v.Normal;
+                out.uv = v.TexCoords;
+            }
+            uint32_t base = static_cast<uint32_t>(job.firstVertex);
+            for (size_t t = 0; t < mesh.indices.size() / 3; t++)
+            {
+                Triangle& tri = triangleList[job.firstTriangle + t];
+                for (int k = 0; k < 3; k++)
+                    tri.v[k] = base + mesh.indices[t * 3 + k];
+                tri.material = job.material;
+            }
+        });
+    }
+
+    // 一个通道：裁剪空间变换、建立与装箱、分块光栅化；shadowPass只写深度并加多边形偏移
+    void rasterize(Target& target, const glm::mat4& viewProjection, bool shadowPass)
+    {
+        const size_t VERTEX_BATCH = 4096;
+        clipPositions.resize(vertices.size());
+        workers.parallelFor((vertices.size() + VERTEX_BATCH - 1) / VERTEX_BATCH,
+                            [this, &viewProjection, VERTEX_BATCH](size_t batch)
+        {
+            size_t end = std::min(vertices.size(), (batch + 1) * VERTEX_BATCH);
+            for (size_t i = batch * VERTEX_BATCH; i < end; i++)
+                clipPositions[i] = viewProjection * glm::vec4(vertices[i].position, 1.0f);
+        });
+
+        size_t binCount = std::min(triangleList.size(), workers.size() * 4);
+        bins.resize(std::max<size_t>(binCount, 1));
+        size_t tileCount = static_cast<size_t>(target.tilesX) * target.tilesY;
+        workers.parallelFor(binCount, [this, &target, binCount, tileCount, shadowPass](size_t b)
+        {
+            Bin& bin = bins[b];
+            bin.triangles.clear();
+            bin.tiles.resize(tileCount);
+            for (std::vector<uint32_t>& tile : bin.tiles)
+                tile.clear();
+            size_t first = triangleList.size() * b / binCount, last = triangleList.size() * (b + 1) / binCount;
+            for (size_t t = first; t < last; t++)
+                setupTriangle(bin, target, static_cast<uint32_t>(t), shadowPass);
+        });
+
+        workers.parallelFor(tileCount, [this, &target, binCount, shadowPass](size_t tile)
+        {
+            rasterTile(target, static_cast<int>(tile), binCount, shadowPass);
+        });
+    }
+
+    void setupTriangle(Bin& bin, const Target& target, uint32_t index, bool shadowPass) const
+    {
+        const Triangle& tri = triangleList[index];
+        if (shadowPass && materials[tri.material].unlit)
+            return;
+
+        ClipVertex in[3];
+        for (int k = 0; k < 3; k++)
+        {
+            in[k].position = clipPositions[tri.v[k]];
+            in[k].bary = glm::vec3(k == 0, k == 1, k == 2);
+        }
+        // 全部顶点在同一裁剪平面外侧时丢弃
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bool allAbove = true, allBelow = true;
+            for (int k = 0; k < 3; k++)
+            {
+                allAbove = allAbove && in[k].position[axis] > in[k].position.w;
+                allBelow = allBelow && in[k].position[axis] < -in[k].position.w;
+            }
+            if (allAbove || allBelow)
+                return;
+        }
+
+        // 只对近平面（z >= -w）裁剪，其余平面由包围盒截取与深度测试处理
+        ClipVertex polygon[4];
+        int count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            const ClipVertex& a = in[k];
+            const ClipVertex& b = in[(k + 1) % 3];
+            float da = a.position.z + a.position.w, db = b.position.z + b.position.w;
+            if (da >= 0.0f)
+                polygon[count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t = da / (da - db);
+                polygon[count].position = glm::mix(a.position, b.position, t);
+                polygon[count].bary = glm::mix(a.bary, b.bary, t);
+                count++;
+            }
+        }
+        for (int k = 1; k + 1 < count; k++)
+            emitTriangle(bin, target, index, polygon[0], polygon[k], polygon[k + 1], shadowPass);
+    }
+
+    void emitTriangle(Bin& bin, const Target& target, uint32_t index, const ClipVertex& v0, const ClipVertex& v1,
+                      const ClipVertex& v2, bool shadowPass) const
+    {
+        const ClipVertex* v[3] = {&v0, &v1, &v2};
+        SetupTriangle s;
+        float x[3], y[3];
+        for (int k = 0; k < 3; k++)
+        {
+            s.invW[k] = 1.0f / v[k]->position.w;
+            x[k] = (v[k]->position.x * s.invW[k] * 0.5f + 0.5f) * target.width;
+            y[k] = (v[k]->position.y * s.invW[k] * 0.5f + 0.5f) * target.height;
+            s.z[k] = v[k]->position.z * s.invW[k] * 0.5f + 0.5f;
+            s.bary[k] = v[k]->bary;
+        }
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area == 0.0f || !std::isfinite(area))
+            return;
+        float invArea = 1.0f / area;
+        for (int i = 0; i < 3; i++)
+        {
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            s.a[i] = (y[j] - y[k]) * invArea;
+            s.b[i] = (x[k] - x[j]) * invArea;
+            s.c[i] = (x[j] * y[k] - x[k] * y[j]) * invArea;
+        }
+
+        if (shadowPass)
+        {
+            // glPolygonOffset：factor * 最大深度斜率 + units * 24位深度的最小分辨率
+            float dzdx = s.a[0] * s.z[0] + s.a[1] * s.z[1] + s.a[2] * s.z[2];
+            float dzdy = s.b[0] * s.z[0] + s.b[1] * s.z[1] + s.b[2] * s.z[2];
+            float offset = polygonOffsetFactor * std::max(std::fabs(dzdx), std::fabs(dzdy))
+                + polygonOffsetUnits / 16777216.0f;
+            for (float& z : s.z)
+                z += offset;
+        }
+        s.minZ = std::min(s.z[0], std::min(s.z[1], s.z[2]));
+
+        // 覆盖的像素中心范围
+        float minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+        float minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+        s.minX = static_cast<int>(std::ceil(std::max(minX - 0.5f, 0.0f)));
+        s.minY = static_cast<int>(std::ceil(std::max(minY - 0.5f, 0.0f)));
+        s.maxX = static_cast<int>(std::floor(std::min(maxX - 0.5f, target.width - 1.0f)));
+        s.maxY = static_cast<int>(std::floor(std::min(maxY - 0.5f, target.height - 1.0f)));
+        if (s.minX > s.maxX || s.minY > s.maxY)
+            return;
+        s.triangle = index;
+
+        uint32_t local = static_cast<uint32_t>(bin.triangles.size());
+        bin.triangles.push_back(s);
+        for (int ty = s.minY / TILE_SIZE; ty <= s.maxY / TILE_SIZE; ty++)
+            for (int tx = s.minX / TILE_SIZE; tx <= s.maxX / TILE_SIZE; tx++)
+                bin.tiles[static_cast<size_t>(ty) * target.tilesX + tx].push_back(local);
+    }
+
+    void rasterTile(Target& target, int tile, size_t binCount, bool shadowPass)
+    {
+        int x0 = (tile % target.tilesX) * TILE_SIZE, y0 = (tile / target.tilesX) * TILE_SIZE;
+        int x1 = std::min(x0 + TILE_SIZE, target.width) - 1, y1 = std::min(y0 + TILE_SIZE, target.height) - 1;
+        // 按提交顺序遍历，深度相等时先绘制的保留，与GL_LESS一致
+        for (size_t b = 0; b < binCount; b++)
+        {
+            const Bin& bin = bins[b];
+            for (uint32_t local : bin.tiles[tile])
+            {
+                const SetupTriangle& s = bin.triangles[local];
+                int rx0 = std::max(s.minX, x0), ry0 = std::max(s.minY, y0);
+                int rx1 = std::min(s.maxX, x1), ry1 = std::min(s.maxY, y1);
+                for (int by = ry0 / BLOCK_SIZE * BLOCK_SIZE; by <= ry1; by += BLOCK_SIZE)
+                {
+                    for (int bx = rx0 / BLOCK_SIZE * BLOCK_SIZE; bx <= rx1; bx += BLOCK_SIZE)
+                    {
+                        float& blockMax = target.hiz[static_cast<size_t>(by / BLOCK_SIZE) * target.blocksX
+                            + bx / BLOCK_SIZE];
+                        if (s.minZ >= blockMax)
+                            continue; // 整块都比三角形近
+                        int cx0 = std::max(bx, rx0), cy0 = std::max(by, ry0);
+                        int cx1 = std::min(bx + BLOCK_SIZE - 1, rx1), cy1 = std::min(by + BLOCK_SIZE - 1, ry1);
+                        if (outsideEdge(s, cx0, cy0, cx1, cy1))
+                            continue;
+                        if (rasterBlock(target, s, cx0, cy0, cx1, cy1, shadowPass))
+                            blockMax = blockDepth(target, bx, by);
+                    }
+                }
+            }
+        }
+    }
+
+    // 块的四个角都在某条边外侧时整块不覆盖
+    static bool outsideEdge(const SetupTriangle& s, int x0, int y0, int x1, int y1)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            float x = (s.a[i] > 0.0f ? x1 : x0) + 0.5f;
+            float y = (s.b[i] > 0.0f ? y1 : y0) + 0.5f;
+            if (s.a[i] * x + s.b[i] * y + s.c[i] < 0.0f)
+                return true;
+        }
+        return false;
+    }
+
+    static float blockDepth(const Target& target, int bx, int by)
+    {
+        float result = 0.0f;
+        int x1 = std::min(bx + BLOCK_SIZE, target.width), y1 = std::min(by + BLOCK_SIZE, target.height);
+        for (int y = by; y < y1; y++)
+        {
+            const float* row = &target.depth[static_cast<size_t>(y) * target.stride];
+            for (int x = bx; x < x1; x++)
+                result = std::max(result, row[x]);
+        }
+        return result;
+    }
+
+    // 光栅化块内[x0, x1] x [y0, y1]，返回是否写入了深度
+    bool rasterBlock(Target& target, const SetupTriangle& s, int x0, int y0, int x1, int y1, bool shadowPass)
+    {
+        bool wrote = false;
+#ifdef SOFTRASTER_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 first = _mm_set1_ps(x0 + 0.5f), last = _mm_set1_ps(x1 + 0.5f);
+        const __m128 a0 = _mm_set1_ps(s.a[0]), a1 = _mm_set1_ps(s.a[1]), a2 = _mm_set1_ps(s.a[2]);
+        const __m128 z0 = _mm_set1_ps(s.z[0]), z1 = _mm_set1_ps(s.z[1]), z2 = _mm_set1_ps(s.z[2]);
+        for (int y = y0; y <= y1; y++)
+        {
+            float* depthRow = &target.depth[static_cast<size_t>(y) * target.stride];
+            float yc = y + 0.5f;
+            __m128 r0 = _mm_set1_ps(s.b[0] * yc + s.c[0]);
+            __m128 r1 = _mm_set1_ps(s.b[1] * yc + s.c[1]);
+            __m128 r2 = _mm_set1_ps(s.b[2] * yc + s.c[2]);
+            // 从4对齐的位置开始，行距是4的倍数，读写不会越界
+            for (int x = x0 & ~3; x <= x1; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lanes);
+                __m128 l0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+                __m128 l1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+                __m128 l2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+                __m128 mask = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmple_ps(px, last));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(l0, zero));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(l1, zero));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(l2, zero));
+                if (_mm_movemask_ps(mask) == 0)
+                    continue;
+                __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, z0), _mm_mul_ps(l1, z1)), _mm_mul_ps(l2, z2));
+                __m128 stored = _mm_loadu_ps(depthRow + x);
+                mask = _mm_and_ps(mask, _mm_cmplt_ps(z, stored));
+                int bits = _mm_movemask_ps(mask);
+                if (bits == 0)
+                    continue;
+                _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, stored)));
+                wrote = true;
+                if (shadowPass)
+                    continue;
+                float w0[4], w1[4], w2[4];
+                _mm_storeu_ps(w0, l0);
+                _mm_storeu_ps(w1, l1);
+                _mm_storeu_ps(w2, l2);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (bits & (1 << lane))
+                        writeVisibility(s, static_cast<size_t>(y) * target.stride + x + lane, w0[lane], w1[lane],
+                                        w2[lane]);
+                }
+            }
+        }
+#else
+        for (int y = y0; y <= y1; y++)
+        {
+            float* depthRow = &target.depth[static_cast<size_t>(y) * target.stride];
+            float yc = y + 0.5f;
+            for (int x = x0; x <= x1; x++)
+            {
+                float xc = x + 0.5f;
+                float l0 = s.a[0] * xc + s.b[0] * yc + s.c[0];
+                float l1 = s.a[1] * xc + s.b[1] * yc + s.c[1];
+                float l2 = s.a[2] * xc + s.b[2] * yc + s.c[2];
+                if (l0 < 0.0f || l1 < 0.0f || l2 < 0.0f)
+                    continue;
+                float z = l0 * s.z[0] + l1 * s.z[1] + l2 * s.z[2];
+                if (!(z < depthRow[x]))
+                    continue;
+                depthRow[x] = z;
+                wrote = true;
+                if (!shadowPass)
+                    writeVisibility(s, static_cast<size_t>(y) * target.stride + x, l0, l1, l2);
+            }
+        }
+#endif
+        return wrote;
+    }
+
+    // 屏幕空间重心坐标按1/w校正后换算回原三角形
+    void writeVisibility(const SetupTriangle& s, size_t pixel, float l0, float l1, float l2)
+    {
+        float w0 = l0 * s.invW[0], w1 = l1 * s.invW[1], w2 = l2 * s.invW[2];
+        float inv = 1.0f / (w0 + w1 + w2);
+        glm::vec3 b = (s.bary[0] * w0 + s.bary[1] * w1 + s.bary[2] * w2) * inv;
+        triangleIds[pixel] = s.triangle;
+        barycentrics[pixel] = glm::vec2(b.y, b.z);
+    }
+
+    void shade()
+    {
+        glm::mat4 viewProjection = projection * view;
+        glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+        workers.parallelFor(static_cast<size_t>(screen.height), [this, &viewProjection, &inverseViewProjection](size_t y)
+        {
+            for (int x = 0; x < screen.width; x++)
+            {
+                size_t pixel = y * screen.stride + x;
+                glm::vec3 result = clearColor;
+                uint32_t id = triangleIds[pixel];
+                if (id != NO_TRIANGLE)
+                    result = shadeFragment(id, barycentrics[pixel]);
+                if (skyEnabled)
+                {
+                    glm::vec2 ndc((x + 0.5f) / screen.width * 2.0f - 1.0f,
+                                  (y + 0.5f) / screen.height * 2.0f - 1.0f);
+                    glm::vec3 direction;
+                    if (skyVisible(ndc, screen.depth[pixel], viewProjection, inverseViewProjection, direction))
+                        result = shadeSky(direction);
+                }
+                color[pixel] = pack(result);
+            }
+        });
+    }
+
+    static uint32_t pack(const glm::vec3& c)
+    {
+        glm::vec3 v = glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return static_cast<uint32_t>(v.r) | static_cast<uint32_t>(v.g) << 8 | static_cast<uint32_t>(v.b) << 16
+            | 0xFF000000u;
+    }
+
+    // model-frag.glsl的Phong光照与阴影
+    glm::vec3 shadeFragment(uint32_t id, const glm::vec2& weights) const
+    {
+        const Triangle& tri = triangleList[id];
+        const Material& material = materials[tri.material];
+        if (material.unlit)
+            return glm::vec3(material.color);
+
+        const WorldVertex& v0 = vertices[tri.v[0]];
+        const WorldVertex& v1 = vertices[tri.v[1]];
+        const WorldVertex& v2 = vertices[tri.v[2]];
+        float w0 = 1.0f - weights.x - weights.y;
+        glm::vec3 fragPos = v0.position * w0 + v1.position * weights.x + v2.position * weights.y;
+        glm::vec3 normal = v0.normal * w0 + v1.normal * weights.x + v2.normal * weights.y;
+        glm::vec2 uv = v0.uv * w0 + v1.uv * weights.x + v2.uv * weights.y;
+
+        glm::vec4 texColor = material.texture ? material.texture->sample(uv) : glm::vec4(1.0f);
+        glm::vec3 norm = glm::normalize(normal);
+        glm::vec3 lightDir = glm::normalize(lightPos - fragPos);
+        glm::vec3 ambient = 0.1f * objectColor;
+        float diff = std::max(glm::dot(norm, lightDir), 0.0f);
+        glm::vec3 viewDir = glm::normalize(viewPos - fragPos);
+        glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+        float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 32.0f);
+        float shadow = shadowsEnabled ? shadowFactor(fragPos, norm, lightDir) : 0.0f;
+        glm::vec3 result = ambient + (1.0f - shadow) * (diff + spec) * lightColor;
+        return result * glm::vec3(texColor);
+    }
+
+    float shadowFactor(const glm::vec3& fragPos, const glm::vec3& norm, const glm::vec3& lightDir) const
+    {
+        float viewDepth = -(view * glm::vec4(fragPos, 1.0f)).z;
+        int layer = cascadeCount;
+        for (int i = 0; i < cascadeCount; i++)
+        {
+            if (viewDepth < cascadeSplits[i])
+            {
+                layer = i;
+                break;
+            }
+        }
+        for (; layer < cascadeCount; layer++)
+        {
+            glm::vec4 lightSpace = lightSpaceMatrices[layer] * glm::vec4(fragPos, 1.0f);
+            glm::vec3 proj = glm::vec3(lightSpace) / lightSpace.w * 0.5f + 0.5f;
+            if (proj.x < 0.0f || proj.y < 0.0f || proj.z < 0.0f || proj.x > 1.0f || proj.y > 1.0f || proj.z > 1.0f)
+                continue;
+
+            float bias = std::max(0.0015f * (1.0f - glm::dot(norm, lightDir)), 0.0003f) * (layer + 1);
+            const Target& map = cascades[layer];
+            float texel = 1.0f / map.width;
+            float lit = 0.0f;
+            for (int x = -1; x <= 1; x++)
+                for (int y = -1; y <= 1; y++)
+                    lit += compareBilinear(map, proj.x + x * texel, proj.y + y * texel, proj.z - bias);
+            return 1.0f - lit / 9.0f;
+        }
+        return 0.0f;
+    }
+
+    // 对应GL_LINEAR + GL_COMPARE_REF_TO_TEXTURE（GL_LEQUAL）：2x2纹素分别比较再双线性混合，边框深度为1
+    static float compareBilinear(const Target& map, float u, float v, float reference)
+    {
+        float x = u * map.width - 0.5f, y = v * map.height - 0.5f;
+        float fx = std::floor(x), fy = std::floor(y);
+        int x0 = static_cast<int>(fx), y0 = static_cast<int>(fy);
+        float tx = x - fx, ty = y - fy;
+        auto lit = [&map, reference](int sx, int sy)
+        {
+            if (sx < 0 || sy < 0 || sx >= map.width || sy >= map.height)
+                return reference <= 1.0f ? 1.0f : 0.0f;
+            return reference <= map.depth[static_cast<size_t>(sy) * map.stride + sx] ? 1.0f : 0.0f;
+        };
+        float bottom = lit(x0, y0) * (1.0f - tx) + lit(x0 + 1, y0) * tx;
+        float top = lit(x0, y0 + 1) * (1.0f - tx) + lit(x0 + 1, y0 + 1) * tx;
+        return bottom * (1.0f - ty) + top * ty;
+    }
+
+    // 天空盒是以原点为中心、边长60的立方体，用GL_LEQUAL画在最后；
+    // 求视线与立方体的交点及其深度，不大于已有深度时天空可见，direction为交点方向
+    bool skyVisible(const glm::vec2& ndc, float depth, const glm::mat4& viewProjection,
+                    const glm::mat4& inverseViewProjection, glm::vec3& direction) const
+    {
+        glm::vec4 far = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+        glm::vec3 ray = glm::normalize(glm::vec3(far) / far.w - viewPos);
+        float tNear = -1e30f, tFar = 1e30f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (ray[axis] == 0.0f)
+            {
+                if (std::fabs(viewPos[axis]) > 30.0f)
+                    return false;
+                continue;
+            }
+            float t0 = (-30.0f - viewPos[axis]) / ray[axis], t1 = (30.0f - viewPos[axis]) / ray[axis];
+            tNear = std::max(tNear, std::min(t0, t1));
+            tFar = std::min(tFar, std::max(t0, t1));
+        }
+        if (tNear > tFar || tFar <= 0.0f)
+            return false;
+        glm::vec3 hit = viewPos + ray * (tNear > 0.0f ? tNear : tFar);
+        glm::vec4 clip = viewProjection * glm::vec4(hit, 1.0f);
+        if (clip.w <= 0.0f || clip.z < -clip.w || clip.z > clip.w)
+            return false;
+        if (clip.z / clip.w * 0.5f + 0.5f > depth)
+            return false;
+        direction = hit;
+        return true;
+    }
+
+    // skybox-frag.glsl
+    glm::vec3 shadeSky(const glm::vec3& position) const
+    {
+        const float PI = 3.14159265359f;
+        glm::vec3 dir = glm::normalize(position);
+        float elevation = std::asin(glm::clamp(dir.y, -1.0f, 1.0f));
+        float azimuth = std::atan2(dir.z, dir.x) - std::atan2(sunDirection.z, sunDirection.x);
+        float l = std::sqrt(std::fabs(elevation) / (0.5f * PI));
+        float u = azimuth / (2.0f * PI);
+        float sign = elevation > 0.0f ? 1.0f : (elevation < 0.0f ? -1.0f : 0.0f);
+        glm::vec2 lutUV(u - std::floor(u), 0.5f + 0.5f * sign * l);
+        glm::vec3 radiance = glm::vec3(skyViewLUT.sample(lutUV, true, false)) * sunIntensity;
+        if (glm::dot(dir, sunDirection) > 0.99996f)
+        {
+            glm::vec2 transmittanceUV(dir.y * 0.5f + 0.5f, viewHeight / (6460.0f - 6360.0f));
+            radiance += glm::vec3(transmittanceLUT.sample(transmittanceUV, false, false)) * sunIntensity * 20.0f;
+        }
+        return glm::vec3(1.0f) - glm::exp(-radiance * exposure);
+    }
+};
+
+#endif
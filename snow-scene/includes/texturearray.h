@@ -0,0 +1,278 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include <glad/glad.h>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <vector>
+
+// 材质纹理数组
+// 尺寸相同的漫反射纹理（流式加载后统一为RGBA8、完整mip链）放进同一张GL_TEXTURE_2D_ARRAY"页"的不同层，
+// 网格只记录材质编号，绘制时解析为(页, 层)：页绑定到固定纹理单元，层号与已上传的最细mip级作为uniform传入。
+// 连续绘制同一页上的网格不再重新绑定纹理，为跨网格、跨模型的合批与实例化提交做准备。
+// 每页的层数按单层大小决定（每页约PAGE_BYTES，至少1层，至多MAX_LAYERS层）；页满后新开一页，
+// 页上的层全部释放后删除该页。材质在解码完成、尺寸已知之前没有页，绘制时使用1x1灰色占位页。
+// 内存账本中每层记在create()时OwnerScope所指的资源（请求纹理的模型）名下，模型释放材质时注销，
+// 驻留管理据此把数组中的纹理计入模型的GPU占用；页本身只以空闲层的字节数记在"texture arrays"名下。
+// 流式上传期间各层的有效mip级不同，不能用页的GL_TEXTURE_BASE_LEVEL限制，
+// 由着色器按materialBaseLevel钳制采样的LOD（见 model-frag.glsl 的 SampleMaterial）。
+// 只能在GL线程调用。
+class TextureArrayPool
+{
+public:
+    static constexpr int TEXTURE_UNIT = 7;
+    static constexpr int MAX_LAYERS = 16;
+    static constexpr size_t PAGE_BYTES = 32u << 20;
+
+    struct Material
+    {
+        int page = -1;     // -1表示尚未放入页（解码中或加载失败）
+        int layer = 0;
+        int baseLevel = 0; // 已完整上传的最细mip级
+        int owner = 0;     // 内存账本中的所属资源，create()时取自当前线程的OwnerScope
+        bool live = false;
+    };
+
+    static TextureArrayPool& instance()
+    {
+        static TextureArrayPool pool;
+        return pool;
+    }
+
+    TextureArrayPool(const TextureArrayPool&) = delete;
+    TextureArrayPool& operator=(const TextureArrayPool&) = delete;
+
+    // 分配材质编号，尺寸确定后再调用place
+    int create()
+    {
+        int material;
+        if (!freeMaterials.empty())
+        {
+            material = freeMaterials.back();
+            freeMaterials.pop_back();
+        }
+        else
+        {
+            material = static_cast<int>(materials.size());
+            materials.emplace_back();
+        }
+        materials[material] = Material();
+        materials[material].owner = memstats::currentOwner();
+        materials[material].live = true;
+        return material;
+    }
+
+    // 为材质在尺寸匹配的页中分配一层，levels为mip级数；返回页纹理
+    unsigned int place(int material, int width, int height, int levels)
+    {
+        int page = -1;
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            const Page& p = pages[i];
+            if (p.texture != 0 && p.width == width && p.height == height && p.levels == levels && !p.freeLayers.empty())
+            {
+                page = static_cast<int>(i);
+                break;
+            }
+        }
+        if (page < 0)
+            page = createPage(width, height, levels);
+
+        Page& p = pages[page];
+        Material& m = materials[material];
+        m.page = page;
+        m.layer = p.freeLayers.back();
+        m.baseLevel = levels - 1;
+        p.freeLayers.pop_back();
+        memstats::trackTexture(p.texture, MemoryCategory::Texture, p.layerBytes * p.freeLayers.size());
+        memstats::OwnerScope owner(m.owner);
+        memstats::trackTextureLayer(p.texture, m.layer, p.layerBytes);
+        return p.texture;
+    }
+
+    // 流式上传每完成一级调用
+    void setBaseLevel(int material, int level)
+    {
+        materials[material].baseLevel = level;
+    }
+
+    // 模型释放时调用；页上的层全部空闲后删除整页
+    void release(int material)
+    {
+        Material& m = materials[material];
+        if (!m.live)
+            return;
+        if (m.page >= 0)
+        {
+            Page& p = pages[m.page];
+            p.freeLayers.push_back(m.layer);
+            memstats::untrackTextureLayer(p.texture, m.layer);
+            memstats::trackTexture(p.texture, MemoryCategory::Texture, p.layerBytes * p.freeLayers.size());
+            if (static_cast<int>(p.freeLayers.size()) == p.capacity)
+            {
+                memstats::untrackTexture(p.texture);
+                if (boundPage == p.texture)
+                    boundPage = 0;
+                glDeleteTextures(1, &p.texture);
+                p = Page();
+            }
+        }
+        m = Material();
+        freeMaterials.push_back(material);
+    }
+
+    const Material& material(int id) const
+    {
+        return materials[id];
+    }
+
+    unsigned int pageTexture(int page) const
+    {
+        return pages[page].texture;
+    }
+
+    // 设置着色器的材质uniform，页与上一次绑定的相同时不再绑定；material为-1或尚未放入页时使用占位页
+    void bind(const Shader& shader, int material)
+    {
+        prepare();
+        unsigned int texture;
+        float layer, baseLevel;
+        resolve(material, texture, layer, baseLevel);
+        bindPage(texture);
+        shader.setInt("materialPages", TEXTURE_UNIT);
+        shader.setFloat("materialLayer", layer);
+        shader.setFloat("materialBaseLevel", baseLevel);
+    }
+
+    // 创建占位页；在工作线程上录制命令（resolve）之前，由GL线程调用一次
+    void prepare()
+    {
+        if (placeholder == 0)
+            createPlaceholder();
+    }
+
+    // 把材质解析为(页纹理, 层, 最细mip级)，不调用GL。
+    // 录制命令时在工作线程中调用，要求期间GL线程不修改纹理数组（流式上传在录制之前完成）
+    void resolve(int material, unsigned int& texture, float& layer, float& baseLevel) const
+    {
+        texture = placeholder;
+        layer = 0.0f;
+        baseLevel = 0.0f;
+        if (material >= 0 && materials[material].page >= 0)
+        {
+            const Material& m = materials[material];
+            texture = pages[m.page].texture;
+            layer = static_cast<float>(m.layer);
+            baseLevel = static_cast<float>(m.baseLevel);
+        }
+    }
+
+    // 把页绑定到TEXTURE_UNIT，与上一次绑定的相同时跳过
+    void bindPage(unsigned int texture)
+    {
+        if (texture != boundPage)
+        {
+            glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+            glActiveTexture(GL_TEXTURE0);
+            boundPage = texture;
+        }
+    }
+
+    size_t pageCount() const
+    {
+        size_t count = 0;
+        for (const Page& p : pages)
+            count += p.texture != 0 ? 1 : 0;
+        return count;
+    }
+
+private:
+    struct Page
+    {
+        unsigned int texture = 0;
+        int width = 0;
+        int height = 0;
+        int levels = 0;
+        int capacity = 0;
+        size_t layerBytes = 0;
+        std::vector<int> freeLayers; // 栈顶为编号最小的空闲层
+    };
+
+    std::vector<Material> materials;
+    std::vector<int> freeMaterials;
+    std::vector<Page> pages;
+    unsigned int placeholder = 0;
+    unsigned int boundPage = 0;
+
+    TextureArrayPool() = default;
+
+    int createPage(int width, int height, int levels)
+    {
+        size_t layerBytes = memstats::textureBytes(width, height, 1, 4, levels);
+        int capacity = static_cast<int>(std::min<size_t>(std::max<size_t>(PAGE_BYTES / layerBytes, 1), MAX_LAYERS));
+
+        int index = -1;
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            if (pages[i].texture == 0)
+            {
+                index = static_cast<int>(i);
+                break;
+            }
+        }
+        if (index < 0)
+        {
+            index = static_cast<int>(pages.size());
+            pages.emplace_back();
+        }
+
+        Page& p = pages[index];
+        p.width = width;
+        p.height = height;
+        p.levels = levels;
+        p.capacity = capacity;
+        p.layerBytes = layerBytes;
+        for (int layer = capacity - 1; layer >= 0; layer--)
+            p.freeLayers.push_back(layer);
+
+        glGenTextures(1, &p.texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, p.texture);
+        for (int level = 0; level < levels; level++)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(width >> level, 1),
+                         std::max(height >> level, 1), capacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        boundPage = 0;
+
+        // 页由多个模型共享，记在"texture arrays"名下；place()把分配出去的层转记到请求它的模型
+        memstats::OwnerScope owner("texture arrays");
+        memstats::trackTexture(p.texture, MemoryCategory::Texture, layerBytes * capacity);
+        return index;
+    }
+
+    void createPlaceholder()
+    {
+        unsigned char pixel[4] = {128, 128, 128, 255};
+        glGenTextures(1, &placeholder);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, placeholder);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        memstats::OwnerScope owner("texture arrays");
+        memstats::trackTexture(placeholder, MemoryCategory::Texture, 4);
+    }
+};
+
+#endif
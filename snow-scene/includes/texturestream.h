@@ -0,0 +1,397 @@
+#ifndef TEXTURESTREAM_H
+#define TEXTURESTREAM_H
+
+#include <glad/glad.h>
+
+#include "glstats.h"
+#include "memstats.h"
+#include "texturearray.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// 异步纹理流式加载
+// request()立即返回一个可绑定的纹理（1x1灰色占位），工作线程解码图片并在CPU上生成完整的mip链；
+// 渲染线程每帧调用update()，从最粗的mip开始按条带经PBO环上传，每传完一级就把GL_TEXTURE_BASE_LEVEL降到该级，
+// 纹理先以低分辨率出现，随后几帧逐步变清晰。每帧上传字节数受uploadBudget限制。
+// PBO环的每个槽位在提交glTexSubImage2D后插入fence，槽位只有在fence完成后才被复用，因此映射时可以使用
+// GL_MAP_UNSYNCHRONIZED_BIT而不会与GPU读取冲突；fence未完成时本帧直接停止上传，从不等待。
+// requestMaterial()请求的纹理不单独创建，解码后放入TextureArrayPool中同尺寸的页，逐级上传到对应层，
+// 每传完一级更新材质的baseLevel。
+class TextureStreamer
+{
+public:
+    static constexpr int RING_SIZE = 4;
+    static constexpr size_t SLOT_BYTES = 1 << 20; // 每个PBO槽位1MB，大的mip级按行拆成多个条带
+
+    size_t uploadBudget = 4 << 20; // 每帧最多上传的字节数
+
+    TextureStreamer(int workerCount = 2)
+    {
+        memstats::OwnerScope owner("texture streamer");
+        glGenBuffers(RING_SIZE, pbos);
+        for (int i = 0; i < RING_SIZE; i++)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, SLOT_BYTES, nullptr, GL_STREAM_DRAW);
+            memstats::trackBuffer(pbos[i], MemoryCategory::StreamBuffer, SLOT_BYTES);
+            fences[i] = nullptr;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        for (int i = 0; i < workerCount; i++)
+            workers.emplace_back(&TextureStreamer::workerLoop, this);
+    }
+
+    ~TextureStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+        // 与其他GL对象一样，PBO与fence随上下文一起销毁（析构时glfwTerminate可能已经调用）
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // 渲染线程调用：创建占位纹理并把解码任务交给工作线程
+    unsigned int request(const std::string& path)
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        unsigned char placeholder[4] = {128, 128, 128, 255};
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        memstats::trackTexture(texture, MemoryCategory::Texture, 4); // 归属于调用方的OwnerScope
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decodeQueue.push_back(DecodeRequest{texture, -1, path});
+            streaming.insert(texture);
+            outstanding++;
+        }
+        wake.notify_one();
+        return texture;
+    }
+
+    // 渲染线程调用：分配纹理数组材质，解码后再放入页中；返回材质编号
+    int requestMaterial(const std::string& path)
+    {
+        int material = TextureArrayPool::instance().create();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decodeQueue.push_back(DecodeRequest{0, material, path});
+            streamingMaterials.insert(material);
+            outstanding++;
+        }
+        wake.notify_one();
+        return material;
+    }
+
+    // 渲染线程每帧调用
+    void update()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::shared_ptr<DecodedImage>& image : decoded)
+                beginUpload(image);
+            decoded.clear();
+        }
+
+        lastFrameBytes = 0;
+        while (!uploads.empty() && lastFrameBytes < uploadBudget)
+        {
+            if (!uploadBand(uploads.front()))
+                break; // 没有可用的PBO槽位
+            if (uploads.front().level < 0)
+            {
+                std::shared_ptr<DecodedImage> image = uploads.front().image;
+                uploads.pop_front();
+                std::lock_guard<std::mutex> lock(mutex);
+                finish(*image);
+            }
+        }
+    }
+
+    // 仍在解码或上传中的纹理数
+    size_t pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return outstanding;
+    }
+
+    // 纹理仍在解码或上传时不能删除，否则后续上传会写入已删除的名字
+    bool isStreaming(unsigned int texture)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return streaming.count(texture) != 0;
+    }
+
+    bool isStreamingMaterial(int material)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return streamingMaterials.count(material) != 0;
+    }
+
+    size_t bytesUploadedLastFrame() const
+    {
+        return lastFrameBytes;
+    }
+
+private:
+    struct DecodeRequest
+    {
+        unsigned int texture;
+        int material; // >=0时上传到纹理数组，texture不使用
+        std::string path;
+    };
+
+    struct DecodedImage
+    {
+        unsigned int texture;
+        int material;
+        std::vector<int> widths;
+        std::vector<int> heights;
+        std::vector<std::vector<unsigned char>> levels; // RGBA8，levels[0]为原始分辨率
+    };
+
+    struct Upload
+    {
+        std::shared_ptr<DecodedImage> image;
+        int level; // 正在上传的mip级，从最粗一级递减到0，-1表示完成
+        int row; // 该级已上传的行数
+    };
+
+    unsigned int pbos[RING_SIZE];
+    GLsync fences[RING_SIZE];
+    int nextSlot = 0;
+    std::deque<Upload> uploads;
+    size_t lastFrameBytes = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<DecodeRequest> decodeQueue;
+    std::vector<std::shared_ptr<DecodedImage>> decoded;
+    size_t outstanding = 0;
+    std::unordered_set<unsigned int> streaming;
+    std::unordered_set<int> streamingMaterials;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            DecodeRequest request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !decodeQueue.empty(); });
+                if (stopping)
+                    return;
+                request = std::move(decodeQueue.front());
+                decodeQueue.pop_front();
+            }
+
+            std::shared_ptr<DecodedImage> image = decode(request);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (image)
+            {
+                decoded.push_back(std::move(image));
+            }
+            else
+            {
+                // 解码失败：普通纹理保留灰色占位，材质保持未放入页（绘制时用占位页）
+                DecodedImage failed;
+                failed.texture = request.texture;
+                failed.material = request.material;
+                finish(failed);
+            }
+        }
+    }
+
+    static std::shared_ptr<DecodedImage> decode(const DecodeRequest& request)
+    {
+        int width, height, nrComponents;
+        unsigned char* data = stbi_load(request.path.c_str(), &width, &height, &nrComponents, 4);
+        if (!data)
+        {
+            std::cout << "Texture failed to load at path: " << request.path << std::endl;
+            return nullptr;
+        }
+
+        auto image = std::make_shared<DecodedImage>();
+        image->texture = request.texture;
+        image->material = request.material;
+        image->widths.push_back(width);
+        image->heights.push_back(height);
+        image->levels.emplace_back(data, data + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(data);
+
+        // 2x2盒式滤波生成mip链，奇数边长时最后一行/列被重复采样
+        while (width > 1 || height > 1)
+        {
+            int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+            const std::vector<unsigned char>& src = image->levels.back();
+            std::vector<unsigned char> dst(static_cast<size_t>(w) * h * 4);
+            for (int y = 0; y < h; y++)
+            {
+                int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                for (int x = 0; x < w; x++)
+                {
+                    int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                    for (int c = 0; c < 4; c++)
+                    {
+                        int sum = src[(static_cast<size_t>(y0) * width + x0) * 4 + c] +
+                            src[(static_cast<size_t>(y0) * width + x1) * 4 + c] +
+                            src[(static_cast<size_t>(y1) * width + x0) * 4 + c] +
+                            src[(static_cast<size_t>(y1) * width + x1) * 4 + c];
+                        dst[(static_cast<size_t>(y) * w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+            image->levels.push_back(std::move(dst));
+            image->widths.push_back(w);
+            image->heights.push_back(h);
+            width = w;
+            height = h;
+        }
+        return image;
+    }
+
+    // 调用方已持有锁
+    void finish(const DecodedImage& image)
+    {
+        if (image.material >= 0)
+            streamingMaterials.erase(image.material);
+        else
+            streaming.erase(image.texture);
+        outstanding--;
+    }
+
+    // 分配全部mip级的存储，采样范围先限制在最粗一级
+    void beginUpload(const std::shared_ptr<DecodedImage>& image)
+    {
+        int levelCount = static_cast<int>(image->levels.size());
+        if (image->material >= 0)
+        {
+            // 纹理数组的页已分配全部mip级，直接写入最粗一级
+            TextureArrayPool& pool = TextureArrayPool::instance();
+            unsigned int page = pool.place(image->material, image->widths[0], image->heights[0], levelCount);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, page);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, levelCount - 1, 0, 0, pool.material(image->material).layer, 1, 1, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, image->levels.back().data());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            uploads.push_back(Upload{image, levelCount - 2, 0});
+            return;
+        }
+        glBindTexture(GL_TEXTURE_2D, image->texture);
+        size_t bytes = 0;
+        for (int level = 0; level < levelCount; level++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, image->widths[level], image->heights[level], 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+            bytes += image->levels[level].size();
+        }
+        memstats::trackTexture(image->texture, MemoryCategory::Texture, bytes);
+        // 最粗一级只有1x1（整张图的平均色），直接写入，纹理立刻可以显示
+        glTexSubImage2D(GL_TEXTURE_2D, levelCount - 1, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        image->levels.back().data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // 1x1的最粗一级已经写入，从次粗一级开始流式上传
+        uploads.push_back(Upload{image, levelCount - 2, 0});
+    }
+
+    // 上传一个条带，返回false表示PBO环已满
+    bool uploadBand(Upload& upload)
+    {
+        if (upload.level < 0)
+            return true;
+
+        GLsync& fence = fences[nextSlot];
+        if (fence != nullptr)
+        {
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                return false;
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        const DecodedImage& image = *upload.image;
+        int width = image.widths[upload.level], height = image.heights[upload.level];
+        size_t rowBytes = static_cast<size_t>(width) * 4;
+        int rows = static_cast<int>(std::min<size_t>(SLOT_BYTES / rowBytes, height - upload.row));
+        rows = std::max(rows, 1);
+        size_t bytes = rowBytes * rows;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextSlot]);
+        void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (staging == nullptr)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return false;
+        }
+        std::memcpy(staging, image.levels[upload.level].data() + rowBytes * upload.row, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        TextureArrayPool& pool = TextureArrayPool::instance();
+        GLenum target = image.material >= 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        if (image.material >= 0)
+        {
+            const TextureArrayPool::Material& m = pool.material(image.material);
+            glBindTexture(target, pool.pageTexture(m.page));
+            glTexSubImage3D(target, upload.level, 0, upload.row, m.layer, width, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                            nullptr);
+        }
+        else
+        {
+            glBindTexture(target, image.texture);
+            glTexSubImage2D(target, upload.level, 0, upload.row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextSlot = (nextSlot + 1) % RING_SIZE;
+        lastFrameBytes += bytes;
+
+        upload.row += rows;
+        if (upload.row >= height)
+        {
+            // 整级上传完成后才让采样使用它
+            if (image.material >= 0)
+                pool.setBaseLevel(image.material, upload.level);
+            else
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.level);
+            upload.level--;
+            upload.row = 0;
+        }
+        glBindTexture(target, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef WINDFIELD_H
+#define WINDFIELD_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// 风场质量：网格边长，决定内存占用（每格4字节）
+enum class WindQuality
+{
+    Low = 16,    // 16 KB
+    Medium = 32, // 128 KB
+    High = 64    // 1 MB
+};
+
+// 预计算的三维风场
+// 构造时把可平铺的旋度噪声（无散度，粒子不会聚成团）烘焙进周期网格，按int8量化存储。
+// 运行时网格沿风向平移，再叠加随时间变化的整体阵风；采样只是一次周期三线性插值，与噪声复杂度无关。
+// 雪花在模拟线程上积分，风场只在CPU上采样。
+class WindField
+{
+public:
+    int resolution;
+    float tileSize; // 网格覆盖的世界尺寸，超出部分周期重复
+    float turbulence = 1.2f; // 旋度噪声的速度幅度
+    glm::vec3 baseWind = glm::vec3(0.6f, 0.0f, 0.2f); // 平均风，同时决定网格的平移方向
+    float gustStrength = 0.8f; // 阵风相对平均风的最大增幅
+
+    WindField(WindQuality quality = WindQuality::Medium, float tileSize = 16.0f, uint32_t seed = 1)
+        : resolution(static_cast<int>(quality)),
+          tileSize(tileSize),
+          cells(static_cast<size_t>(resolution) * resolution * resolution)
+    {
+        bake(seed);
+    }
+
+    WindField(const WindField&) = delete;
+    WindField& operator=(const WindField&) = delete;
+
+    size_t footprintBytes() const
+    {
+        return cells.size() * sizeof(Cell);
+    }
+
+    // 模拟线程每步调用，推进网格平移与阵风
+    void advance(float deltaTime)
+    {
+        // 用double累计，长时间运行后平移与阵风的相位仍然精确
+        double t = time.load(std::memory_order_relaxed) + deltaTime;
+        time.store(t, std::memory_order_relaxed);
+        gustFactor.store(1.0f + gustStrength * gust(t), std::memory_order_relaxed);
+    }
+
+    // 世界坐标处的风速
+    glm::vec3 sample(const glm::vec3& position) const
+    {
+        glm::vec3 g = (position - scrollOffset()) * (resolution / tileSize);
+        glm::vec3 base = glm::floor(g);
+        glm::vec3 f = g - base;
+        int x0 = wrap(static_cast<int>(base.x)), y0 = wrap(static_cast<int>(base.y)), z0 = wrap(static_cast<int>(base.z));
+        int x1 = wrap(x0 + 1), y1 = wrap(y0 + 1), z1 = wrap(z0 + 1);
+
+        glm::vec3 c00 = glm::mix(decode(x0, y0, z0), decode(x1, y0, z0), f.x);
+        glm::vec3 c10 = glm::mix(decode(x0, y1, z0), decode(x1, y1, z0), f.x);
+        glm::vec3 c01 = glm::mix(decode(x0, y0, z1), decode(x1, y0, z1), f.x);
+        glm::vec3 c11 = glm::mix(decode(x0, y1, z1), decode(x1, y1, z1), f.x);
+        glm::vec3 turbulent = glm::mix(glm::mix(c00, c10, f.y), glm::mix(c01, c11, f.y), f.z);
+        return baseWind * gustFactor.load(std::memory_order_relaxed) + turbulent * (turbulence * scale);
+    }
+
+private:
+    // 量化后的单格风速，w仅用于4字节对齐
+    struct Cell
+    {
+        int8_t x, y, z, w;
+    };
+
+    static constexpr int NOISE_PERIOD = 4; // 每个周期内的噪声晶格数
+    static constexpr int OCTAVES = 2;
+
+    std::vector<Cell> cells;
+    float scale = 1.0f; // int8到归一化速度的缩放
+    std::atomic<double> time{0.0};
+    std::atomic<float> gustFactor{1.0f};
+
+    int wrap(int i) const
+    {
+        i %= resolution;
+        return i < 0 ? i + resolution : i;
+    }
+
+    // 平移量在double中对网格周期取模后再转为float
+    glm::vec3 scrollOffset() const
+    {
+        double t = time.load(std::memory_order_relaxed);
+        return glm::vec3(wrapOffset(baseWind.x * t), wrapOffset(baseWind.y * t), wrapOffset(baseWind.z * t));
+    }
+
+    float wrapOffset(double offset) const
+    {
+        return static_cast<float>(offset - std::floor(offset / tileSize) * tileSize);
+    }
+
+    glm::vec3 decode(int x, int y, int z) const
+    {
+        const Cell& c = cells[(static_cast<size_t>(z) * resolution + y) * resolution + x];
+        return glm::vec3(c.x, c.y, c.z);
+    }
+
+    // 几个不可公约频率的正弦叠加，归一化到[-1, 1]
+    static float gust(double t)
+    {
+        return static_cast<float>((std::sin(t * 0.31) + 0.6 * std::sin(t * 0.87 + 1.3) + 0.3 * std::sin(t * 2.3 + 0.4)) / 1.9);
+    }
+
+    static uint32_t hash(uint32_t x, uint32_t y, uint32_t z, uint32_t seed)
+    {
+        uint32_t h = seed * 0x9E3779B9u ^ x * 0x85EBCA6Bu ^ y * 0xC2B2AE35u ^ z * 0x27D4EB2Fu;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        h *= 0x297A2D39u;
+        h ^= h >> 15;
+        return h;
+    }
+
+    static glm::vec3 latticeGradient(int x, int y, int z, int period, uint32_t seed)
+    {
+        uint32_t h = hash(static_cast<uint32_t>(x % period), static_cast<uint32_t>(y % period),
+                          static_cast<uint32_t>(z % period), seed);
+        glm::vec3 g(static_cast<float>(h & 0x3FF), static_cast<float>((h >> 10) & 0x3FF),
+                    static_cast<float>((h >> 20) & 0x3FF));
+        return g / 511.5f - glm::vec3(1.0f);
+    }
+
+    // 周期为period个晶格的梯度噪声，p的单位为晶格
+    static float periodicNoise(const glm::vec3& p, int period, uint32_t seed)
+    {
+        glm::vec3 base = glm::floor(p);
+        glm::vec3 f = p - base;
+        int x = static_cast<int>(base.x), y = static_cast<int>(base.y), z = static_cast<int>(base.z);
+        glm::vec3 u = f * f * f * (f * (f * 6.0f - glm::vec3(15.0f)) + glm::vec3(10.0f));
+
+        float corners[8];
+        for (int i = 0; i < 8; i++)
+        {
+            glm::ivec3 o(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+            corners[i] = glm::dot(latticeGradient(x + o.x, y + o.y, z + o.z, period, seed), f - glm::vec3(o));
+        }
+        float x00 = corners[0] + (corners[1] - corners[0]) * u.x;
+        float x10 = corners[2] + (corners[3] - corners[2]) * u.x;
+        float x01 = corners[4] + (corners[5] - corners[4]) * u.x;
+        float x11 = corners[6] + (corners[7] - corners[6]) * u.x;
+        float y0 = x00 + (x10 - x00) * u.y;
+        float y1 = x01 + (x11 - x01) * u.y;
+        return y0 + (y1 - y0) * u.z;
+    }
+
+    void bake(uint32_t seed)
+    {
+        // 向量势：三个分量各用独立种子的多倍频周期噪声
+        int n = resolution;
+        std::vector<glm::vec3> potential(cells.size());
+        for (int z = 0; z < n; z++)
+        {
+            for (int y = 0; y < n; y++)
+            {
+                for (int x = 0; x < n; x++)
+                {
+                    glm::vec3 p = glm::vec3(x, y, z) * (static_cast<float>(NOISE_PERIOD) / n);
+                    glm::vec3 psi(0.0f);
+                    float amplitude = 1.0f;
+                    int period = NOISE_PERIOD;
+                    for (int o = 0; o < OCTAVES; o++)
+                    {
+                        psi += amplitude * glm::vec3(periodicNoise(p, period, seed * 3 + 0),
+                                                     periodicNoise(p, period, seed * 3 + 1),
+                                                     periodicNoise(p, period, seed * 3 + 2));
+                        p *= 2.0f;
+                        period *= 2;
+                        amplitude *= 0.5f;
+                    }
+                    potential[(static_cast<size_t>(z) * n + y) * n + x] = psi;
+                }
+            }
+        }
+
+        // 周期中心差分求旋度：v = curl(psi)
+        auto at = [&](int x, int y, int z) -> const glm::vec3&
+        {
+            return potential[(static_cast<size_t>(wrap(z)) * n + wrap(y)) * n + wrap(x)];
+        };
+        std::vector<glm::vec3> velocity(cells.size());
+        float maxComponent = 1e-6f;
+        for (int z = 0; z < n; z++)
+        {
+            for (int y = 0; y < n; y++)
+            {
+                for (int x = 0; x < n; x++)
+                {
+                    glm::vec3 dx = at(x + 1, y, z) - at(x - 1, y, z);
+                    glm::vec3 dy = at(x, y + 1, z) - at(x, y - 1, z);
+                    glm::vec3 dz = at(x, y, z + 1) - at(x, y, z - 1);
+                    glm::vec3 v(dy.z - dz.y, dz.x - dx.z, dx.y - dy.x);
+                    velocity[(static_cast<size_t>(z) * n + y) * n + x] = v;
+                    maxComponent = std::fmax(maxComponent, std::fmax(std::fabs(v.x),
+                                                                     std::fmax(std::fabs(v.y), std::fabs(v.z))));
+                }
+            }
+        }
+
+        // 量化：最大分量映射到127，sample()中乘以scale还原为[-1, 1]
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            glm::vec3 q = glm::round(velocity[i] / maxComponent * 127.0f);
+            cells[i] = Cell{static_cast<int8_t>(q.x), static_cast<int8_t>(q.y), static_cast<int8_t>(q.z), 0};
+        }
+        scale = 1.0f / 127.0f;
+    }
+};
+
+#endif
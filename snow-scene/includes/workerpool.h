@@ -0,0 +1,111 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常驻工作线程；parallelFor把[0, count)按原子计数动态分给所有线程（含调用线程），全部完成后返回。
+// 多个线程同时调用parallelFor时依次执行；任务中不能再对同一个池调用parallelFor
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned int threadCount)
+    {
+        for (unsigned int i = 1; i < threadCount; i++)
+            threads.emplace_back(&WorkerPool::run, this);
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const
+    {
+        return threads.size() + 1;
+    }
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn)
+    {
+        if (count == 0)
+            return;
+        if (threads.empty() || count == 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+        std::lock_guard<std::mutex> call(callMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            next.store(0);
+            busy = threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain(fn, count);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex callMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> next{0};
+    size_t busy = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void drain(const std::function<void(size_t)>& fn, size_t count)
+    {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            fn(i);
+    }
+
+    void run()
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            const std::function<void(size_t)>* fn;
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                fn = job;
+                count = jobCount;
+            }
+            drain(*fn, count);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0)
+                done.notify_one();
+        }
+    }
+};
+
+#endif
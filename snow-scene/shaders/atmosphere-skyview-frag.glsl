@@ -0,0 +1,85 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 uv;
+
+uniform sampler2D transmittanceLUT;
+uniform float sunElevation; // 弧度
+uniform float viewHeight; // 观察者海拔（千米）
+
+const float PI = 3.14159265359;
+const float groundRadius = 6360.0;
+const float atmosphereRadius = 6460.0;
+const vec3 rayleighScattering = vec3(5.802, 13.558, 33.1) * 1e-3;
+const float rayleighScaleHeight = 8.0;
+const float mieScattering = 3.996e-3;
+const float mieExtinction = 4.40e-3;
+const float mieScaleHeight = 1.2;
+const float mieG = 0.8;
+const vec3 ozoneAbsorption = vec3(0.650, 1.881, 0.085) * 1e-3;
+const int STEPS = 32;
+
+vec3 transmittanceToSun(float radius, float cosZenith)
+{
+    vec2 lutUV = vec2(cosZenith * 0.5 + 0.5, (radius - groundRadius) / (atmosphereRadius - groundRadius));
+    return texture(transmittanceLUT, lutUV).rgb;
+}
+
+float raySphere(vec3 origin, vec3 dir, float radius, bool far)
+{
+    float b = dot(origin, dir);
+    float c = dot(origin, origin) - radius * radius;
+    float d = b * b - c;
+    if (d < 0.0)
+        return -1.0;
+    return far ? -b + sqrt(d) : -b - sqrt(d);
+}
+
+// x: 相对太阳的方位角 [0, 2PI)，y: 仰角，地平线附近分配更多纹素
+void main()
+{
+    float azimuth = uv.x * 2.0 * PI;
+    float l = uv.y * 2.0 - 1.0;
+    float elevation = sign(l) * l * l * 0.5 * PI;
+
+    vec3 dir = vec3(cos(elevation) * cos(azimuth), sin(elevation), cos(elevation) * sin(azimuth));
+    vec3 sunDir = vec3(cos(sunElevation), sin(sunElevation), 0.0);
+    vec3 origin = vec3(0.0, groundRadius + viewHeight, 0.0);
+
+    // 积分到大气层顶或地面
+    float rayLength = raySphere(origin, dir, atmosphereRadius, true);
+    float ground = raySphere(origin, dir, groundRadius, false);
+    if (ground > 0.0)
+        rayLength = ground;
+
+    float cosTheta = dot(dir, sunDir);
+    float rayleighPhase = 3.0 / (16.0 * PI) * (1.0 + cosTheta * cosTheta);
+    float g2 = mieG * mieG;
+    float miePhase = (1.0 - g2) / (4.0 * PI * pow(1.0 + g2 - 2.0 * mieG * cosTheta, 1.5));
+
+    float stepSize = rayLength / float(STEPS);
+    vec3 transmittance = vec3(1.0);
+    vec3 radiance = vec3(0.0);
+    for (int i = 0; i < STEPS; i++)
+    {
+        vec3 p = origin + dir * ((float(i) + 0.5) * stepSize);
+        float radius = sqrt(dot(p, p));
+        float height = max(0.0, radius - groundRadius);
+        float rayleighDensity = exp(-height / rayleighScaleHeight);
+        float mieDensity = exp(-height / mieScaleHeight);
+        float ozoneDensity = max(0.0, 1.0 - abs(height - 25.0) / 15.0);
+
+        vec3 scatteringR = rayleighScattering * rayleighDensity;
+        float scatteringM = mieScattering * mieDensity;
+        vec3 extinction = scatteringR + vec3(mieExtinction * mieDensity) + ozoneAbsorption * ozoneDensity;
+
+        vec3 sunTransmittance = transmittanceToSun(radius, dot(p / radius, sunDir));
+        vec3 scattered = sunTransmittance * (scatteringR * rayleighPhase + vec3(scatteringM * miePhase));
+
+        // 单步内按解析积分累加，步长较大时依然能量守恒
+        vec3 stepTransmittance = exp(-extinction * stepSize);
+        radiance += transmittance * scattered * (vec3(1.0) - stepTransmittance) / max(extinction, vec3(1e-7));
+        transmittance *= stepTransmittance;
+    }
+    FragColor = vec4(radiance, 1.0);
+}
@@ -0,0 +1,61 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 uv;
+
+// 长度单位：千米
+const float groundRadius = 6360.0;
+const float atmosphereRadius = 6460.0;
+const vec3 rayleighScattering = vec3(5.802, 13.558, 33.1) * 1e-3;
+const float rayleighScaleHeight = 8.0;
+const float mieExtinction = 4.40e-3;
+const float mieScaleHeight = 1.2;
+const vec3 ozoneAbsorption = vec3(0.650, 1.881, 0.085) * 1e-3;
+const int STEPS = 40;
+
+vec3 extinctionAt(float height)
+{
+    float rayleigh = exp(-height / rayleighScaleHeight);
+    float mie = exp(-height / mieScaleHeight);
+    float ozone = max(0.0, 1.0 - abs(height - 25.0) / 15.0);
+    return rayleighScattering * rayleigh + vec3(mieExtinction * mie) + ozoneAbsorption * ozone;
+}
+
+// 射线与以原点为球心的球求交，返回较远的交点距离，没有交点时返回-1
+float raySphereFar(vec3 origin, vec3 dir, float radius)
+{
+    float b = dot(origin, dir);
+    float c = dot(origin, origin) - radius * radius;
+    float d = b * b - c;
+    if (d < 0.0)
+        return -1.0;
+    return -b + sqrt(d);
+}
+
+// x: 太阳天顶角余弦 [-1, 1]，y: 海拔 [0, 大气层顶]
+void main()
+{
+    float cosZenith = uv.x * 2.0 - 1.0;
+    float radius = groundRadius + uv.y * (atmosphereRadius - groundRadius);
+    vec3 origin = vec3(0.0, radius, 0.0);
+    vec3 dir = vec3(sqrt(max(0.0, 1.0 - cosZenith * cosZenith)), cosZenith, 0.0);
+
+    // 被地面遮挡的方向透射率为0
+    float b = dot(origin, dir);
+    float groundHit = b * b - dot(origin, origin) + groundRadius * groundRadius;
+    if (b < 0.0 && groundHit > 0.0)
+    {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    float rayLength = raySphereFar(origin, dir, atmosphereRadius);
+    float stepSize = rayLength / float(STEPS);
+    vec3 opticalDepth = vec3(0.0);
+    for (int i = 0; i < STEPS; i++)
+    {
+        vec3 p = origin + dir * ((float(i) + 0.5) * stepSize);
+        opticalDepth += extinctionAt(max(0.0, sqrt(dot(p, p)) - groundRadius)) * stepSize;
+    }
+    FragColor = vec4(exp(-opticalDepth), 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec2 uv;
+
+// 不需要顶点缓冲：用gl_VertexID生成覆盖整个视口的三角形
+void main()
+{
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords; // 同时作为积雪高度场的采样坐标
+
+out vec2 TexCoords;
+out vec3 FragPos;
+out vec3 Normal;
+out float ViewDepth;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform sampler2D snowCover; // 积雪高度场
+uniform float snowCoverExtent;
+
+void main()
+{
+    // 按积雪厚度抬高地面，并用中心差分求法线
+    vec2 texel = 1.0 / vec2(textureSize(snowCover, 0));
+    float h = textureLod(snowCover, aTexCoords, 0.0).r;
+    float hl = textureLod(snowCover, aTexCoords - vec2(texel.x, 0.0), 0.0).r;
+    float hr = textureLod(snowCover, aTexCoords + vec2(texel.x, 0.0), 0.0).r;
+    float hd = textureLod(snowCover, aTexCoords - vec2(0.0, texel.y), 0.0).r;
+    float hu = textureLod(snowCover, aTexCoords + vec2(0.0, texel.y), 0.0).r;
+    float texelWorld = 2.0 * snowCoverExtent * texel.x;
+    Normal = normalize(vec3(hl - hr, 2.0 * texelWorld, hd - hu));
+
+    TexCoords = aTexCoords;
+    FragPos = vec3(aPos.x, aPos.y + h, aPos.z);
+    vec4 viewPos = view * vec4(FragPos, 1.0);
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
+}
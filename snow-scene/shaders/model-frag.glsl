@@ -4,38 +4,145 @@ out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 Normal;  // 接收法线向量
 in vec3 FragPos;
-in vec4 FragPosLightSpace;
+in float ViewDepth;
 
+#ifdef MATERIAL_ARRAY
+// 纹理数组材质，见 includes/texturearray.h
+uniform sampler2DArray materialPages;
+uniform float materialLayer;
+uniform float materialBaseLevel; // 本层已上传的最细mip级，流式上传期间逐步减小
+#else
 uniform sampler2D texture_diffuse1;
+#endif
 uniform vec3 lightColor;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 uniform vec3 objectColor;
-uniform sampler2D shadowMap; // 阴影贴图
+#ifdef UNLIT_COLOR
 uniform vec4 color;
+#endif
 
-float ShadowCalculation(vec4 fragPosLightSpace) {
-    // 获取当前片段的深度
-    float currentDepth = fragPosLightSpace.z / fragPosLightSpace.w;
-    // 从深度贴图中获取深度
-    float shadow = 0.0;
-    float bias = 0.005;
-    float closestDepth = texture(shadowMap, fragPosLightSpace.xy).r; 
-    shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-    return shadow;
+// 地面积雪高度场
+uniform sampler2D snowCover;
+uniform float snowCoverExtent;
+uniform float snowFullCoverDepth;
+
+#ifdef SHADOWED
+// 级联阴影贴图
+const int MAX_CASCADES = 4;
+uniform sampler2DArrayShadow shadowMap; // 阴影贴图数组，每层一个级联
+uniform mat4 lightSpaceMatrices[MAX_CASCADES];
+uniform float cascadeSplits[MAX_CASCADES];
+uniform int cascadeCount;
+
+float ShadowCalculation(vec3 fragPos, vec3 norm, vec3 lightDir) {
+    // 按视空间深度选择级联
+    int layer = cascadeCount;
+    for (int i = 0; i < cascadeCount; ++i) {
+        if (ViewDepth < cascadeSplits[i]) {
+            layer = i;
+            break;
+        }
+    }
+    // 远级联是轮询刷新的，片段可能落在旧矩阵的覆盖范围之外，此时退到下一级联
+    for (; layer < cascadeCount; ++layer) {
+        vec4 fragPosLightSpace = lightSpaceMatrices[layer] * vec4(fragPos, 1.0);
+        vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w * 0.5 + 0.5;
+        if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0))))
+            continue;
+
+        // 级联越远纹素越大，偏移随之增大
+        float bias = max(0.0015 * (1.0 - dot(norm, lightDir)), 0.0003) * float(layer + 1);
+        // 3x3 PCF，每次采样由硬件完成2x2比较与双线性混合
+        vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+        float lit = 0.0;
+        for (int x = -1; x <= 1; ++x) {
+            for (int y = -1; y <= 1; ++y) {
+                vec2 offset = vec2(x, y) * texelSize;
+                lit += texture(shadowMap, vec4(projCoords.xy + offset, float(layer), projCoords.z - bias));
+            }
+        }
+        return 1.0 - lit / 9.0;
+    }
+    return 0.0;
 }
+#endif
 
-void main()
-{    
-    // 如果设置了color，则直接将color作为片段的颜色
-    if (color != vec4(0.0)) {
-        FragColor = color;
-        return;
+#ifdef CLUSTERED_LIGHTS
+// 分簇点光源，见 includes/lights.h
+const int CLUSTER_TILES_X = 16;
+const int CLUSTER_TILES_Y = 9;
+const int CLUSTER_SLICES = 24;
+uniform usamplerBuffer clusterGrid;    // 每簇 (偏移, 数量)
+uniform usamplerBuffer clusterIndices; // 光源索引
+uniform samplerBuffer clusterLights;   // 每光源两个texel：(位置, 半径), (颜色, 0)
+uniform vec2 clusterTileSize;
+uniform float clusterNear;
+uniform float clusterLogScale;
+
+vec3 ClusteredLighting(vec3 fragPos, vec3 norm, vec3 viewDir) {
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+    int slice = clamp(int(log(ViewDepth / clusterNear) * clusterLogScale), 0, CLUSTER_SLICES - 1);
+    uvec2 cluster = texelFetch(clusterGrid, (slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < cluster.y; ++i) {
+        int light = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+        vec4 positionRadius = texelFetch(clusterLights, light * 2);
+        vec3 color = texelFetch(clusterLights, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - fragPos;
+        float distance2 = dot(toLight, toLight);
+        // 平方反比衰减乘以平滑窗口，在影响半径处衰减到0
+        float ratio = distance2 / (positionRadius.w * positionRadius.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / (distance2 + 1.0);
+
+        vec3 lightDir = toLight * inversesqrt(max(distance2, 1e-6));
+        float diff = max(dot(norm, lightDir), 0.0);
+        float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), 32);
+        result += (diff + spec) * attenuation * color;
     }
-    
+    return result;
+}
+#endif
+
+#ifdef MATERIAL_ARRAY
+// 各层的有效mip级不同，手动计算LOD并钳制到materialBaseLevel
+vec4 SampleMaterial(vec2 uv) {
+    vec2 texel = uv * vec2(textureSize(materialPages, 0).xy);
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+    return textureLod(materialPages, vec3(uv, materialLayer), max(lod, materialBaseLevel));
+}
+#endif
+
+// 积雪覆盖程度：只覆盖朝上、且低于积雪表面的片段
+float SnowCoverage(vec3 fragPos, vec3 norm) {
+    vec2 uv = fragPos.xz / (2.0 * snowCoverExtent) + 0.5;
+    if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+        return 0.0;
+    float depth = texture(snowCover, uv).r;
+    float amount = clamp(depth / snowFullCoverDepth, 0.0, 1.0);
+    float facingUp = smoothstep(0.4, 0.8, norm.y);
+    float buried = 1.0 - smoothstep(depth, depth + 0.05, fragPos.y);
+    return amount * facingUp * buried;
+}
+
+void main()
+{
+#ifdef UNLIT_COLOR
+    // 不做光照，直接输出color（雪花）
+    FragColor = color;
+#else
     // 纹理采样
+#ifdef MATERIAL_ARRAY
+    vec4 texColor = SampleMaterial(TexCoords);
+#else
     vec4 texColor = texture(texture_diffuse1, TexCoords);
+#endif
     vec3 norm = normalize(Normal); // 使用传递的法线向量
+    texColor.rgb = mix(texColor.rgb, vec3(0.95, 0.97, 1.0), SnowCoverage(FragPos, norm));
     vec3 lightDir = normalize(lightPos - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
@@ -46,8 +153,16 @@ void main()
     vec3 specular = spec * lightColor;
 
     vec3 ambient = 0.1 * objectColor;
-    vec3 result = ambient + diffuse + specular;
-    float shadow = ShadowCalculation(FragPosLightSpace); // 计算阴影
+#ifdef SHADOWED
+    float shadow = ShadowCalculation(FragPos, norm, lightDir); // 计算阴影
+#else
+    float shadow = 0.0;
+#endif
+    vec3 result = ambient + (1.0 - shadow) * (diffuse + specular);
+#ifdef CLUSTERED_LIGHTS
+    result += ClusteredLighting(FragPos, norm, viewDir);
+#endif
     // 结合纹理颜色和光照效果
-    FragColor = vec4(result, 1.0) * texColor;  
+    FragColor = vec4(result, 1.0) * texColor;
+#endif
 }
@@ -8,19 +8,43 @@ out vec2 TexCoords;
 out vec3 ourColor; // Color to pass to fragment shader
 out vec3 FragPos; // Fragment position for lighting calculations
 out vec3 Normal;  // 传递法线向量
-out vec4 FragPosLightSpace; // 传递光源空间位置
+out float ViewDepth; // 视空间深度，用于选择阴影级联
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform mat4 lightSpaceMatrix; // 从光源视角看到的转换矩阵
+
+#ifdef INSTANCED
+layout (location = 7) in vec3 aInstanceOffset; // 每实例平移
+uniform float instanceScale;
+#else
+uniform mat4 model;
+#endif
+
+#ifdef NORMAL_MATRIX
+uniform mat3 normalMatrix; // CPU上按物体计算的 transpose(inverse(mat3(model)))
+#endif
+
+// 深度预渲染（prepass-vert.glsl）与本着色器必须得到逐位相同的深度
+invariant gl_Position;
 
 void main()
 {
-    Normal = mat3(transpose(inverse(model))) * aNormal; // 转换法线向量
     TexCoords = aTexCoords;
     ourColor = aColor;
+#ifdef INSTANCED
+    // 统一缩放加平移，法线方向不变
+    Normal = aNormal;
+    FragPos = aPos * instanceScale + aInstanceOffset;
+    vec4 viewPos = view * vec4(FragPos, 1.0);
+#else
+#ifdef NORMAL_MATRIX
+    Normal = normalMatrix * aNormal;
+#else
+    Normal = mat3(transpose(inverse(model))) * aNormal; // 转换法线向量
+#endif
     FragPos = vec3(model * vec4(aPos, 1.0));
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0); // 计算并传递光源空间位置
+    vec4 viewPos = view * model * vec4(aPos, 1.0);
+#endif
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
 }
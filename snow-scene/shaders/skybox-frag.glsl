@@ -3,9 +3,34 @@ out vec4 FragColor;
 
 in vec3 TexCoords;
 
-uniform samplerCube skybox;
+uniform sampler2D skyViewLUT;
+uniform sampler2D transmittanceLUT;
+uniform vec3 sunDirection;
+uniform float sunIntensity;
+uniform float viewHeight;
+uniform float exposure;
+
+const float PI = 3.14159265359;
+const float groundRadius = 6360.0;
+const float atmosphereRadius = 6460.0;
+const float sunCosAngularRadius = 0.99996; // 约0.5度
 
 void main()
-{    
-    FragColor = texture(skybox, TexCoords);
-}
\ No newline at end of file
+{
+    vec3 dir = normalize(TexCoords);
+    float elevation = asin(clamp(dir.y, -1.0, 1.0));
+    // 方位角相对太阳计算，天空LUT只随太阳高度变化
+    float azimuth = atan(dir.z, dir.x) - atan(sunDirection.z, sunDirection.x);
+    float l = sqrt(abs(elevation) / (0.5 * PI));
+    vec2 lutUV = vec2(fract(azimuth / (2.0 * PI)), 0.5 + 0.5 * sign(elevation) * l);
+    vec3 radiance = texture(skyViewLUT, lutUV).rgb * sunIntensity;
+
+    // 太阳圆盘，亮度经大气衰减
+    if (dot(dir, sunDirection) > sunCosAngularRadius)
+    {
+        vec2 transmittanceUV = vec2(dir.y * 0.5 + 0.5, viewHeight / (atmosphereRadius - groundRadius));
+        radiance += texture(transmittanceLUT, transmittanceUV).rgb * sunIntensity * 20.0;
+    }
+
+    FragColor = vec4(vec3(1.0) - exp(-radiance * exposure), 1.0);
+}
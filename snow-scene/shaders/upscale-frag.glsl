@@ -0,0 +1,34 @@
+#version 330 core
+in vec2 uv;
+out vec4 FragColor;
+
+uniform sampler2D source;
+uniform vec2 sourceScale; // 渲染区域占纹理的比例
+uniform vec2 texelSize;   // 纹理像素的大小
+uniform float sharpness;  // 0为纯双线性
+
+// 采样限制在渲染区域内，避免双线性取到区域外上一帧的残留
+vec3 SampleSource(vec2 st)
+{
+    st = clamp(st, 0.5 * texelSize, sourceScale - 0.5 * texelSize);
+    return texture(source, st).rgb;
+}
+
+void main()
+{
+    vec2 st = uv * sourceScale;
+    vec3 color = SampleSource(st);
+    if (sharpness > 0.0)
+    {
+        vec3 n = SampleSource(st + vec2(0.0, texelSize.y));
+        vec3 s = SampleSource(st - vec2(0.0, texelSize.y));
+        vec3 e = SampleSource(st + vec2(texelSize.x, 0.0));
+        vec3 w = SampleSource(st - vec2(texelSize.x, 0.0));
+        // 拉普拉斯锐化，结果钳制在邻域范围内，不产生振铃
+        vec3 sharpened = color + (4.0 * color - (n + s + e + w)) * (0.25 * sharpness);
+        vec3 lo = min(color, min(min(n, s), min(e, w)));
+        vec3 hi = max(color, max(max(n, s), max(e, w)));
+        color = clamp(sharpened, lo, hi);
+    }
+    FragColor = vec4(color, 1.0);
+}
@@ -11,30 +11,53 @@
 #include "model.h"
 #include "skybox.h"
 #include "snowflake.h"
+#include "shadow.h"
+#include "profiler.h"
+#include "glstats.h"
+#include "memstats.h"
+#include "simulation.h"
+#include "snowcover.h"
+#include "sdf.h"
+#include "windfield.h"
+#include "texturestream.h"
+#include "shaderreload.h"
+#include "scene.h"
+#include "residency.h"
+#include "lights.h"
+#include "framecapture.h"
+#include "softraster.h"
+#include "commandlist.h"
+#include "picking.h"
+#include "dynamicresolution.h"
 
 #include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <functional>
+#include <string>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-void drawStamp(Shader shader, Model stump, glm::vec3 stumpPosition, glm::vec3 stumpRotation, glm::vec3 stumpScale);
-void drawHouse(Shader shader, Model house);
-void drawSnowman(Shader shader, Model snowman);
-void initDepthBuffer(GLuint& depthMapFBO, GLuint& depthMap);
-void renderShadowMap(Shader& depthShader, GLuint depthMapFBO, glm::vec3 lightPos, Model& stump, Model& house,
-                     Model& snowman);
-void applyShadow(Shader& shader, GLuint depthMap, glm::mat4 lightSpaceMatrix, Model& stump, Model& house,
-                 Model& snowman);
-glm::vec3 screenToWorldCoords(double xpos, double ypos, GLFWwindow* window, glm::mat4 view, glm::mat4 projection);
-glm::vec3 ScreenPosToWorldRay(int mouseX, int mouseY, int screenWidth, int screenHeight, glm::mat4 ViewMatrix,
-                              glm::mat4 ProjectionMatrix);
-glm::vec3 RayPlaneIntersection(glm::vec3 rayOrigin, glm::vec3 rayDirection, glm::vec3 planeNormal,
-                               glm::vec3 planePoint);
-
-// 窗口大小
-const unsigned int SCR_WIDTH = 1280;
-const unsigned int SCR_HEIGHT = 768;
+void recordAsset(CommandList& list, int node, int handle, bool lit);
+bool sceneReady(TextureStreamer& streamer);
+void buildScene();
+void placeLanterns(int count);
+void recordShadowMap(CommandList& list, Shader& depthShader, CascadedShadowMap& shadowMap);
+void recordScene(CommandList& list, Shader& shader, Shader& prepassShader, const CascadedShadowMap& shadowMap,
+                 const glm::mat4& view, const glm::mat4& projection);
+void renderSoftware(SoftwareRasterizer& raster, const glm::mat4& view, const glm::mat4& projection,
+                    const glm::vec3& lightColor, const CascadedShadowMap& shadowMap, const Atmosphere& atmosphere,
+                    const Model& crystal);
+
+// 窗口大小（离线渲染时为输出分辨率）
+unsigned int SCR_WIDTH = 1280;
+unsigned int SCR_HEIGHT = 768;
 
 // 摄像机
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -46,23 +69,368 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-glm::vec3 stumpPosition = glm::vec3(0.0f, 0.0f, 5.0f);
-glm::vec3 stumpRotation = glm::vec3(0.0f, 0.0f, 0.0f);
-glm::vec3 stumpScale = glm::vec3(0.1f, 0.1f, 0.1f);
+// 场景节点：物体的变换与缓存的世界矩阵
+SceneGraph scene;
+int stumpNode, houseNode, snowmanNode;
+// 场景模型按摄像机距离加载，超出内存预算时按LRU驱逐
+AssetResidency assets;
+int stumpAsset, houseAsset, snowmanAsset;
+// 灯笼等点光源，分簇后只在受影响的片段中计算
+ClusteredLights clusteredLights;
+int lanternCount = 48;
+// 树桩模型本身朝向-Z，额外绕X轴旋转-90度立起
+const glm::vec3 STUMP_POSITION = glm::vec3(0.0f, 0.0f, 5.0f);
+const glm::vec3 STUMP_ROTATION = glm::vec3(-90.0f, 0.0f, 0.0f);
+const glm::vec3 STUMP_SCALE = glm::vec3(0.1f, 0.1f, 0.1f);
 bool dragging = false;
 glm::vec2 lastMousePos = glm::vec2(0.0f, 0.0f);
 glm::vec3 previousWorldCoords = glm::vec3(0.0f, 0.0f, 0.0f);
 bool zKeyPressed = false;
 bool isSunMoving = true;
 bool xKeyPressed = false;
+bool depthPrepass = false; // 深度预渲染开关，P键切换
+bool pKeyPressed = false;
+bool f9KeyPressed = false;
+bool f10KeyPressed = false;
+bool f8KeyPressed = false;
+bool f7KeyPressed = false;
+WindQuality windQuality = WindQuality::Medium;
+bool devShaders = false; // 开发模式：监视.glsl文件并热重载
+
+// 渲染后端，--renderer software 时场景由CPU光栅化，GL只负责资源加载与显示
+enum class RenderBackend
+{
+    OpenGL,
+    Software
+};
+
+RenderBackend renderBackend = RenderBackend::OpenGL;
+
+// --dynamic-resolution MS 开启，场景按帧时间目标缩放渲染分辨率；离线渲染与后端对比时不启用
+DynamicResolutionSettings dynamicResolutionSettings;
+std::unique_ptr<DynamicResolution> dynamicResolution;
 
 
 SnowflakeGenerator generator;
+// 雪花与太阳在独立线程中以固定步长模拟，generator只由该线程访问
+SimulationThread simulation(generator, 60.0);
+std::vector<glm::vec3> snowflakePositions; // 本帧插值后的雪花位置
 glm::vec3 lightPos;
 glm::vec3 initialLightPos = glm::vec3(10.0f, 10.0f, 10.0f);
 
-int main()
+// 深度预渲染性能对比：在若干视角下分别关闭/开启预渲染，各渲染固定帧数并统计平均帧时间
+struct PrepassBenchmark
+{
+    struct Viewpoint
+    {
+        const char* name;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    bool enabled = false;
+    int warmupFrames = 30;
+    int measureFrames = 300;
+    std::vector<Viewpoint> viewpoints{
+        {"overview", glm::vec3(0.0f, 3.0f, 15.0f), -90.0f, -10.0f},
+        {"house close-up", glm::vec3(0.0f, 1.0f, 4.0f), -90.0f, 0.0f}, // 雪人与房屋重叠，过度绘制最多
+        {"low angle", glm::vec3(6.0f, 0.5f, 6.0f), -135.0f, 5.0f},
+    };
+    std::vector<double> results; // 每个视角依次记录 关闭/开启 两个结果（毫秒/帧）
+
+    // 每帧开始时设置当前测试用例的摄像机与预渲染开关
+    void beginFrame()
+    {
+        const Viewpoint& vp = viewpoints[caseIndex / 2];
+        camera = Camera(vp.position, glm::vec3(0.0f, 1.0f, 0.0f), vp.yaw, vp.pitch);
+        depthPrepass = caseIndex % 2 == 1;
+    }
+
+    // 每帧结束（glFinish之后）调用，全部用例完成时返回true
+    bool endFrame(double now)
+    {
+        frame++;
+        if (frame == warmupFrames)
+            startTime = now;
+        if (frame < warmupFrames + measureFrames)
+            return false;
+
+        results.push_back((now - startTime) * 1000.0 / measureFrames);
+        frame = 0;
+        caseIndex++;
+        if (caseIndex < static_cast<int>(viewpoints.size()) * 2)
+            return false;
+
+        report();
+        return true;
+    }
+
+    void report() const
+    {
+        std::cout << "depth pre-pass benchmark: " << measureFrames << " frames per case, ms/frame" << std::endl;
+        std::cout << std::left << std::setw(18) << "view" << std::right << std::setw(14) << "no pre-pass"
+            << std::setw(12) << "pre-pass" << std::setw(10) << "speedup" << std::endl;
+        for (size_t i = 0; i < viewpoints.size(); i++)
+        {
+            double off = results[i * 2];
+            double on = results[i * 2 + 1];
+            std::cout << std::left << std::setw(18) << viewpoints[i].name << std::right << std::fixed
+                << std::setprecision(3) << std::setw(14) << off << std::setw(12) << on
+                << std::setprecision(2) << std::setw(9) << off / on << "x" << std::endl;
+        }
+    }
+
+private:
+    int caseIndex = 0;
+    int frame = 0;
+    double startTime = 0.0;
+};
+
+PrepassBenchmark prepassBenchmark;
+
+// 离线渲染：不打开可见窗口，以固定帧率手动推进模拟，摄像机沿环绕场景的路径飞行，
+// 每帧渲染到FrameCapture的FBO并异步写出图片。纹理流式加载完成前的帧只渲染不输出。
+struct OfflineRender
 {
+    bool enabled = false;
+    int frameCount = 300;
+    int width = 1920;
+    int height = 1080;
+    float frameRate = 30.0f;
+    std::string directory = "frames";
+    ImageFormat format = ImageFormat::PPM;
+    int warmupLimit = 600; // 等待模型与纹理加载的最大帧数
+    bool capturing = false; // 本帧是否输出
+    int frame = 0; // 已输出的帧数
+
+    // 每帧开始：设置摄像机并推进模拟，assetsReady表示纹理已全部上传且场景资源都已驻留（见sceneReady）
+    void beginFrame(bool assetsReady)
+    {
+        capturing = assetsReady || warmup >= warmupLimit;
+        if (!capturing)
+        {
+            warmup++;
+            return;
+        }
+        if (frame == 0)
+            startTime = glfwGetTime();
+
+        float time = frame / frameRate;
+        float angle = time * 0.2f;
+        glm::vec3 position(std::cos(angle) * 14.0f, 3.0f, std::sin(angle) * 14.0f);
+        glm::vec3 direction = glm::normalize(glm::vec3(0.0f, 1.0f, 0.0f) - position);
+        camera = Camera(position, glm::vec3(0.0f, 1.0f, 0.0f), glm::degrees(std::atan2(direction.z, direction.x)),
+                        glm::degrees(std::asin(direction.y)));
+
+        // 每帧固定推进1/frameRate秒，与渲染耗时无关
+        simulationDebt += 1.0 / frameRate;
+        while (simulationDebt >= simulation.tickInterval())
+        {
+            simulation.step();
+            simulationDebt -= simulation.tickInterval();
+        }
+        simulation.latest(snowflakePositions, lightPos);
+    }
+
+    // 读回已发起后调用，全部帧完成时返回true
+    bool endFrame()
+    {
+        if (capturing)
+            frame++;
+        return frame >= frameCount;
+    }
+
+    // capture.finish()之后调用，吞吐量包含最后几帧的读回与编码
+    void report(const FrameCapture& capture) const
+    {
+        double elapsed = glfwGetTime() - startTime;
+        std::cout << "offline render: " << capture.framesWritten() << " frames at " << width << "x" << height
+            << " in " << std::fixed << std::setprecision(2) << elapsed << " s, " << frame / elapsed << " fps ("
+            << capture.stalls() << " readback stalls)" << std::endl;
+    }
+
+private:
+    int warmup = 0;
+    double startTime = 0.0;
+    double simulationDebt = 0.0;
+};
+
+OfflineRender offlineRender;
+
+// 后端对比：固定摄像机与模拟状态，先用OpenGL渲染一帧并读回，下一帧用软件光栅化器渲染同一画面，
+// 写出两张图与差异图（逐像素绝对差放大8倍）并打印RMSE/PSNR。
+// 积雪覆盖、积雪地面与灯笼只有GL后端实现，对比时关闭。
+struct BackendDiff
+{
+    bool enabled = false;
+    int simulationTicks = 180; // 先模拟3秒，让雪花进入画面
+    int warmupLimit = 600; // 等待模型与纹理加载的最大帧数
+    int tolerance = 8; // 任一通道相差超过该值的像素计为不同
+
+    // 每帧开始时设置摄像机，返回本帧使用的后端
+    RenderBackend beginFrame(bool assetsReady)
+    {
+        camera = Camera(glm::vec3(0.0f, 2.0f, 12.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -8.0f);
+        if (stage == Stage::Warmup)
+        {
+            if (!simulated)
+            {
+                for (int i = 0; i < simulationTicks; i++)
+                    simulation.step();
+                simulation.latest(snowflakePositions, lightPos);
+                simulated = true;
+            }
+            if (assetsReady || warmup++ >= warmupLimit)
+                stage = Stage::Reference;
+        }
+        return stage == Stage::Candidate ? RenderBackend::Software : RenderBackend::OpenGL;
+    }
+
+    // 交换缓冲之前调用，读回默认帧缓冲；两帧都完成时返回true
+    bool endFrame()
+    {
+        if (stage == Stage::Warmup)
+            return false;
+        std::vector<unsigned char>& pixels = stage == Stage::Reference ? reference : candidate;
+        pixels.resize(static_cast<size_t>(SCR_WIDTH) * SCR_HEIGHT * 3);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        if (stage == Stage::Reference)
+        {
+            stage = Stage::Candidate;
+            return false;
+        }
+        report();
+        return true;
+    }
+
+    void report() const
+    {
+        std::vector<unsigned char> diff(reference.size());
+        double squared = 0.0;
+        size_t differing = 0;
+        for (size_t i = 0; i < reference.size(); i += 3)
+        {
+            int largest = 0;
+            for (size_t c = i; c < i + 3; c++)
+            {
+                int d = std::abs(static_cast<int>(reference[c]) - static_cast<int>(candidate[c]));
+                diff[c] = static_cast<unsigned char>(std::min(d * 8, 255));
+                squared += static_cast<double>(d) * d;
+                largest = std::max(largest, d);
+            }
+            if (largest > tolerance)
+                differing++;
+        }
+        double rmse = std::sqrt(squared / reference.size());
+        size_t pixels = reference.size() / 3;
+        writePPM("diff-gl.ppm", reference);
+        writePPM("diff-software.ppm", candidate);
+        writePPM("diff.ppm", diff);
+        std::cout << "backend diff: RMSE " << std::fixed << std::setprecision(3) << rmse << ", PSNR ";
+        if (rmse > 0.0)
+            std::cout << std::setprecision(2) << 20.0 * std::log10(255.0 / rmse) << " dB";
+        else
+            std::cout << "inf";
+        std::cout << ", " << std::setprecision(2) << 100.0 * differing / pixels << "% of pixels differ by more than "
+            << tolerance << "/255 (diff-gl.ppm, diff-software.ppm, diff.ppm)" << std::endl;
+    }
+
+private:
+    enum class Stage
+    {
+        Warmup,
+        Reference,
+        Candidate
+    };
+
+    Stage stage = Stage::Warmup;
+    int warmup = 0;
+    bool simulated = false;
+    std::vector<unsigned char> reference;
+    std::vector<unsigned char> candidate;
+
+    // glReadPixels的行自下而上，写出时翻转
+    static void writePPM(const char* path, const std::vector<unsigned char>& rgb)
+    {
+        FILE* file = std::fopen(path, "wb");
+        if (file == nullptr)
+        {
+            std::cout << "backend diff: failed to write " << path << std::endl;
+            return;
+        }
+        std::fprintf(file, "P6\n%u %u\n255\n", SCR_WIDTH, SCR_HEIGHT);
+        size_t row = static_cast<size_t>(SCR_WIDTH) * 3;
+        for (unsigned int y = 0; y < SCR_HEIGHT; y++)
+            std::fwrite(rgb.data() + (SCR_HEIGHT - 1 - y) * row, 1, row, file);
+        std::fclose(file);
+    }
+};
+
+BackendDiff backendDiff;
+
+int main(int argc, char** argv)
+{
+    // 命令行参数
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--depth-prepass") == 0)
+            depthPrepass = true;
+        else if (std::strcmp(argv[i], "--benchmark-prepass") == 0)
+            prepassBenchmark.enabled = true;
+        else if (std::strcmp(argv[i], "--dev-shaders") == 0)
+            devShaders = true;
+        else if (std::strcmp(argv[i], "--cpu-budget") == 0 && i + 1 < argc)
+            assets.cpuBudget = std::strtoull(argv[++i], nullptr, 10) << 20; // MB
+        else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+            assets.gpuBudget = std::strtoull(argv[++i], nullptr, 10) << 20; // MB
+        else if (std::strcmp(argv[i], "--scene-cpu-budget") == 0 && i + 1 < argc)
+            memstats::setBudget(MemoryDomain::CPU, std::strtoull(argv[++i], nullptr, 10) << 20); // MB，整个场景
+        else if (std::strcmp(argv[i], "--scene-gpu-budget") == 0 && i + 1 < argc)
+            memstats::setBudget(MemoryDomain::GPU, std::strtoull(argv[++i], nullptr, 10) << 20); // MB，整个场景
+        else if (std::strcmp(argv[i], "--render") == 0 && i + 1 < argc)
+        {
+            offlineRender.enabled = true;
+            offlineRender.frameCount = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--render-size") == 0 && i + 1 < argc)
+            std::sscanf(argv[++i], "%dx%d", &offlineRender.width, &offlineRender.height);
+        else if (std::strcmp(argv[i], "--render-out") == 0 && i + 1 < argc)
+            offlineRender.directory = argv[++i];
+        else if (std::strcmp(argv[i], "--render-png") == 0)
+            offlineRender.format = ImageFormat::PNG;
+        else if (std::strcmp(argv[i], "--renderer") == 0 && i + 1 < argc)
+            renderBackend = std::strcmp(argv[++i], "software") == 0 ? RenderBackend::Software : RenderBackend::OpenGL;
+        else if (std::strcmp(argv[i], "--diff-backends") == 0)
+            backendDiff.enabled = true;
+        else if (std::strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+            dynamicResolutionSettings.targetMs = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--dynres-min") == 0 && i + 1 < argc)
+            dynamicResolutionSettings.minScale = glm::clamp(static_cast<float>(std::atof(argv[++i])), 0.1f, 1.0f);
+        else if (std::strcmp(argv[i], "--dynres-filter") == 0 && i + 1 < argc)
+            dynamicResolutionSettings.filter = std::strcmp(argv[++i], "sharpen") == 0 ? UpscaleFilter::Sharpen
+                                                                                      : UpscaleFilter::Bilinear;
+        else if (std::strcmp(argv[i], "--dynres-timing") == 0 && i + 1 < argc)
+            dynamicResolutionSettings.timing = std::strcmp(argv[++i], "cpu") == 0 ? FrameTiming::CPU : FrameTiming::GPU;
+        else if (std::strcmp(argv[i], "--lanterns") == 0 && i + 1 < argc)
+            lanternCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            generator.seed(std::strtoull(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--wind-quality") == 0 && i + 1 < argc)
+        {
+            // 风场网格 low=16^3, medium=32^3, high=64^3
+            i++;
+            if (std::strcmp(argv[i], "low") == 0)
+                windQuality = WindQuality::Low;
+            else if (std::strcmp(argv[i], "high") == 0)
+                windQuality = WindQuality::High;
+            else
+                windQuality = WindQuality::Medium;
+        }
+    }
+
     // glfw初始化
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -72,6 +440,13 @@ int main()
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (offlineRender.enabled)
+    {
+        // 离线渲染只需要GL上下文，窗口保持隐藏，画面尺寸按输出分辨率
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        SCR_WIDTH = offlineRender.width;
+        SCR_HEIGHT = offlineRender.height;
+    }
 
     // 创建窗口
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "snow-scene", nullptr, nullptr);
@@ -86,229 +461,520 @@ int main()
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (prepassBenchmark.enabled || offlineRender.enabled)
+        glfwSwapInterval(0); // 测试时关闭垂直同步
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    ShaderCache::instance().initialize((GLADloadproc)glfwGetProcAddress);
+    // 录制命令时在工作线程中解析材质，占位页要先在GL线程创建
+    TextureArrayPool::instance().prepare();
 
     // 开启深度测试
     glEnable(GL_DEPTH_TEST);
 
     // 着色器
-    Shader shader("shaders/model-vert.glsl", "shaders/model-frag.glsl");
-
-    // 加载模型：树桩，房屋，雪人，雪花
-    Model stump("resources/stump/stump-in-winter.fbx");
-    Model house("resources/house/house.obj");
-    Model snowman("resources/snowman/snowman.obj");
-    Model crystal("resources/crystal/crystal.obj");
-
-    // 加载天空盒
-    std::vector<std::string> faces
-    {
-        "resources/skybox/right.jpg",
-        "resources/skybox/left.jpg",
-        "resources/skybox/top.jpg",
-        "resources/skybox/bottom.jpg",
-        "resources/skybox/front.jpg",
-        "resources/skybox/back.jpg"
-    };
-    Skybox skybox(faces);
+    // 模型着色器按特性组合构建：场景物体带阴影、使用CPU法线矩阵并从纹理数组取漫反射纹理，雪花不做光照并实例化绘制
+    ShaderPermutations modelShaders("shaders/model-vert.glsl", "shaders/model-frag.glsl");
+    Shader& shader = modelShaders.get(SHADER_SHADOWED | SHADER_NORMAL_MATRIX | SHADER_CLUSTERED_LIGHTS |
+                                      SHADER_MATERIAL_ARRAY);
+    Shader& snowflakeShader = modelShaders.get(SHADER_UNLIT_COLOR | SHADER_INSTANCED);
+
+    // 纹理在工作线程解码，渲染循环中按预算逐帧上传
+    TextureStreamer textureStreamer(2);
+
+    // 场景模型（树桩，房屋，雪人）交给驻留管理按需加载；雪花模型用于实例化绘制，始终驻留
+    buildScene();
+    stumpAsset = assets.add("resources/stump/stump-in-winter.fbx", stumpNode, 30.0f, &textureStreamer);
+    houseAsset = assets.add("resources/house/house.obj", houseNode, 60.0f, &textureStreamer);
+    snowmanAsset = assets.add("resources/snowman/snowman.obj", snowmanNode, 40.0f, &textureStreamer);
+    Model crystal("resources/crystal/crystal.obj", false, &textureStreamer);
+
+    // 天空：大气散射查找表，天空盒只负责绘制
+    Atmosphere atmosphere;
+    Skybox skybox;
     Shader depthShader("shaders/depth-vert.glsl", "shaders/depth-frag.glsl");
-    GLuint depthMapFBO;
-    // 创建深度纹理
-    GLuint depthMap;
-    initDepthBuffer(depthMapFBO, depthMap);
+    // 深度预渲染只写深度，复用depth-frag.glsl
+    Shader prepassShader("shaders/prepass-vert.glsl", "shaders/depth-frag.glsl");
+    // 积雪地面：按高度场位移的网格，片段部分与模型共用光照着色器
+    Shader groundShader("shaders/ground-vert.glsl", "shaders/model-frag.glsl",
+                        shaderDefines(SHADER_SHADOWED | SHADER_CLUSTERED_LIGHTS));
+    SnowCover snowCover(512, 12.0f);
+    // 级联阴影贴图：4个级联，远级联每3帧轮流刷新
+    CascadedShadowMap shadowMap(4, 2048, 3);
     glm::vec3 lightColor = glm::vec3(2.0f, 2.0f, 2.0f);
     lightPos = glm::vec3(10.0f, 10.0f, 10.0f);
-    float near_plane = 1.0f, far_plane = 7.5f;
     glm::vec3 lightTarget = glm::vec3(0.0f, 0.0f, 0.0f); // 通常是场景中心或重要物体的位置
-    glm::vec3 upVector = glm::vec3(0.0, 1.0, 0.0);
-    glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.0f, 50.0f);
-    glm::mat4 lightView = glm::lookAt(lightPos, lightTarget, upVector);
-    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+
+    // 静态模型（房屋、雪人）的距离场，供雪花碰撞；树桩可被拖动，不参与烘焙
+    SceneSDF sceneSDF(0.05f, 3);
+    sceneSDF.addModel(assets.require(houseAsset), scene.world(houseNode));
+    sceneSDF.addModel(assets.require(snowmanAsset), scene.world(snowmanNode));
+    sceneSDF.loadOrBuild("resources/scene.sdf");
+    generator.collider = &sceneSDF;
+
+    placeLanterns(backendDiff.enabled ? 0 : lanternCount);
+    clusteredLights.setViewport(SCR_WIDTH, SCR_HEIGHT);
+
+    // 风场：预计算的旋度噪声网格，平移采样
+    WindField wind(windQuality, 16.0f);
+    generator.wind = &wind;
+    std::cout << "wind field: " << wind.resolution << "^3, " << wind.footprintBytes() / 1024 << " KB" << std::endl;
+
+    std::unique_ptr<ShaderHotReload> shaderReload;
+    if (devShaders)
+    {
+        shaderReload.reset(new ShaderHotReload(window));
+        shaderReload->watch(shader);
+        shaderReload->watch(snowflakeShader);
+        shaderReload->watch(depthShader);
+        shaderReload->watch(prepassShader);
+        shaderReload->watch(groundShader);
+        shaderReload->start();
+    }
+
+    // 启动模拟线程
+    simulation.initialLightPos = initialLightPos;
+    simulation.sunMoving = isSunMoving;
+    simulation.snowing = generator.isSnowing;
+    simulation.snowCover = backendDiff.enabled ? nullptr : &snowCover;
+    std::unique_ptr<FrameCapture> capture;
+    if (offlineRender.enabled)
+        capture.reset(new FrameCapture(offlineRender.width, offlineRender.height, offlineRender.directory,
+                                       offlineRender.format));
+    else if (!backendDiff.enabled)
+        simulation.start(); // 离线渲染与后端对比由渲染循环手动推进
+
+    // 软件光栅化器：线程池与缓冲区常驻，对比模式下与GL后端交替使用
+    std::unique_ptr<SoftwareRasterizer> softRaster;
+    if (renderBackend == RenderBackend::Software || backendDiff.enabled)
+        softRaster.reset(new SoftwareRasterizer(SCR_WIDTH, SCR_HEIGHT));
+
+    if (dynamicResolutionSettings.targetMs > 0.0 && renderBackend == RenderBackend::OpenGL && !offlineRender.enabled
+        && !backendDiff.enabled)
+        dynamicResolution.reset(new DynamicResolution(dynamicResolutionSettings));
+
+    // 每帧重新录制的命令列表，内存在帧间复用
+    CommandList shadowCommands, sceneCommands, particleCommands;
+    // 录制线程常驻，每帧只唤醒一次；三个列表各为一项任务，本线程也参与录制
+    WorkerPool recordWorkers(3);
+    glm::mat4 recordView, recordProjection;
+    const std::function<void(size_t)> recordPass = [&](size_t pass)
+    {
+        if (pass == 0)
+            recordScene(sceneCommands, shader, prepassShader, shadowMap, recordView, recordProjection);
+        else if (pass == 1)
+            recordShadowMap(shadowCommands, depthShader, shadowMap);
+        else
+            generator.record(particleCommands, snowflakeShader, crystal, recordView, recordProjection,
+                             snowflakePositions);
+    };
 
     // 渲染循环
     while (!glfwWindowShouldClose(window))
     {
+        PROFILE_FRAME_BEGIN();
+        PROFILE_SCOPE("frame");
+        GLSTATS_FRAME_BEGIN();
+
         // 记录每一帧的时间差
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        if (isSunMoving)
+        // 处理输入
+        RenderBackend frameBackend = renderBackend;
         {
-            // 计算移动时间
-            float speedFactor = 0.2f;
-            float timeValue = glfwGetTime() * speedFactor;
-            // 使用球面坐标计算光源位置
-            float maxAltitude = 1.0f;
-            float lightPosX = 20.0f * cos(timeValue);
-            float lightPosY = 20.0f * sin(timeValue);
-            float lightPosZ = sin(timeValue) * maxAltitude;
+            PROFILE_SCOPE("input");
+            if (offlineRender.enabled)
+                offlineRender.beginFrame(sceneReady(textureStreamer));
+            else if (backendDiff.enabled)
+                frameBackend = backendDiff.beginFrame(sceneReady(textureStreamer));
+            else
+                processInput(window);
+            if (prepassBenchmark.enabled)
+                prepassBenchmark.beginFrame();
+        }
 
-            lightPos = glm::vec3(lightPosX, lightPosY, lightPosZ);
+        // 只重算本帧被修改过的节点，再按新位置决定模型的加载与驱逐
+        {
+            PROFILE_SCOPE("scene update");
+            scene.update();
+            assets.update(scene, camera.Position);
         }
+
+        // 取模拟线程最新的结果，在最近两次模拟状态之间插值出雪花与太阳的位置
+        {
+            PROFILE_SCOPE("particle update");
+            if (!offlineRender.enabled && !backendDiff.enabled)
+                simulation.interpolate(simulation.now(), snowflakePositions, lightPos);
+        }
+
+        // 上传本帧积雪高度场中变化的分块
+        {
+            PROFILE_SCOPE("snow cover upload");
+            GLSTATS_PASS("snow cover upload");
+            snowCover.upload();
+        }
+        {
+            PROFILE_SCOPE("texture streaming");
+            GLSTATS_PASS("texture streaming");
+            textureStreamer.update();
+        }
+        if (shaderReload)
+            shaderReload->apply();
+        {
+            PROFILE_GPU_SCOPE("atmosphere");
+            GLSTATS_PASS("atmosphere");
+            atmosphere.update(lightPos, SCR_WIDTH, SCR_HEIGHT);
+        }
+
+        // 决定本帧的渲染分辨率，光源分簇按缩放后的片段坐标划分tile
+        if (dynamicResolution)
+        {
+            int outputWidth, outputHeight;
+            glfwGetFramebufferSize(window, &outputWidth, &outputHeight);
+            dynamicResolution->beginFrame(outputWidth, outputHeight, deltaTime * 1000.0);
+            clusteredLights.setViewport(dynamicResolution->renderWidth(), dynamicResolution->renderHeight());
+        }
+
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+                                                (float)SCR_WIDTH / (float)SCR_HEIGHT,
+                                                0.1f,
+                                                100.0f);
+        {
+            PROFILE_SCOPE("light clustering");
+            GLSTATS_PASS("light clustering");
+            clusteredLights.update(view, glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        }
+
         shader.use();
         shader.setVec3("lightColor", lightColor);
         shader.setVec3("lightPos", lightPos);
         shader.setVec3("viewPos", camera.Position);
+        snowCover.bind(shader);
+        clusteredLights.bind(shader);
 
-        // 处理输入
-        processInput(window);
+        shadowMap.update(view, glm::radians(camera.Zoom),
+                         (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f, lightTarget - lightPos);
 
-        // 渲染
-        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // 阴影、场景与雪花的命令在工作线程中并行录制（录制不调用GL），之后在本线程依次回放
+        if (frameBackend == RenderBackend::OpenGL)
+        {
+            PROFILE_SCOPE("command recording");
+            shadowCommands.reset();
+            sceneCommands.reset();
+            particleCommands.reset();
+            recordView = view;
+            recordProjection = projection;
+            recordWorkers.parallelFor(3, recordPass);
+        }
 
         // 渲染阴影贴图
-        renderShadowMap(depthShader, depthMapFBO, lightPos, stump, house, snowman);
-        // 应用阴影到场景
-        applyShadow(shader, depthMap, lightSpaceMatrix, stump, house, snowman);
+        if (frameBackend == RenderBackend::OpenGL)
+        {
+            PROFILE_GPU_SCOPE("shadow pass");
+            GLSTATS_PASS("shadow pass");
+            shadowCommands.execute();
+        }
 
+        // 渲染（阴影与大气查找表绘制在各自的FBO中，完成后才绑定最终目标）
+        if (capture)
+            capture->bind();
+        if (frameBackend == RenderBackend::Software)
+        {
+            PROFILE_SCOPE("software raster");
+            renderSoftware(*softRaster, view, projection, lightColor, shadowMap, atmosphere, crystal);
+        }
+        else
+        {
+            if (dynamicResolution)
+                dynamicResolution->bind();
+            glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // 清空纹理
-        generator.update(deltaTime);
-        generator.draw(shader, crystal, camera, SCR_WIDTH, SCR_HEIGHT);
+            {
+                PROFILE_GPU_SCOPE("scene pass");
+                GLSTATS_PASS("scene pass");
+                // 深度预渲染（开启时）与带阴影的场景物体
+                sceneCommands.execute();
+
+                // 积雪地面不参与深度预渲染，在恢复深度状态之后绘制；软件后端不绘制地面，对比时两边都关闭
+                if (!backendDiff.enabled)
+                {
+                    groundShader.use();
+                    groundShader.setVec3("lightColor", lightColor);
+                    groundShader.setVec3("lightPos", lightPos);
+                    groundShader.setVec3("viewPos", camera.Position);
+                    shadowMap.bind(groundShader);
+                    clusteredLights.bind(groundShader);
+                    snowCover.drawGround(groundShader, view, projection);
+                }
+            }
 
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-                                                (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                                                0.1f,
-                                                100.0f);
-        skybox.draw(view, projection);
+            {
+                PROFILE_GPU_SCOPE("snowflake draw");
+                GLSTATS_PASS("snowflake draw");
+                particleCommands.execute();
+            }
+
+            {
+                PROFILE_GPU_SCOPE("skybox");
+                GLSTATS_PASS("skybox");
+                skybox.draw(view, projection, atmosphere);
+            }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            if (dynamicResolution)
+            {
+                PROFILE_GPU_SCOPE("upscale");
+                GLSTATS_PASS("upscale");
+                dynamicResolution->resolve();
+            }
+        }
+
+        if (capture)
+        {
+            PROFILE_SCOPE("readback");
+            if (offlineRender.capturing)
+                capture->capture(offlineRender.frame);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (offlineRender.endFrame())
+                glfwSetWindowShouldClose(window, true);
+        }
+
+        if (backendDiff.enabled && backendDiff.endFrame())
+            glfwSetWindowShouldClose(window, true);
+
+        GLSTATS_FRAME_END();
+#ifdef SNOW_GL_STATS
+        // 每0.5秒把本帧统计显示在窗口标题上
+        static double lastStatsTitle = 0.0;
+        if (glfwGetTime() - lastStatsTitle > 0.5)
+        {
+            lastStatsTitle = glfwGetTime();
+            glfwSetWindowTitle(window, ("snow-scene | " + glstats::summary(glstats::lastFrame())).c_str());
+        }
+#endif
+
+        {
+            PROFILE_SCOPE("swap");
+            if (!capture)
+                glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+
+        if (prepassBenchmark.enabled)
+        {
+            // 等待GPU完成，使帧时间包含片段着色的开销
+            glFinish();
+            if (prepassBenchmark.endFrame(glfwGetTime()))
+                glfwSetWindowShouldClose(window, true);
+        }
     }
 
+    simulation.stop();
+    if (capture)
+    {
+        capture->finish();
+        offlineRender.report(*capture);
+    }
+    if (shaderReload)
+        shaderReload->stop();
+
+    const ResidencyStats& residency = assets.stats();
+    std::cout << "assets: " << residency.hits << " hits, " << residency.misses << " misses, " << residency.loads
+        << " loads (" << residency.reloads << " reloads), " << residency.evictions << " evictions, "
+        << residency.unloads << " unloads" << std::endl;
+    std::cout << "model import: " << residency.importMs << " ms total";
+    if (memstats::heapHooked()) // 堆峰值只在snow-bench中测量
+        std::cout << ", peak " << (residency.importPeakBytes >> 20) << " MB heap";
+    std::cout << std::endl;
+    std::cout << "texture arrays: " << TextureArrayPool::instance().pageCount() << " pages" << std::endl;
+    if (dynamicResolution)
+        std::cout << dynamicResolution->summary() << std::endl;
+    std::cout << memstats::report();
+
+    // 退出时导出性能分析结果
+    PROFILE_DUMP("snow-trace.json");
+
+    // 持有GL对象的离屏目标在上下文销毁之前释放
+    capture.reset();
+    dynamicResolution.reset();
+    clusteredLights.release();
+    shadowMap.release();
+    snowCover.release();
+    atmosphere.release();
     glfwTerminate();
     return 0;
 }
 
-void initDepthBuffer(GLuint& depthMapFBO, GLuint& depthMap)
+// 命令回放时调用：级联FBO切换与阴影贴图绑定只能在GL线程进行
+struct CascadeBegin
+{
+    CascadedShadowMap* shadowMap;
+    int cascade;
+};
+
+void beginCascadeCommand(const CascadeBegin& args)
 {
-    const GLuint SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-
-    glGenFramebuffers(1, &depthMapFBO);
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-                 SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT,
-                 GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = {1.0, 1.0, 1.0, 1.0};
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    args.shadowMap->beginCascade(args.cascade);
 }
 
-void renderShadowMap(Shader& depthShader, GLuint depthMapFBO, glm::vec3 lightPos, Model& stump, Model& house,
-                     Model& snowman)
+struct CascadeEnd
 {
-    // 设置视锥体和视图矩阵
-    glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 7.5f);
-    glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+    CascadedShadowMap* shadowMap;
+    int width;
+    int height;
+};
 
-    depthShader.use();
-    depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+void endShadowCommand(const CascadeEnd& args)
+{
+    args.shadowMap->end(args.width, args.height);
+}
 
-    glViewport(0, 0, 1024, 1024);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+struct ShadowBind
+{
+    const CascadedShadowMap* shadowMap;
+    const Shader* shader;
+};
 
-    drawStamp(depthShader, stump, stumpPosition, stumpRotation, stumpScale);
-    drawHouse(depthShader, house);
-    drawSnowman(depthShader, snowman);
+void bindShadowCommand(const ShadowBind& args)
+{
+    args.shadowMap->bind(*args.shader);
+}
+
+void recordShadowMap(CommandList& list, Shader& depthShader, CascadedShadowMap& shadowMap)
+{
+    list.use(depthShader);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // 减轻阴影粉刺
+    list.enable(GL_POLYGON_OFFSET_FILL);
+    list.polygonOffset(2.0f, 4.0f);
+    for (int i = 0; i < shadowMap.cascadeCount; i++)
+    {
+        // 本帧不刷新的远级联保留上一次的深度与矩阵
+        if (!shadowMap.needsRender(i))
+            continue;
+
+        list.call(beginCascadeCommand, CascadeBegin{&shadowMap, i});
+        list.setMat4("lightSpaceMatrix", shadowMap.lightSpaceMatrices[i]);
+
+        recordAsset(list, stumpNode, stumpAsset, false);
+        recordAsset(list, houseNode, houseAsset, false);
+        recordAsset(list, snowmanNode, snowmanAsset, false);
+    }
+    list.disable(GL_POLYGON_OFFSET_FILL);
 
     // 恢复视口大小
-    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    list.call(endShadowCommand, CascadeEnd{&shadowMap, static_cast<int>(SCR_WIDTH), static_cast<int>(SCR_HEIGHT)});
 }
 
 
-void applyShadow(Shader& shader, GLuint depthMap, glm::mat4 lightSpaceMatrix, Model& stump, Model& house,
-                 Model& snowman)
+void recordScene(CommandList& list, Shader& shader, Shader& prepassShader, const CascadedShadowMap& shadowMap,
+                 const glm::mat4& view, const glm::mat4& projection)
 {
-    shader.use();
-    shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-    shader.setInt("shadowMap", 1);
+    // 先只写深度，光照阶段每个可见像素只着色一次
+    if (depthPrepass)
+    {
+        list.use(prepassShader);
+        list.setMat4("projection", projection);
+        list.setMat4("view", view);
+        list.colorMask(false);
+        recordAsset(list, stumpNode, stumpAsset, false);
+        recordAsset(list, houseNode, houseAsset, false);
+        recordAsset(list, snowmanNode, snowmanAsset, false);
+        list.colorMask(true);
+        // 光照阶段只处理深度与预渲染结果相同的片段，且不再写深度
+        list.depthFunc(GL_EQUAL);
+        list.depthMask(false);
+    }
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
+    // 应用阴影到场景
+    list.use(shader);
+    list.setMat4("projection", projection);
+    list.setMat4("view", view);
+    list.call(bindShadowCommand, ShadowBind{&shadowMap, &shader});
+    recordAsset(list, stumpNode, stumpAsset, true);
+    recordAsset(list, houseNode, houseAsset, true);
+    recordAsset(list, snowmanNode, snowmanAsset, true);
 
-    drawStamp(shader, stump, stumpPosition, stumpRotation, stumpScale);
-    drawHouse(shader, house);
-    drawSnowman(shader, snowman);
+    if (depthPrepass)
+    {
+        list.depthFunc(GL_LESS);
+        list.depthMask(true);
+    }
 }
 
 
-void drawStamp(Shader shader, Model stump, glm::vec3 stumpPosition, glm::vec3 stumpRotation, glm::vec3 stumpScale)
+// 软件后端：提交与GL路径相同的模型与雪花，在CPU上渲染后拉伸复制到当前绑定的帧缓冲
+void renderSoftware(SoftwareRasterizer& raster, const glm::mat4& view, const glm::mat4& projection,
+                    const glm::vec3& lightColor, const CascadedShadowMap& shadowMap, const Atmosphere& atmosphere,
+                    const Model& crystal)
 {
-    shader.use();
-
-    glm::mat4 projectionMat = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f,
-                                               100.0f);
-    glm::mat4 viewMat = camera.GetViewMatrix();
-    shader.setMat4("projection", projectionMat);
-    shader.setMat4("view", viewMat);
-
-    glm::mat4 modelMat = glm::mat4(1.0f);
-    modelMat = glm::translate(modelMat, stumpPosition);
-    modelMat = glm::scale(modelMat, stumpScale);
-    modelMat = glm::rotate(modelMat, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-    modelMat = glm::rotate(modelMat, glm::radians(stumpRotation.x), glm::vec3(1.0f, 0.0f, 0.0f)); // 应用X轴旋转
-    modelMat = glm::rotate(modelMat, glm::radians(stumpRotation.y), glm::vec3(0.0f, 1.0f, 0.0f)); // 应用Y轴旋转
-    modelMat = glm::rotate(modelMat, glm::radians(stumpRotation.z), glm::vec3(0.0f, 0.0f, 1.0f)); // 应用Z轴旋转
-    shader.setMat4("model", modelMat);
-    stump.Draw(shader);
+    raster.beginFrame(view, projection, camera.Position, lightPos, lightColor);
+    raster.setShadows(shadowMap);
+    raster.setSky(atmosphere);
+    const int nodes[] = {stumpNode, houseNode, snowmanNode};
+    const int handles[] = {stumpAsset, houseAsset, snowmanAsset};
+    for (int i = 0; i < 3; i++)
+    {
+        if (const Model* model = assets.acquire(handles[i]))
+            raster.drawModel(*model, scene.world(nodes[i]), scene.normalMatrix(nodes[i]));
+    }
+    raster.drawInstances(crystal, snowflakePositions, SnowflakeGenerator::flakeScale(),
+                         SnowflakeGenerator::flakeColor());
+    raster.render();
+    raster.present(SCR_WIDTH, SCR_HEIGHT);
 }
 
 
-void drawHouse(Shader shader, Model house)
+// 离线渲染与后端对比开始计帧的条件：纹理都已上传，场景资源都已驻留（不再用包围盒占位）
+bool sceneReady(TextureStreamer& streamer)
 {
-    shader.use();
-    glm::mat4 projectionMat = glm::perspective(glm::radians(camera.Zoom),
-                                               (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                                               0.1f,
-                                               100.0f);
-    glm::mat4 viewMat = camera.GetViewMatrix();
-    shader.setMat4("projection", projectionMat);
-    shader.setMat4("view", viewMat);
-    glm::mat4 modelMat = glm::mat4(1.0f);
-    modelMat = glm::translate(modelMat, glm::vec3(0.0f, 0.0f, 0.0f));
-    shader.setMat4("model", modelMat);
-    house.Draw(shader);
+    return streamer.pending() == 0 && assets.isResident(stumpAsset) && assets.isResident(houseAsset)
+        && assets.isResident(snowmanAsset);
 }
 
-void drawSnowman(Shader shader, Model snowman)
+// 录制一个场景资源的绘制，矩阵取节点缓存的值；不调用GL，可在工作线程中进行。
+// view与projection由各通道开头设置一次；深度通道（lit为false）的着色器只用model矩阵
+void recordAsset(CommandList& list, int node, int handle, bool lit)
 {
-    shader.use();
-    glm::mat4 projectionMat = glm::perspective(glm::radians(camera.Zoom),
-                                               (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                                               0.1f,
-                                               100.0f);
-    glm::mat4 viewMat = camera.GetViewMatrix();
-    shader.setMat4("projection", projectionMat);
-    shader.setMat4("view", viewMat);
-    glm::mat4 modelMat = glm::mat4(1.0f);
-    modelMat = glm::translate(modelMat, glm::vec3(0.0f, 0.0f, 0.0f));
-    modelMat = glm::scale(modelMat, glm::vec3(3.0f, 3.0f, 3.0f));
-    modelMat = glm::rotate(modelMat, glm::radians(45.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-    modelMat = glm::translate(modelMat, glm::vec3(2.0f, 0.0f, -0.6f));
-    shader.setMat4("model", modelMat);
-    snowman.Draw(shader);
+    list.setMat4("model", scene.world(node));
+    if (lit)
+        list.setMat3("normalMatrix", scene.normalMatrix(node));
+    assets.record(list, handle, scene.world(node), lit);
+}
+
+// 创建场景节点并计算初始世界矩阵
+void buildScene()
+{
+    stumpNode = scene.add(SceneGraph::NO_PARENT, STUMP_POSITION, STUMP_ROTATION, STUMP_SCALE);
+    houseNode = scene.add();
+    // 雪人：先在锚点下平移，再随锚点缩放、旋转
+    int snowmanAnchor = scene.add(SceneGraph::NO_PARENT, glm::vec3(0.0f), glm::vec3(0.0f, -45.0f, 0.0f),
+                                  glm::vec3(3.0f));
+    snowmanNode = scene.add(snowmanAnchor, glm::vec3(2.0f, 0.0f, -0.6f));
+    scene.update();
+}
+
+// 灯笼沿环绕房屋的两圈小路排列，颜色在暖黄与橙色之间交替
+void placeLanterns(int count)
+{
+    clusteredLights.lights.clear();
+    for (int i = 0; i < count; i++)
+    {
+        float ring = (i % 2 == 0) ? 6.0f : 10.0f;
+        float angle = 6.28318530718f * i / std::max(count, 1);
+        PointLight lantern;
+        lantern.position = glm::vec3(std::cos(angle) * ring, 0.6f, std::sin(angle) * ring);
+        lantern.radius = 3.0f;
+        lantern.color = (i % 3 == 0) ? glm::vec3(3.0f, 1.6f, 0.6f) : glm::vec3(2.5f, 2.0f, 1.0f);
+        clusteredLights.lights.push_back(lantern);
+    }
 }
 
 
@@ -334,6 +1000,8 @@ void processInput(GLFWwindow* window)
     // 处理树桩旋转和缩放
     bool ctrlPressed = glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS;
     bool shiftPressed = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+    glm::vec3 stumpRotation = scene.rotation(stumpNode);
+    glm::vec3 stumpScale = scene.scale(stumpNode);
 
     if (ctrlPressed)
     {
@@ -379,7 +1047,9 @@ void processInput(GLFWwindow* window)
                 stumpScale.x += 0.01f;
         }
     }
-
+    // 数值不变时节点不会标脏
+    scene.setRotation(stumpNode, stumpRotation);
+    scene.setScale(stumpNode, stumpScale);
 
     // 检测鼠标按下状态
     if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
@@ -409,7 +1079,7 @@ void processInput(GLFWwindow* window)
                                                                 glm::vec3(0, 0, 0)); // 假设平面为y=0
 
             glm::vec3 deltaWorld = currentWorldCoords - previousWorldCoords;
-            stumpPosition += deltaWorld;
+            scene.setPosition(stumpNode, scene.position(stumpNode) + deltaWorld);
             previousWorldCoords = currentWorldCoords;
         }
     }
@@ -419,20 +1089,16 @@ void processInput(GLFWwindow* window)
     }
     if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
     {
-        stumpPosition = glm::vec3(0.0f, 0.0f, 5.0f);
-        stumpRotation = glm::vec3(0.0f, 0.0f, 0.0f);
-        stumpScale = glm::vec3(0.1f, 0.1f, 0.1f);
+        scene.setPosition(stumpNode, STUMP_POSITION);
+        scene.setRotation(stumpNode, STUMP_ROTATION);
+        scene.setScale(stumpNode, STUMP_SCALE);
     }
     if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
     {
         if (!zKeyPressed)
         {
             zKeyPressed = true;
-            generator.isSnowing = !generator.isSnowing; // 切换下雪状态
-            if (!generator.isSnowing)
-            {
-                generator.clearSnowflakes(); // 清除所有雪花
-            }
+            simulation.snowing = !simulation.snowing; // 切换下雪状态，停止时模拟线程会清除所有雪花
         }
     }
     else if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE)
@@ -444,86 +1110,87 @@ void processInput(GLFWwindow* window)
         if (!xKeyPressed)
         {
             xKeyPressed = true;
-            isSunMoving = !isSunMoving; // 切换太阳光的移动状态
-            if (!isSunMoving)
-            {
-                lightPos = initialLightPos; // 暂停时移动到初始位置
-            }
+            isSunMoving = !isSunMoving; // 切换太阳光的移动状态，暂停时模拟线程把太阳移回初始位置
+            simulation.sunMoving = isSunMoving;
         }
     }
     else if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE)
     {
         xKeyPressed = false;
     }
-}
-
-glm::vec3 screenToWorldCoords(double xpos, double ypos, GLFWwindow* window, glm::mat4 view, glm::mat4 projection)
-{
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-
-    float z;
-    glReadPixels(xpos, height - ypos, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &z);
-
-    glm::vec4 screenPos = glm::vec4(
-        (2.0f * xpos) / width - 1.0f,
-        1.0f - (2.0f * ypos) / height,
-        z * 2.0f - 1.0f,
-        1.0f
-    );
-
-    glm::vec4 worldPos = glm::inverse(projection * view) * screenPos;
-    worldPos /= worldPos.w;
-
-    return glm::vec3(worldPos.x, worldPos.y, worldPos.z);
-}
-
-
-glm::vec3 ScreenPosToWorldRay(int mouseX, int mouseY, int screenWidth, int screenHeight, glm::mat4 ViewMatrix,
-                              glm::mat4 ProjectionMatrix)
-{
-    glm::vec4 rayStartNDC(
-        ((float)mouseX / (float)screenWidth - 0.5f) * 2.0f,
-        ((float)mouseY / (float)screenHeight - 0.5f) * 2.0f,
-        -1.0f,
-        1.0f
-    );
-    glm::vec4 rayEndNDC(
-        ((float)mouseX / (float)screenWidth - 0.5f) * 2.0f,
-        ((float)mouseY / (float)screenHeight - 0.5f) * 2.0f,
-        0.0f,
-        1.0f
-    );
-
-    glm::vec4 rayStartWorld = glm::inverse(ProjectionMatrix * ViewMatrix) * rayStartNDC;
-    rayStartWorld /= rayStartWorld.w;
-    glm::vec4 rayEndWorld = glm::inverse(ProjectionMatrix * ViewMatrix) * rayEndNDC;
-    rayEndWorld /= rayEndWorld.w;
-
-    glm::vec3 rayDirWorld(rayEndWorld - rayStartWorld);
-    rayDirWorld = glm::normalize(rayDirWorld);
-
-    return rayDirWorld;
-}
-
-
-glm::vec3 RayPlaneIntersection(glm::vec3 rayOrigin, glm::vec3 rayDirection, glm::vec3 planeNormal, glm::vec3 planePoint)
-{
-    float denom = glm::dot(planeNormal, rayDirection);
-    if (abs(denom) > 0.0001f)
+#ifdef SNOW_PROFILER
+    if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS)
+    {
+        if (!f9KeyPressed)
+        {
+            f9KeyPressed = true;
+            PROFILE_DUMP("snow-trace.json"); // 随时导出滚动缓冲区
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F9) == GLFW_RELEASE)
+    {
+        f9KeyPressed = false;
+    }
+#endif
+#ifdef SNOW_GL_STATS
+    if (glfwGetKey(window, GLFW_KEY_F10) == GLFW_PRESS)
     {
-        // 非平行
-        float t = glm::dot(planePoint - rayOrigin, planeNormal) / denom;
-        return rayOrigin + rayDirection * t;
+        if (!f10KeyPressed)
+        {
+            f10KeyPressed = true;
+            std::cout << glstats::report(glstats::lastFrame()); // 输出逐阶段渲染统计
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F10) == GLFW_RELEASE)
+    {
+        f10KeyPressed = false;
+    }
+#endif
+    if (glfwGetKey(window, GLFW_KEY_F7) == GLFW_PRESS)
+    {
+        if (!f7KeyPressed)
+        {
+            f7KeyPressed = true;
+            if (dynamicResolution)
+                std::cout << dynamicResolution->summary() << std::endl; // 当前缩放与控制器状态
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F7) == GLFW_RELEASE)
+    {
+        f7KeyPressed = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_F8) == GLFW_PRESS)
+    {
+        if (!f8KeyPressed)
+        {
+            f8KeyPressed = true;
+            std::cout << memstats::report(); // 按资源与类别输出内存占用及峰值
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_F8) == GLFW_RELEASE)
+    {
+        f8KeyPressed = false;
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+    {
+        if (!pKeyPressed)
+        {
+            pKeyPressed = true;
+            depthPrepass = !depthPrepass; // 切换深度预渲染
+            std::cout << "depth pre-pass: " << (depthPrepass ? "on" : "off") << std::endl;
+        }
+    }
+    else if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE)
+    {
+        pKeyPressed = false;
     }
-    return glm::vec3(0, 0, 0);
 }
 
-
 // 处理窗口大小变化
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    clusteredLights.setViewport(width, height);
 }
 
 // 处理鼠标移动